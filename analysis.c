@@ -0,0 +1,337 @@
+/*
+ *  analysis.c
+ *
+ *  1フレームごとの周波数解析を行う
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "analysis.h"
+#include "simd.h"
+
+//  波形データの最大振幅。16bitなら32768でよい。
+#define MAX_SINT    32768
+
+#define PI          M_PI
+
+
+//  malloc のラッパ関数
+//  確保に失敗した場合はエラー終了する。
+static void *_analysis_alloc(size_t size)
+{
+    void *ptr = malloc(size);
+    if (!ptr) {
+        perror("Failed to allocate memory for analysis");
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+
+/*
+ *  パラメータをデフォルト値で初期化する
+ */
+void analysis_param_init(AnalysisParam *param)
+{
+    memset(param, 0, sizeof(AnalysisParam));
+    param->mode         = MODE_DFT;
+    param->window_type  = WINDOW_TAPER;
+    param->hz_low       = 27.5;         //  A0
+    param->hz_high      = 4186.01;      //  C8
+    param->cents        = 0.0;
+    param->bins_per_octave = 12;
+    param->precision    = PRECISION_DOUBLE;
+    sample_format_init(&param->format);
+}
+
+
+/*
+ *  Analysis オブジェクトを新規作成する
+ */
+Analysis *analysis_new(const AnalysisParam *param)
+{
+    Analysis *an = _analysis_alloc(sizeof(Analysis));
+    size_t pad_size;
+    int k;
+
+    memset(an, 0, sizeof(Analysis));
+    an->param = *param;
+
+    if (!sample_format_valid(&param->format)) {
+        fprintf(stderr, "analysis_new() : unsupported sample format (%d bits, %d channels)\n",
+                param->format.bits, param->format.channels);
+        exit(EXIT_FAILURE);
+    }
+
+    //  goertzel モードでは 0 埋めの必要がない
+    //  cqt モードでは、フレームを含む 2 のべき乗の長さとし、窓関数はカーネルの側で掛ける
+    pad_size = (param->mode == MODE_GOERTZEL) ? param->frame_size : param->pad_size;
+    if (param->mode == MODE_CQT) {
+        an->cqt = cqt_kernel_new(param->sample_rate, param->frame_size, param->hz_low, param->hz_high,
+                                 param->cents, param->bins_per_octave, param->window_type);
+        pad_size = an->cqt->fft_size;
+    }
+    an->framer = framer_new(param->frame_size, pad_size,
+                            (param->mode == MODE_CQT) ? WINDOW_RECT : param->window_type);
+    pad_size = an->framer->pad_size;
+
+    if (param->mode == MODE_CQT) {
+        an->num_bin = an->cqt->num_bin;
+        an->freq = _analysis_alloc(sizeof(double) * an->num_bin);
+        memcpy(an->freq, an->cqt->freq, sizeof(double) * an->num_bin);
+    } else if (param->mode == MODE_GOERTZEL) {
+        an->bank = goertzel_bank_new(param->sample_rate, param->hz_low, param->hz_high, param->cents);
+        an->num_bin = an->bank->num_note;
+        an->freq = _analysis_alloc(sizeof(double) * an->num_bin);
+        memcpy(an->freq, an->bank->freq, sizeof(double) * an->num_bin);
+    } else {
+        //  1 ～ max_freq Hz の範囲にあるビン(ナイキスト周波数まで)
+        double bin_hz = param->sample_rate / pad_size;
+        an->num_bin = floor(param->max_freq / bin_hz + 1e-9);
+        if (an->num_bin > pad_size / 2)
+            an->num_bin = pad_size / 2;
+        an->freq = _analysis_alloc(sizeof(double) * (an->num_bin > 0 ? an->num_bin : 1));
+        for (k = 0; k < an->num_bin; k++)
+            an->freq[k] = (k + 1) * bin_hz;
+    }
+    an->result = _analysis_alloc(sizeof(double) * (an->num_bin > 0 ? an->num_bin : 1));
+
+    if (param->mode == MODE_DFT || param->mode == MODE_SDFT) {
+        an->table.size = pad_size;
+        an->table.cos = _analysis_alloc(sizeof(double) * pad_size);
+        an->table.sin = _analysis_alloc(sizeof(double) * pad_size);
+        for (k = 0; k < pad_size; k++) {
+            an->table.cos[k] = cos(2 * PI * k / pad_size);
+            an->table.sin[k] = sin(2 * PI * k / pad_size);
+        }
+    } else if (param->mode == MODE_CQT
+               || (param->mode == MODE_FFT && param->precision != PRECISION_FLOAT)) {
+        an->plan = fft_real_plan_new(pad_size);
+        an->spectrum = _analysis_alloc(sizeof(complex) * (pad_size / 2 + 1));
+    }
+
+    //  float 版の変換エンジン。テーブルは double で計算してから丸める
+    if (param->precision == PRECISION_FLOAT
+        && (param->mode == MODE_DFT || param->mode == MODE_FFT)) {
+        if (param->mode == MODE_DFT) {
+            an->tablef.size = pad_size;
+            an->tablef.cos = _analysis_alloc(sizeof(float) * pad_size);
+            an->tablef.sin = _analysis_alloc(sizeof(float) * pad_size);
+            for (k = 0; k < pad_size; k++) {
+                an->tablef.cos[k] = an->table.cos[k];
+                an->tablef.sin[k] = an->table.sin[k];
+            }
+            free(an->table.cos);
+            free(an->table.sin);
+            an->table.cos = an->table.sin = NULL;
+        } else {
+            an->planf = fftf_real_plan_new(pad_size);
+            an->spectrumf = _analysis_alloc(sizeof(float complex) * (pad_size / 2 + 1));
+        }
+    }
+
+    if (param->mode == MODE_SDFT) {
+        size_t anchor = param->anchor ? param->anchor : param->frame_size * 16;
+        an->sdft = sliding_dft_new(param->frame_size, an->num_bin,
+                                   an->table.cos, an->table.sin, an->table.size, anchor);
+        an->slide_buf = _analysis_alloc(sizeof(double) * param->frame_size);
+    }
+
+    return an;
+}
+
+
+/*
+ *  1フレーム分のサンプルを解析する
+ */
+void analysis_run(Analysis *an, const void *sample, size_t num_sample)
+{
+    const double *frame;
+    size_t loaded;
+    double scale;
+    ProfileMark mark;
+    int k;
+
+    if (an->param.mode == MODE_SDFT) {
+        if (num_sample > an->param.frame_size)
+            num_sample = an->param.frame_size;
+        sliding_dft_reset(an->sdft);
+        an->num_pushed = an->num_real = 0;
+        analysis_slide(an, sample, num_sample);
+        return;
+    }
+
+    profile_begin(an->lane, &mark);
+    if (an->planf || an->tablef.cos) {
+        //  float 版の変換エンジンでは、float のフレームだけを使う
+        frame = NULL;
+        an->framef = framer_load_float(an->framer, sample, num_sample, &an->param.format);
+    } else {
+        frame = framer_load(an->framer, sample, num_sample, &an->param.format);
+    }
+    loaded = an->framer->num_sample;
+    profile_end(an->lane, &mark, PROFILE_CONVERT, sample_frame_bytes(&an->param.format) * loaded);
+
+    profile_begin(an->lane, &mark);
+    switch (an->param.mode) {
+    case MODE_GOERTZEL:
+        goertzel_bank_process(an->bank, frame, loaded, an->result);
+        break;
+    case MODE_CQT:
+        fft_real_plan_execute(an->plan, frame, an->spectrum);
+        cqt_kernel_apply(an->cqt, an->spectrum, an->result);
+        break;
+    case MODE_FFT:
+        if (an->planf) {
+            fftf_real_plan_execute(an->planf, an->framef, an->spectrumf);
+            for (k = 0; k < an->num_bin; k++)
+                an->result[k] = cabsf(an->spectrumf[k + 1]);
+        } else {
+            fft_real_plan_execute(an->plan, frame, an->spectrum);
+            for (k = 0; k < an->num_bin; k++)
+                an->result[k] = cabs(an->spectrum[k + 1]);
+        }
+        break;
+    default:
+        if (an->framef)
+            dftf(an->framef, loaded, an->result, an->num_bin, &an->tablef);
+        else
+            dft(frame, loaded, an->result, an->num_bin, &an->table);
+        break;
+    }
+
+    //  窓関数の総和で割り、振幅を正規化する
+    //  (矩形窓の場合、総和はサンプル数に等しい)
+    //  cqt モードでは、カーネルの窓関数の総和で割ってある
+    if (an->param.mode == MODE_CQT)
+        scale = 2 * PI / MAX_SINT;
+    else
+        scale = (an->framer->gain > 0) ? 2 * PI / an->framer->gain / MAX_SINT : 0.0;
+    for (k = 0; k < an->num_bin; k++)
+        an->result[k] *= scale;
+    profile_end(an->lane, &mark, PROFILE_TRANSFORM, 0);
+}
+
+
+/*
+ *  サンプルを追加し、直近 frame_size 個のサンプルを解析する(sdft モード)
+ */
+void analysis_slide(Analysis *an, const void *sample, size_t num_sample)
+{
+    const long size = an->param.frame_size;
+    const size_t frame_bytes = sample_frame_bytes(&an->param.format);
+    const unsigned char *src = sample;
+    long first, last, valid;
+    double scale;
+    ProfileMark mark;
+    int k;
+
+    //  frame_size 個ずつ double 型に変換して追加する
+    while (num_sample > 0) {
+        size_t n = (num_sample < size) ? num_sample : size;
+
+        if (src) {
+            profile_begin(an->lane, &mark);
+            sample_convert(src, n, &an->param.format, NULL, an->slide_buf);
+            profile_end(an->lane, &mark, PROFILE_CONVERT, n * frame_bytes);
+
+            profile_begin(an->lane, &mark);
+            sliding_dft_push(an->sdft, an->slide_buf, n);
+            profile_end(an->lane, &mark, PROFILE_TRANSFORM, 0);
+            src += n * frame_bytes;
+        } else {
+            profile_begin(an->lane, &mark);
+            sliding_dft_push(an->sdft, NULL, n);
+            profile_end(an->lane, &mark, PROFILE_TRANSFORM, 0);
+        }
+
+        an->num_pushed += n;
+        if (src)
+            an->num_real = an->num_pushed;
+        num_sample -= n;
+    }
+
+    //  窓に含まれる 0 埋めでないサンプル数
+    first = (an->num_pushed > size) ? an->num_pushed - size : 0;
+    last  = an->num_real;
+    valid = (last > first) ? last - first : 0;
+
+    scale = (valid > 0) ? 2 * PI / valid / MAX_SINT : 0.0;
+    for (k = 0; k < an->num_bin; k++)
+        an->result[k] = cabs(an->sdft->X[k]) * scale;
+}
+
+
+/*
+ *  Analysis オブジェクトを開放する
+ */
+void analysis_free(Analysis *an)
+{
+    if (an) {
+        framer_free(an->framer);
+        free(an->freq);
+        free(an->result);
+        free(an->table.cos);
+        free(an->table.sin);
+        fft_real_plan_free(an->plan);
+        free(an->spectrum);
+        goertzel_bank_free(an->bank);
+        cqt_kernel_free(an->cqt);
+        sliding_dft_free(an->sdft);
+        free(an->slide_buf);
+        free(an->tablef.cos);
+        free(an->tablef.sin);
+        fftf_real_plan_free(an->planf);
+        free(an->spectrumf);
+        free(an);
+    }
+}
+
+
+/*
+ *  離散フーリエ解析を行う。
+ *
+ *  sample     : 解析対象のサンプルデータ(窓関数を掛けたもの)
+ *  num_sample : サンプルの数。これより後ろは 0 とみなすため、計算しない。
+ *  result     : 解析結果の格納先。
+ *               table->size 点の DFT の k 番目の成分の絶対値を
+ *               result[k - 1] に格納する(1 <= k <= num_bin)。
+ *  num_bin    : 求めるビンの数
+ *  table      : 三角関数のテーブル
+ *
+ *  三角関数はテーブルを引くだけで、ループ内では計算しない。
+ *  各ビンの積和は、CPU に合わせて選んだ SIMD カーネルで行う。
+ *
+ */
+void dft(const double *sample, size_t num_sample, double *result, int num_bin, const DftTable *table)
+{
+    const DftBinFunc dft_bin = simd_get_kernel()->dft_bin;
+    int k;
+
+    for (k = 1; k <= num_bin; k++) {
+        double real, imag;
+
+        dft_bin(sample, num_sample, k, table->cos, table->sin, table->size, &real, &imag);
+        result[k - 1] = sqrt(real * real + imag * imag);
+    }
+}
+
+
+/*
+ *  dft() の float 版
+ */
+void dftf(const float *sample, size_t num_sample, double *result, int num_bin, const DftfTable *table)
+{
+    const DftBinfFunc dft_bin = simd_get_kernel()->dft_binf;
+    int k;
+
+    for (k = 1; k <= num_bin; k++) {
+        float real, imag;
+
+        dft_bin(sample, num_sample, k, table->cos, table->sin, table->size, &real, &imag);
+        result[k - 1] = sqrt((double)real * real + (double)imag * imag);
+    }
+}
@@ -0,0 +1,184 @@
+/*
+ *  analysis.h
+ *
+ *  1フレームごとの周波数解析を行う
+ *
+ *  フレームの切り出し(窓関数・0 埋め)と、各解析モードの変換エンジンを
+ *  まとめて保持する。必要な領域とテーブルは analysis_new() で一度だけ
+ *  確保し、analysis_run() ではメモリ確保を行わない。
+ *
+ */
+
+#ifndef __ANALYSIS_H__
+#define __ANALYSIS_H__
+
+#include <stddef.h>
+#include <complex.h>
+#include "frame.h"
+#include "fft.h"
+#include "goertzel.h"
+#include "sdft.h"
+#include "cqt.h"
+#include "sample.h"
+#include "profile.h"
+
+//  解析モード
+#define MODE_DFT        0   //  直接 DFT を計算する
+#define MODE_GOERTZEL   1   //  平均律の各音程を Goertzel フィルタで求める
+#define MODE_FFT        2   //  0 埋めしたフレームの FFT から必要なビンを取り出す
+#define MODE_SDFT       3   //  スライディング DFT で、サンプルごとに各ビンを更新する(矩形窓)
+#define MODE_CQT        4   //  定 Q 変換。対数で等間隔のビンを、FFT と疎なカーネルで求める
+
+//  変換エンジンの精度(dft, fft モード)
+//  goertzel, sdft モードは漸化式の誤差が積み重なるため、常に double で計算する。
+//  cqt モードも double で計算する。
+#define PRECISION_DOUBLE    0   //  double で計算する(基準値を求める場合)
+#define PRECISION_FLOAT     1   //  float で計算する。SIMD の1命令で2倍の要素を扱える
+
+
+//  解析のパラメータ
+typedef struct _analysis_param {
+    int         mode;           //  解析モード(MODE_*)
+    double      sample_rate;    //  サンプリングレート
+    size_t      frame_size;     //  1フレームのサンプル数
+    size_t      pad_size;       //  0 埋め後の長さ。周波数の刻みは sample_rate / pad_size Hz
+    int         window_type;    //  窓関数の種類(WINDOW_*)
+    double      max_freq;       //  解析する上限の周波数(dft, fft モード)
+    double      hz_low;         //  解析する周波数の下限(goertzel, cqt モード)
+    double      hz_high;        //  解析する周波数の上限(goertzel, cqt モード)
+    double      cents;          //  平均律からのずれ(goertzel, cqt モード)
+    int         bins_per_octave;    //  1オクターブあたりのビンの数(cqt モード)
+    size_t      anchor;         //  再アンカーの間隔(サンプル数, sdft モード)。0 なら frame_size の 16 倍
+    int         precision;      //  変換エンジンの精度(PRECISION_*, dft, fft モード)
+    SampleFormat format;        //  入力するサンプルデータの形式
+} AnalysisParam;
+
+
+//  DFT に用いる三角関数のテーブル
+//  cos[j] = cos(2πj / size), sin[j] = sin(2πj / size)
+typedef struct _dft_table {
+    size_t      size;
+    double      *cos;
+    double      *sin;
+} DftTable;
+
+//  DftTable の float 版
+typedef struct _dftf_table {
+    size_t      size;
+    float       *cos;
+    float       *sin;
+} DftfTable;
+
+
+//  Analysis 構造体
+typedef struct _analysis {
+    AnalysisParam   param;
+    Framer          *framer;        //  フレームの切り出し
+    int             num_bin;        //  結果のビンの数
+    double          *freq;          //  各ビンの周波数(Hz)
+    double          *result;        //  解析結果。各ビンの音量(正規化済み)
+
+    DftTable        table;          //  dft モードの三角関数テーブル
+    FftRealPlan     *plan;          //  fft, cqt モードのプラン
+    complex         *spectrum;      //  fft, cqt モードの変換結果
+    CqtKernel       *cqt;           //  cqt モードのカーネル
+    GoertzelBank    *bank;          //  goertzel モードのフィルタバンク
+    SlidingDft      *sdft;          //  sdft モードのスライディング DFT
+    long            num_pushed;     //  sdft モードで追加したサンプル数
+    long            num_real;       //  そのうち、0 埋めでないサンプル数
+    double          *slide_buf;     //  sdft モードで、追加するサンプルを変換する領域
+
+    //  精度が PRECISION_FLOAT の場合のみ
+    const float     *framef;        //  窓を掛けたフレームの float 版(framer 内の領域を指す)
+    DftfTable       tablef;         //  dft モードの三角関数テーブル
+    FftfRealPlan    *planf;         //  fft モードのプラン
+    float complex   *spectrumf;     //  fft モードの変換結果
+
+    ProfileLane     *lane;          //  変換・解析の時間を記録するレーン。NULL なら計測しない
+} Analysis;
+
+
+/*
+ *  パラメータをデフォルト値で初期化する
+ *
+ *  sample_rate, frame_size, max_freq は呼び出し元で設定すること。
+ *  サンプルデータの形式は、モノラル・16bit 整数となる。
+ */
+void analysis_param_init(AnalysisParam *param);
+
+
+/*
+ *  Analysis オブジェクトを新規作成する
+ *
+ *  引数：
+ *    param : 解析のパラメータ。内容はコピーされる。
+ */
+Analysis *analysis_new(const AnalysisParam *param);
+
+
+/*
+ *  1フレーム分のサンプルを解析する
+ *
+ *  引数：
+ *    an         : Analysis オブジェクト
+ *    sample     : 解析対象のサンプルデータ(param.format の形式)
+ *    num_sample : サンプル(サンプルフレーム)の数。frame_size より少ない場合は残りを 0 とみなす。
+ *
+ *  結果は an->result[0] ～ an->result[an->num_bin - 1] に格納される。
+ *  音量は以前の dft() と同じ尺度に正規化される。
+ *  (振幅 a の正弦波が、おおよそ π a / 32768 となる)
+ *
+ *  sdft モードでは、状態を初期化してからフレームを追加する。
+ *  an->lane が設定されていれば、変換と解析の時間をそこに記録する。
+ *
+ *  an 内部の領域を書き換えるため、同じ an を複数のスレッドから
+ *  同時に使ってはならない。
+ */
+void analysis_run(Analysis *an, const void *sample, size_t num_sample);
+
+
+/*
+ *  サンプルを追加し、直近 frame_size 個のサンプルを解析する(sdft モード)
+ *
+ *  引数：
+ *    an         : Analysis オブジェクト(sdft モードで作成したもの)
+ *    sample     : 追加するサンプルデータ(param.format の形式)。NULL の場合は 0 埋めとして扱う。
+ *    num_sample : 追加するサンプル数
+ *
+ *  1サンプルあたり O(ビン数) で各ビンを更新し、結果を an->result に格納する。
+ *  振幅は、窓内の 0 埋めでないサンプル数で正規化する。
+ */
+void analysis_slide(Analysis *an, const void *sample, size_t num_sample);
+
+
+/*
+ *  Analysis オブジェクトを開放する
+ */
+void analysis_free(Analysis *an);
+
+
+/*
+ *  離散フーリエ解析を行う。
+ *
+ *  sample     : 解析対象のサンプルデータ(窓関数を掛けたもの)
+ *  num_sample : サンプルの数。これより後ろは 0 とみなすため、計算しない。
+ *  result     : 解析結果の格納先。
+ *               table->size 点の DFT の k 番目の成分の絶対値を
+ *               result[k - 1] に格納する(1 <= k <= num_bin)。
+ *  num_bin    : 求めるビンの数
+ *  table      : 三角関数のテーブル
+ *
+ */
+void dft(const double *sample, size_t num_sample, double *result, int num_bin, const DftTable *table);
+
+
+/*
+ *  dft() の float 版
+ *
+ *  sample と table が float 型であること以外は dft() と同じ。
+ *  積和は float で行い、結果の絶対値は double で格納する。
+ */
+void dftf(const float *sample, size_t num_sample, double *result, int num_bin, const DftfTable *table);
+
+
+#endif  //  __ANALYSIS_H__
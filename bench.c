@@ -0,0 +1,516 @@
+/*
+ *  bench.c
+ *
+ *  変換・入出力の主な処理のベンチマーク
+ *
+ *    make bench
+ *    ./bench [-t seconds] [filter]
+ *
+ *  それぞれの処理を、いくつかの大きさで計測する。
+ *  出力の形式は benchutil.h を参照。
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <complex.h>
+#include <unistd.h>
+#include "benchutil.h"
+#include "analysis.h"
+#include "fft.h"
+#include "codelet.h"
+#include "frame.h"
+#include "simd.h"
+#include "wavfile.h"
+
+#define PI      M_PI
+
+//  read_data() の計測で、1回に読み込むサンプルフレーム数
+#define READ_CHUNK      4096
+
+
+//  malloc のラッパ関数
+//  確保に失敗した場合はエラー終了する。
+static void *_bench_alloc(size_t size)
+{
+    void *ptr = malloc(size);
+    if (!ptr) {
+        perror("Failed to allocate memory for benchmark");
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+
+//  計測に用いる波形(fft.c のサンプルプログラムと同じ混合波に、雑音を加えたもの)
+static void _make_signal(double *data, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        data[i] =   sin(2 * PI * i * 3 / n) * 0.5
+                  + sin(2 * PI * i * 2 / n)
+                  + cos(2 * PI * i * 6 / n) * 0.4
+                  + sin(2 * PI * i * 6 / n) * 0.2
+                  + (rand() / (double)RAND_MAX - 0.5) * 0.1;
+    }
+}
+
+
+/*
+ *  fft() : 1成分ずつ求める再帰版。1回で全成分を求める
+ */
+typedef struct {
+    int         log2n;
+    double      *data;
+    complex     *out;
+} FftRecursiveBench;
+
+static void _bench_fft_recursive(void *_ctx)
+{
+    FftRecursiveBench *ctx = _ctx;
+    int n;
+
+    for (n = 0; n < (1 << ctx->log2n); n++)
+        ctx->out[n] = fft(n, ctx->log2n, ctx->data);
+}
+
+static void bench_fft_recursive(void)
+{
+    static const int log2n[] = { 6, 8, 10 };
+    FftRecursiveBench ctx;
+    int i;
+
+    for (i = 0; i < sizeof(log2n) / sizeof(log2n[0]); i++) {
+        int n = 1 << log2n[i];
+
+        ctx.log2n = log2n[i];
+        ctx.data = _bench_alloc(sizeof(double) * n);
+        ctx.out = _bench_alloc(sizeof(complex) * n);
+        _make_signal(ctx.data, n);
+
+        bench_run("fft_recursive", n, n, _bench_fft_recursive, &ctx);
+
+        free(ctx.data);
+        free(ctx.out);
+    }
+}
+
+
+/*
+ *  fft_plan_execute(), fftf_plan_execute() : 入力のコピーを含む
+ *  (結果を次の入力にすると、値が発散するため)
+ */
+typedef struct {
+    FftPlan     *plan;
+    FftfPlan    *planf;
+    int         n;
+    complex     *input;
+    complex     *data;
+    float complex *inputf;
+    float complex *dataf;
+} FftPlanBench;
+
+static void _bench_fft_plan(void *_ctx)
+{
+    FftPlanBench *ctx = _ctx;
+
+    memcpy(ctx->data, ctx->input, sizeof(complex) * ctx->n);
+    fft_plan_execute(ctx->plan, ctx->data);
+}
+
+static void _bench_fftf_plan(void *_ctx)
+{
+    FftPlanBench *ctx = _ctx;
+
+    memcpy(ctx->dataf, ctx->inputf, sizeof(float complex) * ctx->n);
+    fftf_plan_execute(ctx->planf, ctx->dataf);
+}
+
+static void bench_fft_plan(void)
+{
+    //  2 のべき乗・混合基数(441 = 3^2 * 7^2, 4410)・Bluestein(素数 1009)
+    //  コードレットのあるサイズ(1024 ～ 8192)は、汎用のプラン(*_generic)とも比べる。
+    static const int size[] = { 64, 256, 1024, 2048, 4096, 8192, 16384, 65536, 441, 4410, 1009 };
+    FftPlanBench ctx;
+    double *signal;
+    int i, k;
+
+    for (i = 0; i < sizeof(size) / sizeof(size[0]); i++) {
+        ctx.n = size[i];
+        ctx.plan = fft_plan_new(ctx.n);
+        ctx.planf = fftf_plan_new(ctx.n);
+        ctx.input = _bench_alloc(sizeof(complex) * ctx.n);
+        ctx.data = _bench_alloc(sizeof(complex) * ctx.n);
+        ctx.inputf = _bench_alloc(sizeof(float complex) * ctx.n);
+        ctx.dataf = _bench_alloc(sizeof(float complex) * ctx.n);
+        signal = _bench_alloc(sizeof(double) * ctx.n);
+        _make_signal(signal, ctx.n);
+        for (k = 0; k < ctx.n; k++)
+            ctx.inputf[k] = ctx.input[k] = signal[k];
+
+        bench_run("fft_plan", ctx.n, ctx.n, _bench_fft_plan, &ctx);
+        bench_run("fftf_plan", ctx.n, ctx.n, _bench_fftf_plan, &ctx);
+
+        if (fft_codelet_find(ctx.n)) {
+            fftf_plan_free(ctx.planf);
+            fft_plan_free(ctx.plan);
+            fft_codelet_enable(0);
+            ctx.plan = fft_plan_new(ctx.n);
+            ctx.planf = fftf_plan_new(ctx.n);
+            fft_codelet_enable(1);
+
+            bench_run("fft_generic", ctx.n, ctx.n, _bench_fft_plan, &ctx);
+            bench_run("fftf_generic", ctx.n, ctx.n, _bench_fftf_plan, &ctx);
+        }
+
+        free(signal);
+        free(ctx.dataf);
+        free(ctx.inputf);
+        free(ctx.data);
+        free(ctx.input);
+        fftf_plan_free(ctx.planf);
+        fft_plan_free(ctx.plan);
+    }
+}
+
+
+/*
+ *  fft_real_plan_execute(), fftf_real_plan_execute()
+ */
+typedef struct {
+    FftRealPlan *plan;
+    FftfRealPlan *planf;
+    double      *in;
+    complex     *out;
+    float       *inf;
+    float complex *outf;
+} FftRealBench;
+
+static void _bench_fft_real(void *_ctx)
+{
+    FftRealBench *ctx = _ctx;
+
+    fft_real_plan_execute(ctx->plan, ctx->in, ctx->out);
+}
+
+static void _bench_fftf_real(void *_ctx)
+{
+    FftRealBench *ctx = _ctx;
+
+    fftf_real_plan_execute(ctx->planf, ctx->inf, ctx->outf);
+}
+
+static void bench_fft_real(void)
+{
+    static const int size[] = { 256, 1024, 4096, 16384, 65536, 4410 };
+    FftRealBench ctx;
+    int i, k;
+
+    for (i = 0; i < sizeof(size) / sizeof(size[0]); i++) {
+        int n = size[i];
+
+        ctx.plan = fft_real_plan_new(n);
+        ctx.planf = fftf_real_plan_new(n);
+        ctx.in = _bench_alloc(sizeof(double) * n);
+        ctx.out = _bench_alloc(sizeof(complex) * (n / 2 + 1));
+        ctx.inf = _bench_alloc(sizeof(float) * n);
+        ctx.outf = _bench_alloc(sizeof(float complex) * (n / 2 + 1));
+        _make_signal(ctx.in, n);
+        for (k = 0; k < n; k++)
+            ctx.inf[k] = ctx.in[k];
+
+        bench_run("fft_real_plan", n, n, _bench_fft_real, &ctx);
+        bench_run("fftf_real_plan", n, n, _bench_fftf_real, &ctx);
+
+        free(ctx.outf);
+        free(ctx.inf);
+        free(ctx.out);
+        free(ctx.in);
+        fftf_real_plan_free(ctx.planf);
+        fft_real_plan_free(ctx.plan);
+    }
+}
+
+
+/*
+ *  インタリーブされたステレオの 16bit PCM データを、チャンネルごとに変換する
+ *
+ *    fft_real_pcm_split : チャンネルごとに分けてから fft_real_plan_execute_pcm() を2回
+ *    fft_real_pcm_many  : fft_real_plan_execute_pcm_many() で分けずに変換
+ */
+typedef struct {
+    FftRealPlan *plan;
+    int         n;
+    short       *pcm;       //  インタリーブしたデータ(2n 個)
+    short       *channel;   //  チャンネルごとに分けたデータ(n 個)
+    complex     *out;       //  結果(n/2 + 1 個 × 2 チャンネル)
+} FftStereoBench;
+
+static void _bench_fft_stereo_split(void *_ctx)
+{
+    FftStereoBench *ctx = _ctx;
+    int c, k;
+
+    for (c = 0; c < 2; c++) {
+        for (k = 0; k < ctx->n; k++)
+            ctx->channel[k] = ctx->pcm[k * 2 + c];
+        fft_real_plan_execute_pcm(ctx->plan, ctx->channel, ctx->out + c * (ctx->n / 2 + 1));
+    }
+}
+
+static void _bench_fft_stereo_many(void *_ctx)
+{
+    FftStereoBench *ctx = _ctx;
+
+    fft_real_plan_execute_pcm_many(ctx->plan, 2, ctx->pcm, 2, 1, ctx->out, ctx->n / 2 + 1);
+}
+
+static void bench_fft_stereo(void)
+{
+    static const int size[] = { 1024, 4096, 4410 };
+    FftStereoBench ctx;
+    double *signal;
+    int i, k;
+
+    for (i = 0; i < sizeof(size) / sizeof(size[0]); i++) {
+        ctx.n = size[i];
+        ctx.plan = fft_real_plan_new(ctx.n);
+        ctx.pcm = _bench_alloc(sizeof(short) * ctx.n * 2);
+        ctx.channel = _bench_alloc(sizeof(short) * ctx.n);
+        ctx.out = _bench_alloc(sizeof(complex) * (ctx.n / 2 + 1) * 2);
+        signal = _bench_alloc(sizeof(double) * ctx.n * 2);
+        _make_signal(signal, ctx.n * 2);
+        for (k = 0; k < ctx.n * 2; k++)
+            ctx.pcm[k] = lrint(signal[k] * 12000);     //  最大値はおよそ 2.1
+
+        bench_run("fft_real_pcm_split", ctx.n, ctx.n * 2, _bench_fft_stereo_split, &ctx);
+        bench_run("fft_real_pcm_many", ctx.n, ctx.n * 2, _bench_fft_stereo_many, &ctx);
+
+        free(signal);
+        free(ctx.out);
+        free(ctx.channel);
+        free(ctx.pcm);
+        fft_real_plan_free(ctx.plan);
+    }
+}
+
+
+/*
+ *  dft(), dftf() : 2倍に 0 埋めしたフレームの、下半分のビンを求める
+ */
+typedef struct {
+    DftTable    table;
+    DftfTable   tablef;
+    double      *sample;
+    float       *samplef;
+    size_t      num_sample;
+    double      *result;
+    int         num_bin;
+} DftBench;
+
+static void _bench_dft(void *_ctx)
+{
+    DftBench *ctx = _ctx;
+
+    dft(ctx->sample, ctx->num_sample, ctx->result, ctx->num_bin, &ctx->table);
+}
+
+static void _bench_dftf(void *_ctx)
+{
+    DftBench *ctx = _ctx;
+
+    dftf(ctx->samplef, ctx->num_sample, ctx->result, ctx->num_bin, &ctx->tablef);
+}
+
+static void bench_dft(void)
+{
+    static const int size[] = { 256, 1024, 4096 };
+    DftBench ctx;
+    size_t k;
+    int i;
+
+    for (i = 0; i < sizeof(size) / sizeof(size[0]); i++) {
+        ctx.num_sample = size[i];
+        ctx.num_bin = size[i] / 2;
+        ctx.table.size = ctx.tablef.size = size[i] * 2;
+        ctx.table.cos = _bench_alloc(sizeof(double) * ctx.table.size);
+        ctx.table.sin = _bench_alloc(sizeof(double) * ctx.table.size);
+        ctx.tablef.cos = _bench_alloc(sizeof(float) * ctx.table.size);
+        ctx.tablef.sin = _bench_alloc(sizeof(float) * ctx.table.size);
+        for (k = 0; k < ctx.table.size; k++) {
+            ctx.tablef.cos[k] = ctx.table.cos[k] = cos(2 * PI * k / ctx.table.size);
+            ctx.tablef.sin[k] = ctx.table.sin[k] = sin(2 * PI * k / ctx.table.size);
+        }
+        ctx.sample = _bench_alloc(sizeof(double) * ctx.num_sample);
+        ctx.samplef = _bench_alloc(sizeof(float) * ctx.num_sample);
+        ctx.result = _bench_alloc(sizeof(double) * ctx.num_bin);
+        _make_signal(ctx.sample, ctx.num_sample);
+        for (k = 0; k < ctx.num_sample; k++)
+            ctx.samplef[k] = ctx.sample[k];
+
+        bench_run("dft", ctx.num_sample, ctx.num_sample, _bench_dft, &ctx);
+        bench_run("dftf", ctx.num_sample, ctx.num_sample, _bench_dftf, &ctx);
+
+        free(ctx.result);
+        free(ctx.samplef);
+        free(ctx.sample);
+        free(ctx.tablef.sin);
+        free(ctx.tablef.cos);
+        free(ctx.table.sin);
+        free(ctx.table.cos);
+    }
+}
+
+
+/*
+ *  make_repeated_sample() : 2205 サンプルを、指定の長さまで伸長する
+ */
+typedef struct {
+    short       *sample;
+    size_t      num_sample;
+    short       *rep_sample;
+    size_t      num_rep_sample;
+} RepeatBench;
+
+static void _bench_repeat(void *_ctx)
+{
+    RepeatBench *ctx = _ctx;
+
+    make_repeated_sample(ctx->sample, ctx->num_sample, ctx->rep_sample, ctx->num_rep_sample);
+}
+
+static void bench_repeat(void)
+{
+    static const int size[] = { 4096, 16384, 65536 };
+    RepeatBench ctx;
+    size_t k;
+    int i;
+
+    ctx.num_sample = 2205;
+    ctx.sample = _bench_alloc(sizeof(short) * ctx.num_sample);
+    for (k = 0; k < ctx.num_sample; k++)
+        ctx.sample[k] = sin(2 * PI * k * 440 / 44100) * 16000;
+
+    for (i = 0; i < sizeof(size) / sizeof(size[0]); i++) {
+        ctx.num_rep_sample = size[i];
+        ctx.rep_sample = _bench_alloc(sizeof(short) * ctx.num_rep_sample);
+
+        bench_run("make_repeated_sample", size[i], size[i], _bench_repeat, &ctx);
+
+        free(ctx.rep_sample);
+    }
+    free(ctx.sample);
+}
+
+
+/*
+ *  read_data() : wavファイルをオープンし、全体を READ_CHUNK フレームずつ読んでクローズする
+ */
+typedef struct {
+    char        filename[64];
+    int         use_mmap;
+    short       *buf;
+} ReadBench;
+
+static void _bench_read(void *_ctx)
+{
+    ReadBench *ctx = _ctx;
+    WavData *wav = ctx->use_mmap ? open_wavfile_mmap(ctx->filename) : open_wavfile(ctx->filename);
+
+    if (!wav) {
+        fprintf(stderr, "Failed to open %s\n", ctx->filename);
+        exit(EXIT_FAILURE);
+    }
+    while (read_data(wav, ctx->buf, READ_CHUNK) == READ_CHUNK)
+        ;
+    close_wavfile(wav);
+}
+
+//  リトルエンディアンで書き出す
+static void _put_le(FILE *fp, unsigned long value, int bytes)
+{
+    int i;
+    for (i = 0; i < bytes; i++)
+        fputc((value >> (i * 8)) & 0xff, fp);
+}
+
+//  モノラル・16bit・44100Hz の wavファイルを作る
+static void _write_wav(const char *filename, size_t num_frame)
+{
+    FILE *fp = fopen(filename, "wb");
+    size_t i;
+
+    if (!fp) {
+        perror("Failed to create temporary wav file");
+        exit(EXIT_FAILURE);
+    }
+
+    fwrite("RIFF", 1, 4, fp);
+    _put_le(fp, 36 + num_frame * 2, 4);
+    fwrite("WAVEfmt ", 1, 8, fp);
+    _put_le(fp, 16, 4);
+    _put_le(fp, WAVE_FORMAT_PCM, 2);
+    _put_le(fp, 1, 2);              //  チャンネル数
+    _put_le(fp, 44100, 4);
+    _put_le(fp, 44100 * 2, 4);
+    _put_le(fp, 2, 2);              //  ブロックサイズ
+    _put_le(fp, 16, 2);
+    fwrite("data", 1, 4, fp);
+    _put_le(fp, num_frame * 2, 4);
+    for (i = 0; i < num_frame; i++)
+        _put_le(fp, (unsigned short)(short)(sin(2 * PI * i * 440 / 44100) * 16000), 2);
+
+    fclose(fp);
+}
+
+static void bench_read(void)
+{
+    static const int seconds[] = { 1, 10, 60 };
+    ReadBench ctx;
+    int i, fd;
+
+    if (!bench_selected("read_data"))
+        return;
+
+    ctx.buf = _bench_alloc(sizeof(short) * READ_CHUNK);
+    for (i = 0; i < sizeof(seconds) / sizeof(seconds[0]); i++) {
+        size_t num_frame = 44100 * seconds[i];
+
+        strcpy(ctx.filename, "/tmp/dftbenchXXXXXX");
+        if ((fd = mkstemp(ctx.filename)) < 0) {
+            perror("Failed to create temporary wav file");
+            exit(EXIT_FAILURE);
+        }
+        close(fd);
+        _write_wav(ctx.filename, num_frame);
+
+        ctx.use_mmap = 0;
+        bench_run("read_data", num_frame, num_frame, _bench_read, &ctx);
+        ctx.use_mmap = 1;
+        bench_run("read_data_mmap", num_frame, num_frame, _bench_read, &ctx);
+
+        unlink(ctx.filename);
+    }
+    free(ctx.buf);
+}
+
+
+int main(int argc, char *argv[])
+{
+    bench_init(argc, argv);
+    printf("# kernel %s\n", simd_get_kernel()->name);
+
+    srand(1);
+    bench_fft_recursive();
+    bench_fft_plan();
+    bench_fft_real();
+    bench_fft_stereo();
+    bench_dft();
+    bench_repeat();
+    bench_read();
+
+    return 0;
+}
@@ -0,0 +1,140 @@
+/*
+ *  benchutil.c
+ *
+ *  ベンチマークの計測と結果の出力
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "benchutil.h"
+
+//  最短計測時間(秒)
+static double bench_min_time = BENCH_MIN_TIME;
+
+//  計測対象の名前の絞り込み。NULL ならすべて
+static const char *bench_filter = NULL;
+
+//  メモリ確保の回数とバイト数(スレッドからも加算する)
+static unsigned long bench_alloc_count = 0;
+static unsigned long bench_alloc_bytes = 0;
+
+
+/*
+ *  メモリ確保の横取り
+ *
+ *  -Wl,--wrap=malloc などを指定してリンクした場合に、
+ *  malloc() などの呼び出しがこれらの関数に置き換わる。
+ */
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t num, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+    __atomic_add_fetch(&bench_alloc_count, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&bench_alloc_bytes, size, __ATOMIC_RELAXED);
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t num, size_t size)
+{
+    __atomic_add_fetch(&bench_alloc_count, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&bench_alloc_bytes, num * size, __ATOMIC_RELAXED);
+    return __real_calloc(num, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    __atomic_add_fetch(&bench_alloc_count, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&bench_alloc_bytes, size, __ATOMIC_RELAXED);
+    return __real_realloc(ptr, size);
+}
+
+
+/*
+ *  コマンドライン引数を解析する
+ */
+void bench_init(int argc, char *argv[])
+{
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:")) != -1) {
+        switch (opt) {
+            case 't':
+                bench_min_time = atof(optarg);
+                if (bench_min_time <= 0) {
+                    fprintf(stderr, "Invalid time: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-t seconds] [filter]\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (optind < argc)
+        bench_filter = argv[optind];
+
+    printf("# name size iterations ns_per_op items_per_sec allocs_per_op alloc_bytes_per_op\n");
+}
+
+
+/*
+ *  名前が、計測対象に含まれるかどうか
+ */
+int bench_selected(const char *name)
+{
+    return !bench_filter || strstr(name, bench_filter) != NULL;
+}
+
+
+/*
+ *  現在の時刻(ナノ秒)
+ */
+double bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+/*
+ *  計測を行い、結果を1行出力する
+ *
+ *  最初の1回は、キャッシュやテーブルを温めるために実行し、計測しない。
+ */
+void bench_run(const char *name, long size, double items, BenchFunc func, void *ctx)
+{
+    unsigned long count, bytes;
+    long iter, i;
+    double start, elapsed;
+
+    if (!bench_selected(name))
+        return;
+
+    func(ctx);
+
+    for (iter = 1; ; iter *= 2) {
+        count = __atomic_load_n(&bench_alloc_count, __ATOMIC_RELAXED);
+        bytes = __atomic_load_n(&bench_alloc_bytes, __ATOMIC_RELAXED);
+        start = bench_now_ns();
+        for (i = 0; i < iter; i++)
+            func(ctx);
+        elapsed = bench_now_ns() - start;
+
+        if (elapsed >= bench_min_time * 1e9)
+            break;
+    }
+    count = __atomic_load_n(&bench_alloc_count, __ATOMIC_RELAXED) - count;
+    bytes = __atomic_load_n(&bench_alloc_bytes, __ATOMIC_RELAXED) - bytes;
+
+    printf("%s %ld %ld %.1f %.6g %.2f %.1f\n",
+           name, size, iter, elapsed / iter, items * iter / (elapsed / 1e9),
+           (double)count / iter, (double)bytes / iter);
+    fflush(stdout);
+}
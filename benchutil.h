@@ -0,0 +1,74 @@
+/*
+ *  benchutil.h
+ *
+ *  ベンチマークの計測と結果の出力
+ *
+ *  各ベンチマークは、計測する処理の1回分を行う関数として書き、
+ *  bench_run() に渡す。bench_run() は、合計時間が最短計測時間を
+ *  超えるまで回数を倍にしながら繰り返し、1回あたりの結果を出力する。
+ *
+ *  出力は1件につき1行で、次の項目を空白で区切ったもの。
+ *  (# で始まる行は見出しや補足で、比較の際は読み飛ばしてよい)
+ *
+ *    name size iterations ns_per_op items_per_sec allocs_per_op alloc_bytes_per_op
+ *
+ *  items_per_sec は、1秒あたりに処理したサンプル数(描画ではピクセル数)。
+ *
+ *  メモリ確保の回数は、リンク時に BENCH_LDFLAGS(Makefile)を指定して
+ *  malloc, calloc, realloc の呼び出しを横取りして数える。
+ *  ライブラリ(libc, glib など)の内部での確保は数えない。
+ *
+ */
+
+#ifndef __BENCHUTIL_H__
+#define __BENCHUTIL_H__
+
+#include <stddef.h>
+
+//  最短計測時間(秒)のデフォルト値。-t オプションで変更できる
+#define BENCH_MIN_TIME      0.2
+
+
+//  計測する処理(1回分)
+typedef void (*BenchFunc)(void *ctx);
+
+
+/*
+ *  コマンドライン引数を解析する
+ *
+ *    bench [-t seconds] [filter]
+ *
+ *  filter を指定した場合は、名前に filter を含むものだけを計測する。
+ *  見出しの行を出力する。
+ */
+void bench_init(int argc, char *argv[]);
+
+
+/*
+ *  計測を行い、結果を1行出力する
+ *
+ *  引数：
+ *    name  : ベンチマークの名前
+ *    size  : 処理の大きさ(サンプル数など)
+ *    items : 1回あたりに処理するサンプル数(ピクセル数)
+ *    func  : 計測する処理
+ *    ctx   : func に渡すデータ
+ */
+void bench_run(const char *name, long size, double items, BenchFunc func, void *ctx);
+
+
+/*
+ *  名前が、計測対象に含まれるかどうか
+ *
+ *  準備に時間の掛かるものは、これで確かめてから準備すること。
+ */
+int bench_selected(const char *name);
+
+
+/*
+ *  現在の時刻(ナノ秒)
+ */
+double bench_now_ns(void);
+
+
+#endif  //  __BENCHUTIL_H__
@@ -0,0 +1,974 @@
+/*
+ *  check.c
+ *
+ *  各変換エンジンの精度の検査
+ *
+ *    make check
+ *
+ *  合成した信号(fft.c のサンプルプログラムと同じ混合波・乱数・インパルス)を
+ *  各エンジンで変換し、long double で直接計算した DFT(基準値)と比べる。
+ *  SIMD カーネルを使うものは、この CPU で使えるすべてのカーネルで検査する。
+ *  (基準値の計算に時間が掛かるので、同じ入力に対してカーネルを切り替える)
+ *
+ *  1件ごとに次の項目を1行に出力する。
+ *
+ *    engine kernel size signal max_err rms_err ns_per_op result
+ *
+ *  誤差は、基準値の絶対値の最大値に対する比。
+ *  エンジンごとの許容誤差を超えたものがあれば、終了コードを 1 とする。
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <complex.h>
+#include <time.h>
+#include "analysis.h"
+#include "fft.h"
+#include "codelet.h"
+#include "goertzel.h"
+#include "sdft.h"
+#include "cqt.h"
+#include "frame.h"
+#include "simd.h"
+
+//  基準値の計算に用いる円周率
+#define PI_L        3.141592653589793238462643383279502884L
+
+//  許容誤差(基準値の絶対値の最大値に対する比)
+#define TOL_FFT         1e-12   //  fft(), FFT プラン
+#define TOL_DFT         1e-12   //  dft()
+#define TOL_SDFT        1e-10   //  スライディング DFT(漸化式の誤差が蓄積する)
+#define TOL_GOERTZEL    1e-9    //  Goertzel(周波数の低いものほど誤差が大きい)
+#define TOL_FLOAT       1e-5    //  float 版の FFT プラン, dftf()
+#define TOL_CQT         1e-3    //  定 Q 変換(カーネルの小さい係数を捨てている)
+
+//  処理時間の計測で、最低限繰り返す時間(ナノ秒)
+#define MIN_TIME_NS     2e6
+
+//  信号の種類
+#define SIGNAL_MIXTURE  0   //  fft.c のサンプルプログラムと同じ混合波
+#define SIGNAL_RANDOM   1   //  -1 ～ 1 の一様乱数
+#define SIGNAL_IMPULSE  2   //  インパルス
+#define NUM_SIGNAL      3
+
+static const char *signal_name[NUM_SIGNAL] = { "mixture", "random", "impulse" };
+
+//  この CPU で使える SIMD カーネル
+static const SimdKernel *kernel[4];
+static int num_kernel = 0;
+
+//  許容誤差を超えたものの数
+static int num_failed = 0;
+
+
+//  malloc のラッパ関数
+//  確保に失敗した場合はエラー終了する。
+static void *_check_alloc(size_t size)
+{
+    void *ptr = malloc(size);
+    if (!ptr) {
+        perror("Failed to allocate memory for check");
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+
+//  信号を作る
+static void _make_signal(int type, double *x, size_t n)
+{
+    size_t t;
+
+    for (t = 0; t < n; t++) {
+        switch (type) {
+        case SIGNAL_MIXTURE:
+            x[t] =   sin(2 * M_PI * t * 3 / n) * 0.5
+                   + sin(2 * M_PI * t * 2 / n)
+                   + cos(2 * M_PI * t * 6 / n) * 0.4
+                   + sin(2 * M_PI * t * 6 / n) * 0.2;
+            break;
+        case SIGNAL_RANDOM:
+            x[t] = rand() / (double)RAND_MAX * 2 - 1;
+            break;
+        default:
+            x[t] = (t == 3) ? 1.0 : 0.0;
+            break;
+        }
+    }
+}
+
+
+/*
+ *  基準値：n 点の DFT の、0 ～ num_bin - 1 番目のビン
+ *
+ *    X[k] = Σ x[t] exp(-2πi k t / n)
+ *
+ *  long double で計算する。三角関数は k t mod n の表から引く。
+ */
+static long double complex *_reference(const double *x, size_t n, size_t num_bin)
+{
+    long double complex *X = _check_alloc(sizeof(long double complex) * num_bin);
+    long double *c = _check_alloc(sizeof(long double) * n);
+    long double *s = _check_alloc(sizeof(long double) * n);
+    size_t k, t;
+
+    for (t = 0; t < n; t++) {
+        c[t] = cosl(2 * PI_L * t / n);
+        s[t] = sinl(2 * PI_L * t / n);
+    }
+
+    for (k = 0; k < num_bin; k++) {
+        long double re = 0, im = 0;
+        size_t j = 0;   //  k t mod n
+
+        for (t = 0; t < n; t++) {
+            re += x[t] * c[j];
+            im -= x[t] * s[j];
+            j += k;
+            if (j >= n)
+                j -= n;
+        }
+        X[k] = re + im * I;
+    }
+
+    free(c);
+    free(s);
+    return X;
+}
+
+
+//  基準値：角周波数 w(ラジアン/サンプル)の DTFT の絶対値
+static long double _reference_dtft(const double *x, size_t n, long double w)
+{
+    long double re = 0, im = 0;
+    size_t t;
+
+    for (t = 0; t < n; t++) {
+        re += x[t] * cosl(w * t);
+        im -= x[t] * sinl(w * t);
+    }
+    return sqrtl(re * re + im * im);
+}
+
+
+//  現在の時刻(ナノ秒)
+static double _now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+//  run(ctx) の1回あたりの処理時間(ナノ秒)
+//  最後に実行した結果が ctx に残る。
+static double _time_ns(void (*run)(void *), void *ctx)
+{
+    double start = _now_ns(), elapsed;
+    long iter = 0;
+
+    do {
+        run(ctx);
+        iter++;
+        elapsed = _now_ns() - start;
+    } while (elapsed < MIN_TIME_NS);
+
+    return elapsed / iter;
+}
+
+
+/*
+ *  誤差を求める
+ *
+ *  X, mag のどちらか一方を指定する。
+ *    X   : 複素数の結果。基準値と直接比べる
+ *    mag : 絶対値の結果。基準値の絶対値と比べる
+ *
+ *  ref[first] ～ ref[first + num - 1] と、X[0] ～ X[num - 1](mag も同様)を比べる。
+ */
+static void _error(const complex *X, const double *mag, const long double complex *ref,
+                   size_t first, size_t num, double *max_err, double *rms_err)
+{
+    long double peak = 0, max = 0, sum = 0;
+    size_t k;
+
+    for (k = 0; k < num; k++) {
+        long double complex r = ref[first + k];
+        long double e = X ? cabsl(X[k] - r) : fabsl(mag[k] - cabsl(r));
+
+        if (peak < cabsl(r))
+            peak = cabsl(r);
+        if (max < e)
+            max = e;
+        sum += e * e;
+    }
+    if (peak == 0)
+        peak = 1;
+
+    *max_err = max / peak;
+    *rms_err = sqrtl(sum / num) / peak;
+}
+
+
+//  1件の結果を出力する
+static void _report(const char *engine, const char *kernel, size_t n, int signal,
+                    double max_err, double rms_err, double ns, double tol)
+{
+    int ok = max_err <= tol;
+
+    printf("%-14s %-7s %6zu %-8s %.3e %.3e %12.1f %s\n",
+           engine, kernel, n, signal_name[signal], max_err, rms_err, ns, ok ? "ok" : "FAIL");
+    if (!ok)
+        num_failed++;
+}
+
+
+//  float 版の結果を、_error() で比べられるように double に写す
+static complex *_widen(complex *dst, const float complex *src, size_t n)
+{
+    size_t k;
+
+    for (k = 0; k < n; k++)
+        dst[k] = src[k];
+    return dst;
+}
+
+
+/*
+ *  fft() : 1成分ずつ求める再帰版
+ */
+typedef struct {
+    int         log2n;
+    double      *x;
+    complex     *X;
+} FftRecursiveCheck;
+
+static void _run_fft_recursive(void *_ctx)
+{
+    FftRecursiveCheck *ctx = _ctx;
+    int k;
+
+    for (k = 0; k < (1 << ctx->log2n); k++)
+        ctx->X[k] = fft(k, ctx->log2n, ctx->x);
+}
+
+static void check_fft_recursive(void)
+{
+    static const int log2n[] = { 6, 10 };
+    FftRecursiveCheck ctx;
+    double max_err, rms_err, ns;
+    int i, sig;
+
+    for (i = 0; i < sizeof(log2n) / sizeof(log2n[0]); i++) {
+        size_t n = 1 << log2n[i];
+
+        ctx.log2n = log2n[i];
+        ctx.x = _check_alloc(sizeof(double) * n);
+        ctx.X = _check_alloc(sizeof(complex) * n);
+        for (sig = 0; sig < NUM_SIGNAL; sig++) {
+            _make_signal(sig, ctx.x, n);
+            long double complex *ref = _reference(ctx.x, n, n);
+
+            ns = _time_ns(_run_fft_recursive, &ctx);
+            _error(ctx.X, NULL, ref, 0, n, &max_err, &rms_err);
+            _report("fft_recursive", "-", n, sig, max_err, rms_err, ns, TOL_FFT);
+            free(ref);
+        }
+        free(ctx.x);
+        free(ctx.X);
+    }
+}
+
+
+/*
+ *  fft_plan_execute(), fftf_plan_execute() : 入力のコピーを含む
+ */
+typedef struct {
+    FftPlan     *plan;
+    FftfPlan    *planf;
+    size_t      n;
+    complex     *input;
+    complex     *X;
+    float complex *inputf;
+    float complex *Xf;
+} FftPlanCheck;
+
+static void _run_fft_plan(void *_ctx)
+{
+    FftPlanCheck *ctx = _ctx;
+
+    memcpy(ctx->X, ctx->input, sizeof(complex) * ctx->n);
+    fft_plan_execute(ctx->plan, ctx->X);
+}
+
+static void _run_fftf_plan(void *_ctx)
+{
+    FftPlanCheck *ctx = _ctx;
+
+    memcpy(ctx->Xf, ctx->inputf, sizeof(float complex) * ctx->n);
+    fftf_plan_execute(ctx->planf, ctx->Xf);
+}
+
+static void check_fft_plan(void)
+{
+    //  2 のべき乗(コードレットあり・なし)・混合基数・Bluestein(素数)
+    static const int size[] = { 64, 1024, 2048, 4096, 8192, 441, 4410, 1009, 4099 };
+    FftPlanCheck ctx;
+    double max_err, rms_err, ns;
+    double *x;
+    size_t t;
+    int i, k, sig, generic, num_variant;
+
+    for (i = 0; i < sizeof(size) / sizeof(size[0]); i++) {
+        ctx.n = size[i];
+        ctx.input = _check_alloc(sizeof(complex) * ctx.n);
+        ctx.X = _check_alloc(sizeof(complex) * ctx.n);
+        ctx.inputf = _check_alloc(sizeof(float complex) * ctx.n);
+        ctx.Xf = _check_alloc(sizeof(float complex) * ctx.n);
+        x = _check_alloc(sizeof(double) * ctx.n);
+
+        //  コードレットのあるサイズは、汎用のプランも検査する
+        num_variant = fft_codelet_find(ctx.n) ? 2 : 1;
+
+        for (sig = 0; sig < NUM_SIGNAL; sig++) {
+            _make_signal(sig, x, ctx.n);
+            for (t = 0; t < ctx.n; t++)
+                ctx.inputf[t] = ctx.input[t] = x[t];
+            long double complex *ref = _reference(x, ctx.n, ctx.n);
+
+            //  プランは、作成時のカーネルを使う
+            for (k = 0; k < num_kernel; k++) {
+                simd_set_kernel(kernel[k]);
+                for (generic = 0; generic < num_variant; generic++) {
+                    fft_codelet_enable(!generic);
+
+                    ctx.plan = fft_plan_new(ctx.n);
+                    ns = _time_ns(_run_fft_plan, &ctx);
+                    _error(ctx.X, NULL, ref, 0, ctx.n, &max_err, &rms_err);
+                    _report(generic ? "fft_generic" : "fft_plan", kernel[k]->name,
+                            ctx.n, sig, max_err, rms_err, ns, TOL_FFT);
+                    fft_plan_free(ctx.plan);
+
+                    ctx.planf = fftf_plan_new(ctx.n);
+                    ns = _time_ns(_run_fftf_plan, &ctx);
+                    _error(_widen(ctx.X, ctx.Xf, ctx.n), NULL, ref, 0, ctx.n, &max_err, &rms_err);
+                    _report(generic ? "fftf_generic" : "fftf_plan", kernel[k]->name,
+                            ctx.n, sig, max_err, rms_err, ns, TOL_FLOAT);
+                    fftf_plan_free(ctx.planf);
+                }
+                fft_codelet_enable(1);
+            }
+            free(ref);
+        }
+
+        free(x);
+        free(ctx.Xf);
+        free(ctx.inputf);
+        free(ctx.X);
+        free(ctx.input);
+    }
+}
+
+
+/*
+ *  fft_real_plan_execute(), fft_real_plan_execute_pcm() と、その float 版
+ */
+typedef struct {
+    FftRealPlan *plan;
+    FftfRealPlan *planf;
+    double      *x;
+    float       *xf;
+    short       *pcm;
+    complex     *X;
+    float complex *Xf;
+} FftRealCheck;
+
+static void _run_fft_real(void *_ctx)
+{
+    FftRealCheck *ctx = _ctx;
+
+    fft_real_plan_execute(ctx->plan, ctx->x, ctx->X);
+}
+
+static void _run_fft_real_pcm(void *_ctx)
+{
+    FftRealCheck *ctx = _ctx;
+
+    fft_real_plan_execute_pcm(ctx->plan, ctx->pcm, ctx->X);
+}
+
+static void _run_fftf_real(void *_ctx)
+{
+    FftRealCheck *ctx = _ctx;
+
+    fftf_real_plan_execute(ctx->planf, ctx->xf, ctx->Xf);
+}
+
+static void _run_fftf_real_pcm(void *_ctx)
+{
+    FftRealCheck *ctx = _ctx;
+
+    fftf_real_plan_execute_pcm(ctx->planf, ctx->pcm, ctx->Xf);
+}
+
+//  実数入力用プランを、double 版と float 版の両方で検査する
+static void _check_fft_real_plans(FftRealCheck *ctx, size_t n, int sig, int pcm,
+                                  const long double complex *ref)
+{
+    double max_err, rms_err, ns;
+    int k;
+
+    for (k = 0; k < num_kernel; k++) {
+        simd_set_kernel(kernel[k]);
+
+        ctx->plan = fft_real_plan_new(n);
+        ns = _time_ns(pcm ? _run_fft_real_pcm : _run_fft_real, ctx);
+        _error(ctx->X, NULL, ref, 0, n / 2 + 1, &max_err, &rms_err);
+        _report(pcm ? "fft_real_pcm" : "fft_real_plan", kernel[k]->name, n, sig,
+                max_err, rms_err, ns, TOL_FFT);
+        fft_real_plan_free(ctx->plan);
+
+        ctx->planf = fftf_real_plan_new(n);
+        ns = _time_ns(pcm ? _run_fftf_real_pcm : _run_fftf_real, ctx);
+        _error(_widen(ctx->X, ctx->Xf, n / 2 + 1), NULL, ref, 0, n / 2 + 1, &max_err, &rms_err);
+        _report(pcm ? "fftf_real_pcm" : "fftf_real_plan", kernel[k]->name, n, sig,
+                max_err, rms_err, ns, TOL_FLOAT);
+        fftf_real_plan_free(ctx->planf);
+    }
+}
+
+static void check_fft_real(void)
+{
+    //  奇数(1001)は、複素 FFT で代用する場合
+    static const int size[] = { 1024, 4096, 4410, 1001 };
+    FftRealCheck ctx;
+    size_t t;
+    int i, sig;
+
+    for (i = 0; i < sizeof(size) / sizeof(size[0]); i++) {
+        size_t n = size[i];
+
+        ctx.x = _check_alloc(sizeof(double) * n);
+        ctx.xf = _check_alloc(sizeof(float) * n);
+        ctx.pcm = _check_alloc(sizeof(short) * n);
+        ctx.X = _check_alloc(sizeof(complex) * (n / 2 + 1));
+        ctx.Xf = _check_alloc(sizeof(float complex) * (n / 2 + 1));
+
+        for (sig = 0; sig < NUM_SIGNAL; sig++) {
+            long double complex *ref;
+
+            //  float 版の入力は float に丸めたもの(丸めの誤差も含めて比べる)
+            _make_signal(sig, ctx.x, n);
+            for (t = 0; t < n; t++)
+                ctx.xf[t] = ctx.x[t];
+            ref = _reference(ctx.x, n, n / 2 + 1);
+            _check_fft_real_plans(&ctx, n, sig, 0, ref);
+            free(ref);
+
+            //  16bit PCM に量子化したものを入力とする
+            for (t = 0; t < n; t++) {
+                ctx.pcm[t] = lrint(ctx.x[t] * 16000);
+                ctx.x[t] = ctx.pcm[t];
+            }
+            ref = _reference(ctx.x, n, n / 2 + 1);
+            _check_fft_real_plans(&ctx, n, sig, 1, ref);
+            free(ref);
+        }
+
+        free(ctx.Xf);
+        free(ctx.X);
+        free(ctx.pcm);
+        free(ctx.xf);
+        free(ctx.x);
+    }
+}
+
+
+/*
+ *  fft_plan_execute_many(), fft_real_plan_execute_pcm_many() と、その float 版
+ *
+ *  3種類の信号を1サンプルずつ交互に並べ(istride = 3, idist = 1)、
+ *  まとめて変換した結果を、信号ごとに基準値と比べる。
+ *  処理時間は、1つの信号あたりの時間とする。
+ */
+typedef struct {
+    FftPlan     *plan;
+    FftfPlan    *planf;
+    FftRealPlan *real;
+    FftfRealPlan *realf;
+    size_t      n;
+    int         inplace;    //  インタリーブしたまま、その場で変換する
+    complex     *input;     //  インタリーブした入力
+    complex     *X;
+    float complex *inputf;
+    float complex *Xf;
+    short       *pcm;       //  インタリーブした 16bit PCM
+} FftManyCheck;
+
+static void _run_fft_many(void *_ctx)
+{
+    FftManyCheck *ctx = _ctx;
+    const int n = ctx->n;
+
+    if (ctx->inplace) {
+        memcpy(ctx->X, ctx->input, sizeof(complex) * n * NUM_SIGNAL);
+        fft_plan_execute_many(ctx->plan, NUM_SIGNAL, ctx->X, NUM_SIGNAL, 1, ctx->X, NUM_SIGNAL, 1);
+    } else {
+        fft_plan_execute_many(ctx->plan, NUM_SIGNAL, ctx->input, NUM_SIGNAL, 1, ctx->X, 1, n);
+    }
+}
+
+static void _run_fftf_many(void *_ctx)
+{
+    FftManyCheck *ctx = _ctx;
+    const int n = ctx->n;
+
+    if (ctx->inplace) {
+        memcpy(ctx->Xf, ctx->inputf, sizeof(float complex) * n * NUM_SIGNAL);
+        fftf_plan_execute_many(ctx->planf, NUM_SIGNAL, ctx->Xf, NUM_SIGNAL, 1, ctx->Xf, NUM_SIGNAL, 1);
+    } else {
+        fftf_plan_execute_many(ctx->planf, NUM_SIGNAL, ctx->inputf, NUM_SIGNAL, 1, ctx->Xf, 1, n);
+    }
+}
+
+static void _run_fft_real_many(void *_ctx)
+{
+    FftManyCheck *ctx = _ctx;
+
+    fft_real_plan_execute_pcm_many(ctx->real, NUM_SIGNAL, ctx->pcm, NUM_SIGNAL, 1, ctx->X, ctx->n / 2 + 1);
+}
+
+static void _run_fftf_real_many(void *_ctx)
+{
+    FftManyCheck *ctx = _ctx;
+
+    fftf_real_plan_execute_pcm_many(ctx->realf, NUM_SIGNAL, ctx->pcm, NUM_SIGNAL, 1, ctx->Xf, ctx->n / 2 + 1);
+}
+
+//  まとめて変換した結果を、信号ごとに基準値と比べる
+//  結果は、信号 sig の k 番目の成分が X[sig * dist + k * stride] にある。
+static void _report_many(const char *engine, const char *kernel, size_t n, const complex *X,
+                         int stride, int dist, long double complex **ref, size_t num_bin,
+                         double ns, double tol)
+{
+    complex *Y = _check_alloc(sizeof(complex) * num_bin);
+    double max_err, rms_err;
+    size_t k;
+    int sig;
+
+    for (sig = 0; sig < NUM_SIGNAL; sig++) {
+        for (k = 0; k < num_bin; k++)
+            Y[k] = X[sig * dist + k * stride];
+        _error(Y, NULL, ref[sig], 0, num_bin, &max_err, &rms_err);
+        _report(engine, kernel, n, sig, max_err, rms_err, ns / NUM_SIGNAL, tol);
+    }
+    free(Y);
+}
+
+static void check_fft_many(void)
+{
+    //  2 のべき乗・コードレット・混合基数(作業領域で並べ替え)・Bluestein・奇数の実数入力
+    static const int size[] = { 64, 1024, 441, 1009, 1001 };
+    long double complex *ref[NUM_SIGNAL], *ref_pcm[NUM_SIGNAL];
+    FftManyCheck ctx;
+    double *x;
+    double ns;
+    size_t t;
+    int i, k, sig;
+
+    for (i = 0; i < sizeof(size) / sizeof(size[0]); i++) {
+        const size_t n = size[i];
+        const size_t n2 = n / 2 + 1;
+
+        ctx.n = n;
+        ctx.input = _check_alloc(sizeof(complex) * n * NUM_SIGNAL);
+        ctx.X = _check_alloc(sizeof(complex) * n * NUM_SIGNAL);
+        ctx.inputf = _check_alloc(sizeof(float complex) * n * NUM_SIGNAL);
+        ctx.Xf = _check_alloc(sizeof(float complex) * n * NUM_SIGNAL);
+        ctx.pcm = _check_alloc(sizeof(short) * n * NUM_SIGNAL);
+        x = _check_alloc(sizeof(double) * n);
+
+        for (sig = 0; sig < NUM_SIGNAL; sig++) {
+            _make_signal(sig, x, n);
+            for (t = 0; t < n; t++)
+                ctx.inputf[t * NUM_SIGNAL + sig] = ctx.input[t * NUM_SIGNAL + sig] = x[t];
+            ref[sig] = _reference(x, n, n);
+
+            for (t = 0; t < n; t++) {
+                ctx.pcm[t * NUM_SIGNAL + sig] = lrint(x[t] * 16000);
+                x[t] = ctx.pcm[t * NUM_SIGNAL + sig];
+            }
+            ref_pcm[sig] = _reference(x, n, n2);
+        }
+
+        for (k = 0; k < num_kernel; k++) {
+            simd_set_kernel(kernel[k]);
+            ctx.plan = fft_plan_new(n);
+            ctx.planf = fftf_plan_new(n);
+            ctx.real = fft_real_plan_new(n);
+            ctx.realf = fftf_real_plan_new(n);
+
+            for (ctx.inplace = 0; ctx.inplace <= 1; ctx.inplace++) {
+                const int stride = ctx.inplace ? NUM_SIGNAL : 1;
+                const int dist = ctx.inplace ? 1 : n;
+
+                ns = _time_ns(_run_fft_many, &ctx);
+                _report_many(ctx.inplace ? "fft_many_inpl" : "fft_many", kernel[k]->name, n,
+                             ctx.X, stride, dist, ref, n, ns, TOL_FFT);
+                ns = _time_ns(_run_fftf_many, &ctx);
+                _report_many(ctx.inplace ? "fftf_many_inpl" : "fftf_many", kernel[k]->name, n,
+                             _widen(ctx.X, ctx.Xf, n * NUM_SIGNAL), stride, dist, ref, n, ns, TOL_FLOAT);
+            }
+
+            ns = _time_ns(_run_fft_real_many, &ctx);
+            _report_many("fft_real_many", kernel[k]->name, n, ctx.X, 1, n2, ref_pcm, n2, ns, TOL_FFT);
+            ns = _time_ns(_run_fftf_real_many, &ctx);
+            _report_many("fftf_real_many", kernel[k]->name, n, _widen(ctx.X, ctx.Xf, n2 * NUM_SIGNAL),
+                         1, n2, ref_pcm, n2, ns, TOL_FLOAT);
+
+            fftf_real_plan_free(ctx.realf);
+            fft_real_plan_free(ctx.real);
+            fftf_plan_free(ctx.planf);
+            fft_plan_free(ctx.plan);
+        }
+
+        for (sig = 0; sig < NUM_SIGNAL; sig++) {
+            free(ref[sig]);
+            free(ref_pcm[sig]);
+        }
+        free(x);
+        free(ctx.pcm);
+        free(ctx.Xf);
+        free(ctx.inputf);
+        free(ctx.X);
+        free(ctx.input);
+    }
+}
+
+
+/*
+ *  dft(), dftf() : 1 ～ n/2 番目のビンの絶対値
+ */
+typedef struct {
+    DftTable    table;
+    DftfTable   tablef;
+    double      *x;
+    float       *xf;
+    double      *mag;
+    int         num_bin;
+} DftCheck;
+
+static void _run_dft(void *_ctx)
+{
+    DftCheck *ctx = _ctx;
+
+    dft(ctx->x, ctx->table.size, ctx->mag, ctx->num_bin, &ctx->table);
+}
+
+static void _run_dftf(void *_ctx)
+{
+    DftCheck *ctx = _ctx;
+
+    dftf(ctx->xf, ctx->tablef.size, ctx->mag, ctx->num_bin, &ctx->tablef);
+}
+
+static void check_dft(void)
+{
+    static const int size[] = { 1024, 4410 };
+    DftCheck ctx;
+    double max_err, rms_err, ns;
+    size_t j;
+    int i, k, sig;
+
+    for (i = 0; i < sizeof(size) / sizeof(size[0]); i++) {
+        size_t n = size[i];
+
+        ctx.table.size = ctx.tablef.size = n;
+        ctx.table.cos = _check_alloc(sizeof(double) * n);
+        ctx.table.sin = _check_alloc(sizeof(double) * n);
+        ctx.tablef.cos = _check_alloc(sizeof(float) * n);
+        ctx.tablef.sin = _check_alloc(sizeof(float) * n);
+        for (j = 0; j < n; j++) {
+            ctx.tablef.cos[j] = ctx.table.cos[j] = cos(2 * M_PI * j / n);
+            ctx.tablef.sin[j] = ctx.table.sin[j] = sin(2 * M_PI * j / n);
+        }
+        ctx.num_bin = n / 2;
+        ctx.x = _check_alloc(sizeof(double) * n);
+        ctx.xf = _check_alloc(sizeof(float) * n);
+        ctx.mag = _check_alloc(sizeof(double) * ctx.num_bin);
+
+        for (sig = 0; sig < NUM_SIGNAL; sig++) {
+            _make_signal(sig, ctx.x, n);
+            for (j = 0; j < n; j++)
+                ctx.xf[j] = ctx.x[j];
+            long double complex *ref = _reference(ctx.x, n, ctx.num_bin + 1);
+
+            for (k = 0; k < num_kernel; k++) {
+                simd_set_kernel(kernel[k]);
+                ns = _time_ns(_run_dft, &ctx);
+                _error(NULL, ctx.mag, ref, 1, ctx.num_bin, &max_err, &rms_err);
+                _report("dft", kernel[k]->name, n, sig, max_err, rms_err, ns, TOL_DFT);
+
+                ns = _time_ns(_run_dftf, &ctx);
+                _error(NULL, ctx.mag, ref, 1, ctx.num_bin, &max_err, &rms_err);
+                _report("dftf", kernel[k]->name, n, sig, max_err, rms_err, ns, TOL_FLOAT);
+            }
+            free(ref);
+        }
+
+        free(ctx.mag);
+        free(ctx.xf);
+        free(ctx.x);
+        free(ctx.tablef.sin);
+        free(ctx.tablef.cos);
+        free(ctx.table.sin);
+        free(ctx.table.cos);
+    }
+}
+
+
+/*
+ *  スライディング DFT : 2n 個のサンプルを追加し、直近 n 個の DFT と比べる
+ *
+ *  再アンカーの間隔は、解析の既定値と同じく窓の長さの 16 倍とする。
+ *  (つまり、漸化式だけで 2n サンプル分を更新する)
+ */
+typedef struct {
+    SlidingDft  *sd;
+    double      *x;
+    size_t      n;
+} SdftCheck;
+
+static void _run_sdft(void *_ctx)
+{
+    SdftCheck *ctx = _ctx;
+
+    sliding_dft_reset(ctx->sd);
+    sliding_dft_push(ctx->sd, ctx->x, ctx->n * 2);
+}
+
+static void check_sdft(void)
+{
+    static const int size[] = { 441, 1024 };
+    SdftCheck ctx;
+    double max_err, rms_err, ns;
+    double *cos_table, *sin_table;
+    size_t j;
+    int i, k, sig;
+
+    for (i = 0; i < sizeof(size) / sizeof(size[0]); i++) {
+        size_t n = size[i];
+        int num_bin = n / 2;
+
+        cos_table = _check_alloc(sizeof(double) * n);
+        sin_table = _check_alloc(sizeof(double) * n);
+        for (j = 0; j < n; j++) {
+            cos_table[j] = cos(2 * M_PI * j / n);
+            sin_table[j] = sin(2 * M_PI * j / n);
+        }
+        ctx.n = n;
+        ctx.sd = sliding_dft_new(n, num_bin, cos_table, sin_table, n, n * 16);
+        ctx.x = _check_alloc(sizeof(double) * n * 2);
+
+        for (sig = 0; sig < NUM_SIGNAL; sig++) {
+            _make_signal(sig, ctx.x, n * 2);
+            long double complex *ref = _reference(ctx.x + n, n, num_bin + 1);
+
+            for (k = 0; k < num_kernel; k++) {
+                simd_set_kernel(kernel[k]);
+                ns = _time_ns(_run_sdft, &ctx);
+                _error(ctx.sd->X, NULL, ref, 1, num_bin, &max_err, &rms_err);
+                _report("sdft", kernel[k]->name, n, sig, max_err, rms_err, ns, TOL_SDFT);
+            }
+            free(ref);
+        }
+
+        free(ctx.x);
+        sliding_dft_free(ctx.sd);
+        free(sin_table);
+        free(cos_table);
+    }
+}
+
+
+/*
+ *  Goertzel フィルタバンク : 各音程の周波数の DTFT の絶対値と比べる
+ */
+typedef struct {
+    GoertzelBank *bank;
+    double      *x;
+    size_t      n;
+    double      *mag;
+} GoertzelCheck;
+
+static void _run_goertzel(void *_ctx)
+{
+    GoertzelCheck *ctx = _ctx;
+
+    goertzel_bank_process(ctx->bank, ctx->x, ctx->n, ctx->mag);
+}
+
+static void check_goertzel(void)
+{
+    static const int size[] = { 1024, 4410 };
+    const double sample_rate = 44100;
+    GoertzelCheck ctx;
+    double max_err, rms_err, ns;
+    int i, sig, b;
+
+    ctx.bank = goertzel_bank_new(sample_rate, 55, 8000, 0);
+    ctx.mag = _check_alloc(sizeof(double) * ctx.bank->num_note);
+
+    for (i = 0; i < sizeof(size) / sizeof(size[0]); i++) {
+        ctx.n = size[i];
+        ctx.x = _check_alloc(sizeof(double) * ctx.n);
+
+        for (sig = 0; sig < NUM_SIGNAL; sig++) {
+            long double complex *ref = _check_alloc(sizeof(long double complex) * ctx.bank->num_note);
+
+            _make_signal(sig, ctx.x, ctx.n);
+            for (b = 0; b < ctx.bank->num_note; b++)
+                ref[b] = _reference_dtft(ctx.x, ctx.n, 2 * PI_L * ctx.bank->freq[b] / sample_rate);
+
+            ns = _time_ns(_run_goertzel, &ctx);
+            _error(NULL, ctx.mag, ref, 0, ctx.bank->num_note, &max_err, &rms_err);
+            _report("goertzel", "-", ctx.n, sig, max_err, rms_err, ns, TOL_GOERTZEL);
+            free(ref);
+        }
+        free(ctx.x);
+    }
+
+    free(ctx.mag);
+    goertzel_bank_free(ctx.bank);
+}
+
+
+/*
+ *  cqt_kernel_apply() : 各ビンの時間領域のカーネルとの内積の絶対値
+ *
+ *  フレームの実数 FFT を含めて計測する。
+ *  基準値は、カーネルの窓関数と中心周波数から直接計算した内積。
+ *  インパルス(t = 3)は窓の端にあり、基準値がほとんど 0 となるので検査しない。
+ */
+typedef struct {
+    CqtKernel   *kernel;
+    FftRealPlan *plan;
+    double      *x;         //  フレーム(fft_size 個、frame_size より後ろは 0)
+    complex     *spectrum;
+    double      *mag;
+} CqtCheck;
+
+static void _run_cqt(void *_ctx)
+{
+    CqtCheck *ctx = _ctx;
+
+    fft_real_plan_execute(ctx->plan, ctx->x, ctx->spectrum);
+    cqt_kernel_apply(ctx->kernel, ctx->spectrum, ctx->mag);
+}
+
+//  基準値:ビン b の時間領域のカーネルとの内積
+static long double complex _reference_cqt(const CqtKernel *kernel, const double *x, int b,
+                                          double sample_rate)
+{
+    const int length = kernel->length[b];
+    const long double w = 2 * PI_L * kernel->freq[b] / sample_rate;
+    double *window = _check_alloc(sizeof(double) * length);
+    long double re = 0, im = 0, sum = 0;
+    int t;
+
+    window_make(window, length, kernel->window_type);
+    for (t = 0; t < length; t++) {
+        int pos = kernel->first[b] + t;
+        re  += x[pos] * window[t] * cosl(w * pos);
+        im  -= x[pos] * window[t] * sinl(w * pos);
+        sum += window[t];
+    }
+    free(window);
+    return (re + im * I) / sum;
+}
+
+static void check_cqt(void)
+{
+    static const int bins_per_octave[] = { 12, 48 };
+    const double sample_rate = 44100;
+    const size_t frame_size = 2205;
+    CqtCheck ctx;
+    double max_err, rms_err, ns;
+    char name[32];
+    int i, k, sig, b;
+
+    for (i = 0; i < sizeof(bins_per_octave) / sizeof(bins_per_octave[0]); i++) {
+        ctx.kernel = cqt_kernel_new(sample_rate, frame_size, 27.5, 8000, 0, bins_per_octave[i], WINDOW_HANN);
+        ctx.x = _check_alloc(sizeof(double) * ctx.kernel->fft_size);
+        ctx.spectrum = _check_alloc(sizeof(complex) * (ctx.kernel->fft_size / 2 + 1));
+        ctx.mag = _check_alloc(sizeof(double) * ctx.kernel->num_bin);
+        memset(ctx.x, 0, sizeof(double) * ctx.kernel->fft_size);
+        snprintf(name, sizeof(name), "cqt_b%d", bins_per_octave[i]);
+
+        for (sig = 0; sig < NUM_SIGNAL; sig++) {
+            if (sig == SIGNAL_IMPULSE)
+                continue;
+
+            long double complex *ref = _check_alloc(sizeof(long double complex) * ctx.kernel->num_bin);
+
+            _make_signal(sig, ctx.x, frame_size);
+            for (b = 0; b < ctx.kernel->num_bin; b++)
+                ref[b] = _reference_cqt(ctx.kernel, ctx.x, b, sample_rate);
+
+            for (k = 0; k < num_kernel; k++) {
+                simd_set_kernel(kernel[k]);
+                ctx.plan = fft_real_plan_new(ctx.kernel->fft_size);
+                ns = _time_ns(_run_cqt, &ctx);
+                _error(NULL, ctx.mag, ref, 0, ctx.kernel->num_bin, &max_err, &rms_err);
+                _report(name, kernel[k]->name, frame_size, sig, max_err, rms_err, ns, TOL_CQT);
+                fft_real_plan_free(ctx.plan);
+            }
+            free(ref);
+        }
+
+        free(ctx.mag);
+        free(ctx.spectrum);
+        free(ctx.x);
+        cqt_kernel_free(ctx.kernel);
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    static const char *kernel_name[] = { "scalar", "sse2", "avx2", "avx512" };
+    const SimdKernel *selected = simd_get_kernel();
+    int i;
+
+    printf("# engine kernel size signal max_err rms_err ns_per_op result\n");
+    srand(1);
+
+    //  SIMD カーネルを使わないもの
+    check_fft_recursive();
+    check_goertzel();
+
+    //  SIMD カーネルを使うもの
+    for (i = 0; i < sizeof(kernel_name) / sizeof(kernel_name[0]); i++) {
+        if ((kernel[num_kernel] = simd_find_kernel(kernel_name[i])) != NULL)
+            num_kernel++;
+        else
+            printf("# kernel %s is not supported on this CPU, skipped\n", kernel_name[i]);
+    }
+    check_fft_plan();
+    check_fft_real();
+    check_fft_many();
+    check_dft();
+    check_sdft();
+    check_cqt();
+    simd_set_kernel(selected);
+
+    if (num_failed > 0) {
+        printf("# %d check(s) exceeded the tolerance\n", num_failed);
+        return 1;
+    }
+    printf("# all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,50 @@
+/*
+ *  codelet.c
+ *
+ *  固定サイズの FFT(コードレット)の選択
+ *
+ *  コードレットの本体は、gen_codelet が生成する codelet_gen.c にある。
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "codelet.h"
+
+//  生成したコードレットの一覧(codelet_gen.c)
+extern const FftCodelet fft_codelet_table[];
+extern const int fft_num_codelet;
+
+//  コードレットを使うかどうか。-1 なら未設定(環境変数 DFT_CODELET に従う)
+static int codelet_enabled = -1;
+
+
+/*
+ *  変換サイズが n のコードレットを探す
+ */
+const FftCodelet *fft_codelet_find(int n)
+{
+    int i;
+
+    if (codelet_enabled < 0) {
+        const char *env = getenv("DFT_CODELET");
+        codelet_enabled = !(env && strcmp(env, "off") == 0);
+    }
+    if (!codelet_enabled)
+        return NULL;
+
+    for (i = 0; i < fft_num_codelet; i++) {
+        if (fft_codelet_table[i].n == n)
+            return &fft_codelet_table[i];
+    }
+    return NULL;
+}
+
+
+/*
+ *  コードレットを使うかどうかを設定する
+ */
+void fft_codelet_enable(int enable)
+{
+    codelet_enabled = enable ? 1 : 0;
+}
@@ -0,0 +1,60 @@
+/*
+ *  codelet.h
+ *
+ *  固定サイズの FFT(コードレット)
+ *
+ *  よく使うサイズ(1024, 2048, 4096, 8192)については、ビルド時に
+ *  gen_codelet で生成したコードで変換を行う。生成するコードでは、
+ *
+ *    - 並べ替えの組と回転因子を、定数のテーブルとして埋め込む
+ *    - 最初の 5 段(32 点ずつの変換)を、ループも添字の計算もない
+ *      直線的なコードに展開する。回転因子は即値となり、1 や -i との積は省く
+ *    - 残りの段は、段ごとに部分変換の長さと回転因子の位置を定数で与えて
+ *      SIMD カーネルのバタフライ演算を呼ぶ
+ *
+ *  fft_plan_new() は、サイズが一致するコードレットがあれば自動的にそれを使う。
+ *  演算の順序は汎用の FFT プランと同じだが、回転因子 -i との積を省くため、
+ *  結果の最下位の桁が異なることがある。
+ *
+ *  環境変数 DFT_CODELET に "off" を指定すると、コードレットを使わない。
+ *
+ */
+
+#ifndef __CODELET_H__
+#define __CODELET_H__
+
+#include <complex.h>
+#include "simd.h"
+
+
+//  FftCodelet 構造体
+typedef struct _fft_codelet {
+    int         n;          //  変換サイズ
+    void        (*execute)(complex *data, Radix2Func radix2);
+                            //  data(n 個)をその場で変換する。radix2 は後半の段に使うもの
+    void        (*executef)(float complex *data, Radix2fFunc radix2f);
+                            //  execute の float 版
+} FftCodelet;
+
+
+/*
+ *  変換サイズが n のコードレットを探す
+ *
+ *  戻値：
+ *    コードレット。該当するものがない場合や、使わないよう設定されている場合は NULL。
+ */
+const FftCodelet *fft_codelet_find(int n);
+
+
+/*
+ *  コードレットを使うかどうかを設定する
+ *
+ *  enable : 0 なら使わない
+ *
+ *  汎用のプランと比べる検査やベンチマークのためのもの。
+ *  変更は、以降に作成するプランから有効となる。
+ */
+void fft_codelet_enable(int enable);
+
+
+#endif  //  __CODELET_H__
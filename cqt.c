@@ -0,0 +1,214 @@
+/*
+ *  cqt.c
+ *
+ *  定 Q 変換(constant-Q transform)
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "cqt.h"
+#include "fft.h"
+#include "frame.h"
+
+//  ビンの周波数の基準(goertzel.c と同じ A1)
+#define HZ_A1       55.0
+
+//  時間領域のカーネルの最小の長さ(短すぎると窓関数が 0 だけになる)
+#define MIN_LENGTH  4
+
+
+//  realloc のラッパ関数
+//  確保に失敗した場合はエラー終了する。
+static void *_cqt_realloc(void *ptr, size_t size)
+{
+    ptr = realloc(ptr, size);
+    if (!ptr) {
+        perror("Failed to allocate memory for cqt kernel");
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+
+//  区間を追加する
+//  K[j] (lo <= j <= hi) を係数とする。mirror の場合は conj(K[n - j]) とする。
+static void _add_segment(CqtKernel *kernel, int bin, const complex *K, int n, int lo, int hi, int mirror)
+{
+    CqtSegment *seg;
+    int j;
+
+    kernel->segment = _cqt_realloc(kernel->segment, sizeof(CqtSegment) * (kernel->num_segment + 1));
+    seg = &kernel->segment[kernel->num_segment++];
+    seg->bin    = bin;
+    seg->start  = lo;
+    seg->length = hi - lo + 1;
+    seg->offset = kernel->num_coef;
+    seg->mirror = mirror;
+
+    kernel->coef = _cqt_realloc(kernel->coef, sizeof(complex) * (kernel->num_coef + seg->length));
+    for (j = lo; j <= hi; j++)
+        kernel->coef[kernel->num_coef++] = mirror ? conj(K[n - j]) : K[j];
+}
+
+
+//  |K[j]| >= threshold となる j の範囲(lo ～ hi)を求める
+//  mirror の場合は K[n - j] で判定する。該当するものがなければ 0 を返す。
+static int _find_range(const complex *K, int n, int from, int to, int mirror, double threshold,
+                       int *lo, int *hi)
+{
+    int j;
+
+    *lo = -1;
+    for (j = from; j <= to; j++) {
+        if (cabs(K[mirror ? n - j : j]) >= threshold) {
+            if (*lo < 0)
+                *lo = j;
+            *hi = j;
+        }
+    }
+    return *lo >= 0;
+}
+
+
+/*
+ *  カーネルを新規作成する
+ */
+CqtKernel *cqt_kernel_new(double sample_rate, size_t frame_size, double hz_low, double hz_high,
+                          double cents, int bins_per_octave, int window_type)
+{
+    const double Q = 1.0 / (pow(2.0, 1.0 / bins_per_octave) - 1);
+    CqtKernel *kernel;
+    FftPlan *plan;
+    complex *K;
+    double *window;
+    int low, high, n, i, t, lo, hi;
+
+    if (bins_per_octave < 1) {
+        fprintf(stderr, "cqt_kernel_new() : bins per octave [%d] is invalid.\n", bins_per_octave);
+        exit(EXIT_FAILURE);
+    }
+    if (hz_low <= 0 || hz_high < hz_low || hz_high >= sample_rate / 2) {
+        fprintf(stderr, "cqt_kernel_new() : invalid range %f - %f Hz\n", hz_low, hz_high);
+        exit(EXIT_FAILURE);
+    }
+
+    //  A1 から数えたビンの番号で、範囲内にある最小と最大のもの
+    double shift = cents / 1200 * bins_per_octave;
+    low  = ceil (bins_per_octave * log2(hz_low  / HZ_A1) - shift - 1e-9);
+    high = floor(bins_per_octave * log2(hz_high / HZ_A1) - shift + 1e-9);
+    if (high < low) {
+        fprintf(stderr, "cqt_kernel_new() : no bin in %f - %f Hz\n", hz_low, hz_high);
+        exit(EXIT_FAILURE);
+    }
+
+    n = 1;
+    while (n < frame_size)
+        n <<= 1;
+
+    kernel = _cqt_realloc(NULL, sizeof(CqtKernel));
+    memset(kernel, 0, sizeof(CqtKernel));
+    kernel->num_bin     = high - low + 1;
+    kernel->fft_size    = n;
+    kernel->frame_size  = frame_size;
+    kernel->window_type = window_type;
+    kernel->freq   = _cqt_realloc(NULL, sizeof(double) * kernel->num_bin);
+    kernel->length = _cqt_realloc(NULL, sizeof(int) * kernel->num_bin);
+    kernel->first  = _cqt_realloc(NULL, sizeof(int) * kernel->num_bin);
+    kernel->acc    = _cqt_realloc(NULL, sizeof(complex) * kernel->num_bin);
+
+    plan = fft_plan_new(n);
+    K = _cqt_realloc(NULL, sizeof(complex) * n);
+    window = _cqt_realloc(NULL, sizeof(double) * frame_size);
+
+    for (i = 0; i < kernel->num_bin; i++) {
+        double hz = HZ_A1 * pow(2.0, (low + i + shift) / bins_per_octave);
+        long length = lround(Q * sample_rate / hz);
+        double sum = 0, peak = 0;
+
+        if (length > (long)frame_size)
+            length = frame_size;
+        if (length < MIN_LENGTH)
+            length = (frame_size < MIN_LENGTH) ? frame_size : MIN_LENGTH;
+
+        kernel->freq[i]   = hz;
+        kernel->length[i] = length;
+        kernel->first[i]  = (frame_size - length) / 2;
+
+        //  時間領域のカーネル
+        window_make(window, length, window_type);
+        for (t = 0; t < length; t++)
+            sum += window[t];
+        memset(K, 0, sizeof(complex) * n);
+        for (t = 0; t < length; t++) {
+            int pos = kernel->first[i] + t;
+            K[pos] = window[t] / sum * cexp(2 * M_PI * I * hz * pos / sample_rate);
+        }
+
+        //  周波数領域のカーネル:内積 Σ x[t] conj(h[t]) = (1/n) Σ X[j] conj(H[j])
+        fft_plan_execute(plan, K);
+        for (t = 0; t < n; t++) {
+            K[t] = conj(K[t]) / n;
+            if (peak < cabs(K[t]))
+                peak = cabs(K[t]);
+        }
+
+        //  正の周波数側(0 ～ n/2)と、負の周波数側(実数入力の FFT の共役対称性から
+        //  spectrum[n - j] の共役として参照する)
+        if (_find_range(K, n, 0, n / 2, 0, peak * CQT_THRESHOLD, &lo, &hi))
+            _add_segment(kernel, i, K, n, lo, hi, 0);
+        if (_find_range(K, n, 1, n / 2 - 1, 1, peak * CQT_THRESHOLD, &lo, &hi))
+            _add_segment(kernel, i, K, n, lo, hi, 1);
+    }
+
+    free(window);
+    free(K);
+    fft_plan_free(plan);
+
+    return kernel;
+}
+
+
+/*
+ *  フレームの FFT 結果から、各ビンの値を求める
+ */
+void cqt_kernel_apply(CqtKernel *kernel, const complex *spectrum, double *result)
+{
+    int s, i, k;
+
+    for (k = 0; k < kernel->num_bin; k++)
+        kernel->acc[k] = 0;
+
+    for (s = 0; s < kernel->num_segment; s++) {
+        const CqtSegment *seg = &kernel->segment[s];
+        const complex *X = spectrum + seg->start;
+        const complex *c = kernel->coef + seg->offset;
+        complex sum = 0;
+
+        for (i = 0; i < seg->length; i++)
+            sum += X[i] * c[i];
+        kernel->acc[seg->bin] += seg->mirror ? conj(sum) : sum;
+    }
+
+    for (k = 0; k < kernel->num_bin; k++)
+        result[k] = cabs(kernel->acc[k]);
+}
+
+
+/*
+ *  カーネルを開放する
+ */
+void cqt_kernel_free(CqtKernel *kernel)
+{
+    if (kernel) {
+        free(kernel->freq);
+        free(kernel->length);
+        free(kernel->first);
+        free(kernel->segment);
+        free(kernel->coef);
+        free(kernel->acc);
+        free(kernel);
+    }
+}
@@ -0,0 +1,109 @@
+/*
+ *  cqt.h
+ *
+ *  定 Q 変換(constant-Q transform)
+ *
+ *  周波数が対数で等間隔(1オクターブあたり bins_per_octave 個)のビンを求める。
+ *  各ビンの帯域幅は中心周波数に比例し(Q = f / Δf が一定)、低音ほど長い窓で、
+ *  高音ほど短い窓で解析する。fg の周波数軸(2の対数)と同じく、どの音域にも
+ *  1オクターブあたり同じ数のビンを置く。
+ *
+ *  ビン k の値は、フレームと時間領域のカーネル
+ *
+ *    h_k[t] = w_k(t - t0_k) exp(2πi f_k t / fs) / Σ w_k    (t0_k <= t < t0_k + N_k)
+ *
+ *  の内積の絶対値。N_k = Q fs / f_k で、窓 w_k はフレームの中央に置く。
+ *  ただし N_k はフレームの長さを超えられないので、低音のビンでは Q が小さくなる。
+ *
+ *  内積はパーセバルの定理により、フレームの FFT とカーネルの FFT(周波数領域の
+ *  カーネル)の内積に等しい。周波数領域のカーネルは中心周波数の近くにしか
+ *  大きな値を持たないので、最大値の CQT_THRESHOLD 倍未満の係数を捨てて疎にしておく。
+ *  1フレームあたり、FFT を1回と、残った係数の数だけの積和で全ビンが求まる。
+ *
+ *  ビンの周波数は、goertzel モードと同じく A1 = 55Hz を基準とする。
+ *  bins_per_octave が 12 なら、平均律の各音程と一致する。
+ *
+ */
+
+#ifndef __CQT_H__
+#define __CQT_H__
+
+#include <stddef.h>
+#include <complex.h>
+
+//  周波数領域のカーネルで、係数を捨てるしきい値(各ビンの係数の最大値に対する比)
+#define CQT_THRESHOLD   1e-4
+
+
+//  周波数領域のカーネルの、連続した係数の区間
+//  結果のビン bin に Σ spectrum[start + i] coef[offset + i] (0 <= i < length) を加える。
+//  mirror が真の場合は、負の周波数側の係数なので、和の共役を加える。
+typedef struct _cqt_segment {
+    int         bin;
+    int         start;
+    int         length;
+    int         offset;
+    int         mirror;
+} CqtSegment;
+
+
+//  CqtKernel 構造体
+typedef struct _cqt_kernel {
+    int         num_bin;        //  ビンの数
+    int         fft_size;       //  フレームを変換する FFT のサイズ(2 のべき乗)
+    size_t      frame_size;     //  フレームのサンプル数
+    double      *freq;          //  各ビンの中心周波数(Hz)
+    int         *length;        //  各ビンの時間領域のカーネルの長さ N_k
+    int         *first;         //  各ビンの時間領域のカーネルの開始位置 t0_k
+    int         window_type;    //  窓関数の種類(WINDOW_*)
+
+    int         num_segment;    //  区間の数
+    CqtSegment  *segment;       //  区間(ビンの順)
+    int         num_coef;       //  係数の数
+    complex     *coef;          //  係数
+    complex     *acc;           //  ビンごとの和。作業領域
+} CqtKernel;
+
+
+/*
+ *  カーネルを新規作成する
+ *
+ *  引数：
+ *    sample_rate     : サンプリングレート
+ *    frame_size      : 1フレームのサンプル数
+ *    hz_low          : 解析する周波数の下限
+ *    hz_high         : 解析する周波数の上限(ナイキスト周波数未満)
+ *    cents           : 基準からのずれ(セント)。全ビンの周波数を 2^(cents / 1200) 倍する。
+ *    bins_per_octave : 1オクターブあたりのビンの数
+ *    window_type     : 時間領域のカーネルの窓関数(WINDOW_*)
+ *
+ *  FFT のサイズは、frame_size 以上の最小の 2 のべき乗とする。
+ */
+CqtKernel *cqt_kernel_new(double sample_rate, size_t frame_size, double hz_low, double hz_high,
+                          double cents, int bins_per_octave, int window_type);
+
+
+/*
+ *  フレームの FFT 結果から、各ビンの値を求める
+ *
+ *  引数：
+ *    kernel   : カーネル
+ *    spectrum : フレーム(fft_size 個、frame_size より後ろは 0)の実数 FFT の結果
+ *               (fft_real_plan_execute() の出力。fft_size / 2 + 1 個)
+ *    result   : 結果の格納先。num_bin 個の領域が必要。
+ *               各ビンの時間領域のカーネルとの内積の絶対値が入る。
+ *               振幅 a の正弦波は、おおよそ a / 2 となる。
+ *
+ *  作業領域として kernel 内部を書き換えるため、
+ *  同じ kernel を複数のスレッドから同時に使ってはならない。
+ */
+void cqt_kernel_apply(CqtKernel *kernel, const complex *spectrum, double *result);
+
+
+/*
+ *  カーネルを開放する
+ */
+void cqt_kernel_free(CqtKernel *kernel);
+
+
+#endif  //  __CQT_H__
@@ -2,12 +2,15 @@
  * dft.c
  * wavファイルに対してフーリエ解析を行い、結果を出力する
  *
- * wavファイルのフォーマットは、モノラル・16bitのみ。
+ * wavファイルのサンプルは、8/16/24/32bit 整数または 32/64bit 浮動小数点数。
+ * 複数のチャンネルがある場合は、全チャンネルの平均(または -C で指定したチャンネル)を解析する。
  *
  * 結果は標準出力に出力される。
  * 
  * 1行目は全体のサンプル数と、解析を行う各サンプルのサンプル間隔。
  * (カンマ区切り)
+ * 全体のサンプル数は、wavファイルに実際にあるサンプルフレーム数
+ * (ストリームとして書き出され、大きさの分からないファイルでは 0)。
  * 
  * 2行目以降は、解析対象のサンプル位置と、解析結果。
  * まずサンプル位置を1行で出力。
@@ -17,180 +20,623 @@
  * 
  * これを、サンプルの末尾まで繰り返す。
  *
+ * -f bin を指定した場合は、テキストの代わりに specfile.h のバイナリ形式で出力する。
+ * しきい値によらず全ビンの音量を固定長のレコードに格納する。
+ * 出力先がファイルの場合は、最後にフレーム数と最大音量をヘッダに書き戻す。
+ *
  * [使用例]
  *   dft test.wav
  *
+ * [オプション]
+ *   -m mode  : 解析モード。
+ *                dft      : 1Hz ごとに MAX_FREQ までの DFT を直接計算する(デフォルト)
+ *                fft      : 0 埋めしたフレームの FFT を行い、dft と同じビンを出力する。
+ *                goertzel : 平均律の各音程の周波数のみを Goertzel フィルタで求める。
+ *                           周波数は小数第2位まで出力し、しきい値によらず
+ *                           すべての音程について1行ずつ出力する。
+ *                cqt      : 定 Q 変換。-l ～ -u Hz の範囲に、1オクターブあたり -b 個の
+ *                           ビンを対数で等間隔に置く(fg の周波数軸と同じく、低音ほど細かい)。
+ *                           各ビンの窓の長さは周期の数が一定(ただし NUM_SAMPLE まで)。
+ *                           フレームごとに FFT を1回行い、疎なカーネルを掛けて求める。
+ *                           周波数は小数第2位まで出力する。窓関数のデフォルトは hann。
+ *   -w name  : 窓関数。rect, taper(デフォルト), hann, hamming, blackman
+ *   -p size  : 0 埋め後のフレーム長(サンプル数)。周波数の刻みは
+ *              SAMPLE_RATE / size Hz となる。デフォルトは SAMPLE_RATE / DELTA (1Hz 刻み)。
+ *   -j num   : 解析を num 個のスレッドで並行して行う。
+ *              出力の順序と内容はスレッド数によらず同じ。
+ *   -H hop   : フレームの間隔(サンプル数)。デフォルトは NUM_SAMPLE (重なりなし)。
+ *              hop < NUM_SAMPLE の場合、フレームは重なり合う。
+ *              2行目に出力するサンプル間隔も hop となる。
+ *   -m sdft  : スライディング DFT。dft モード(矩形窓)と同じビンを、
+ *              サンプルごとに O(ビン数) で更新する。hop が小さいほど有利。
+ *              窓関数は常に矩形窓となり、-j は無視される。
+ *   -a num   : sdft モードで、漸化式の誤差をリセットするため num サンプルごとに
+ *              DFT を直接計算し直す。デフォルトは NUM_SAMPLE の 16 倍。
+ *   -l hz    : goertzel, cqt モードで解析する周波数の下限(デフォルト 27.5Hz = A0)
+ *   -u hz    : goertzel, cqt モードで解析する周波数の上限(デフォルト 4186.01Hz = C8)
+ *   -c cents : goertzel, cqt モードで、平均律(A1 = 55Hz が基準)からのずれをセント単位で指定する。
+ *   -b num   : cqt モードで、1オクターブあたりのビンの数(デフォルト 12 = 半音ごと)。
+ *   -C ch    : 解析するチャンネル(0 から数える)。デフォルトは全チャンネルの平均。
+ *   -f fmt   : 出力形式。text(デフォルト)または bin。
+ *   --precision double|float :
+ *              dft, fft モードの変換エンジンの精度。デフォルトは double。
+ *              float は SIMD の1命令で2倍のデータを扱えるため速いが、誤差は
+ *              最大成分の 1e-6 倍程度になる(しきい値 MIN_AMP に比べれば十分小さい)。
+ *   --stats  : 終了時に、段階(読み込み・変換・解析・出力)ごとの経過時間と CPU 時間、
+ *              1秒あたりのフレーム数とバイト数を標準エラー出力に出力する。
+ *   --trace file : 各フレームの段階ごとの開始時刻と長さを、Chrome のトレースイベント
+ *              形式(JSON)で file に出力する。-j を指定した場合は、解析用のスレッドごとに
+ *              別の行として表示される。
+ *
+ * サンプリングレートは wavファイルのものを用いる。周波数の刻みなどの説明にある
+ * SAMPLE_RATE は、ファイルのサンプリングレートに読み替えること。
+ *
  */   
 
 #include "wavfile.h"
+#include "analysis.h"
+#include "pipeline.h"
+#include "specfile.h"
+#include "profile.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <getopt.h>
 #include <math.h>
 
-//  SAMPLE_RATE: サンプルレート
+//  SAMPLE_RATE: サンプルレート(wavファイルから得られない場合)
 #define SAMPLE_RATE 44100
 
 //  NUM_SAMPLE : 解析1回あたりのサンプル数
+//  DELTA      : 解析を行う周波数の粒度(Hz)
 #define DELTA       1
 #define NUM_SAMPLE  2205
 
 //  解析結果として得たい最高の周波数。
 #define MAX_FREQ    2000
 
-//  波形データの最大振幅。16bitなら32768でよい。
-#define MAX_SINT    32768
-
-#define PI          3.14159
-
 //  出力対象の音量のしきい値。
 //  これを超える音量を持つ結果のみ出力される。
 #define MIN_AMP     0.01
 
-#define NUM_REDUCE  10
+//  出力形式
+#define FORMAT_TEXT     0
+#define FORMAT_BIN      1
+
+//  長い名前のみのオプション
+#define OPT_STATS       256
+#define OPT_TRACE       257
+#define OPT_PRECISION   258
+
+
+static void usage(void)
+{
+    printf("Usage: dft [-m dft|fft|goertzel|sdft|cqt] [-w window] [-p pad_size] [-H hop] [-a anchor] [-l hz] [-u hz] [-c cents] [-b bins] [-C channel] [-f text|bin] [-j threads] [--precision double|float] [--stats] [--trace file] [filename] [max_size]\n");
+}
+
+
+//  読み込み・出力の状態
+typedef struct _dft_context {
+    WavData     *wav;
+    size_t      max_size;       //  解析するサンプル数の上限(-1 なら無制限)
+    size_t      hop;            //  フレームの間隔(サンプル数)
+    size_t      frame_bytes;    //  1サンプルフレーム(全チャンネル分)のバイト数
+    long        frame_ptr;      //  次に返すフレームの先頭のサンプル位置
+    unsigned char *frame;       //  frame_ptr から読み込み済みのサンプル
+    size_t      frame_len;      //  frame に読み込み済みのサンプル数
+
+    //  バイナリ形式(-f bin)の出力
+    SpecHeader  spec;           //  ヘッダ
+    int         spec_written;   //  ヘッダを出力済みかどうか
+    long        spec_pos;       //  ヘッダを出力した位置。-1 ならシークできない
+    unsigned char *record;      //  1レコード分の領域
+
+    //  --stats の集計用
+    long        num_frame;      //  出力したフレーム数
+    long        sample_end;     //  読み込んだサンプルの末尾の位置
+    double      bytes_out;      //  出力したバイト数
+} DftContext;
 
 
 /*
- * サンプル数が足りない場合に、十分な長さ(num_rep_sample)のサンプルを作成する。
+ *  wavファイルから num_sample 個のサンプルを読み飛ばす
+ */
+static void skip_data(WavData *wav, size_t num_sample)
+{
+    unsigned char tmp[8192];
+    const size_t max = sizeof(tmp) / wav->wBlockAlign;
+
+    while (num_sample > 0) {
+        size_t n = (num_sample < max) ? num_sample : max;
+        if (read_data(wav, tmp, n) < n)
+            break;
+        num_sample -= n;
+    }
+}
+
+
+/*
+ *  wavファイルから次のフレームを読み込む(FrameReader)
  *
- * 基本的には、元の波形を繰り返しつなげていき、要求されるサンプル数まで
- * 伸長する。
- * ただし、つなぎ目のところで急激な音量の変化が発生すると正しい解析が
- * 行えないため、つなぎ目部分の音量を抑えるようにする。
+ *  フレームは hop サンプルずつずらしながら切り出す。
+ *  ファイルをメモリにマップしている場合は、マップした領域を直接参照する。
+ *  そうでない場合は、前のフレームと重なる部分は読み込み済みのものを使い、
+ *  不足する分だけをファイルから読み込む。
+ */
+static size_t read_frame(void *_ctx, void *buf, size_t size, long *sample_point, const void **frame)
+{
+    DftContext *ctx = _ctx;
+
+    if (ctx->max_size != -1 && ctx->frame_ptr > ctx->max_size)
+        return 0;
+
+    //  メモリにマップしている場合は、コピーせずにその位置を返す
+    if (ctx->wav->samples) {
+        if (ctx->frame_ptr >= ctx->wav->numSamples)
+            return 0;
+
+        size_t rest = ctx->wav->numSamples - ctx->frame_ptr;
+        *frame = ctx->wav->samples + ctx->frame_ptr * ctx->frame_bytes;
+        *sample_point = ctx->frame_ptr;
+        ctx->frame_ptr += ctx->hop;
+        if (rest > size)
+            rest = size;
+        if (ctx->sample_end < *sample_point + (long)rest)
+            ctx->sample_end = *sample_point + rest;
+        return rest;
+    }
+
+    //  不足分を読み込む
+    if (ctx->frame_len < size) {
+        ctx->frame_len += read_data(ctx->wav, ctx->frame + ctx->frame_len * ctx->frame_bytes,
+                                    size - ctx->frame_len);
+    }
+    if (ctx->frame_len == 0)
+        return 0;
+
+    memcpy(buf, ctx->frame, ctx->frame_bytes * ctx->frame_len);
+    *frame = buf;
+    *sample_point = ctx->frame_ptr;
+
+    size_t num_read = ctx->frame_len;
+    if (ctx->sample_end < *sample_point + (long)num_read)
+        ctx->sample_end = *sample_point + num_read;
+
+    //  次のフレームの先頭まで進める
+    if (ctx->hop < ctx->frame_len) {
+        memmove(ctx->frame, ctx->frame + ctx->hop * ctx->frame_bytes,
+                ctx->frame_bytes * (ctx->frame_len - ctx->hop));
+        ctx->frame_len -= ctx->hop;
+    } else {
+        skip_data(ctx->wav, ctx->hop - ctx->frame_len);
+        ctx->frame_len = 0;
+    }
+    ctx->frame_ptr += ctx->hop;
+
+    return num_read;
+}
+
+
+/*
+ *  1フレーム分の解析結果を出力する(FrameWriter)
  *
- * sample         : 元のサンプルデータ
- * num_sample     : 元のサンプルデータのサンプル数
- * rep_sample     : 伸長したサンプルを格納する場所。領域はあらかじめ呼び出し元で確保すること。
- * num_rep_sample : 要求されるサンプル数。
+ *  goertzel モードでは全音程を、それ以外ではしきい値を超えるもののみを出力する。
+ *  goertzel, cqt モードでは、周波数を小数第2位まで出力する。
+ */
+static size_t print_result(void *_ctx, const Analysis *an, long sample_point, const double *result)
+{
+    DftContext *ctx = _ctx;
+    size_t written = 0;
+    int r;
+
+    //  サンプル位置
+    written += printf("#%ld\n", sample_point);
+
+    //  周波数＋音量 出力
+    for (r = 0; r < an->num_bin; r++) {
+        if (an->param.mode == MODE_GOERTZEL)
+            written += printf("%.2f %f\n", an->freq[r], result[r]);
+        else if (result[r] <= MIN_AMP)
+            continue;
+        else if (an->param.mode == MODE_CQT)
+            written += printf("%.2f %f\n", an->freq[r], result[r]);
+        else
+            written += printf("%d %f\n", (int)lround(an->freq[r]), result[r]);
+    }
+
+    //  空行で終了
+    written += printf("\n");
+
+    ctx->num_frame++;
+    ctx->bytes_out += written;
+    return written;
+}
+
+
+/*
+ *  バイナリ形式のヘッダと周波数テーブルを出力する
  *
+ *  an : 結果の形式(ビンの数や周波数)を表す Analysis オブジェクト
  */
-void make_repeated_sample
-(const short *sample, const size_t num_sample, short *rep_sample, size_t num_rep_sample)
+static void write_spec_header(DftContext *ctx, const Analysis *an)
 {
-    //  num_rep_sample : コピーが必要な残りサンプル数。 
-    while (num_rep_sample > 0) {
-        //  この回で実際にコピーするサンプル数
-        size_t num_copied = (num_sample < num_rep_sample) ? num_sample : num_rep_sample;
-
-        memcpy(rep_sample, sample, num_copied * sizeof(short));
-        
-        //  元サンプルの両側の音量を1/10にする。
-        //  (サンプルの切れ目をなめらかにするため)
-        int i;
-        for (i = 0; i < NUM_REDUCE; i++ ) {
-            double rate = i / 10;
-            if (i < num_copied) 
-                rep_sample[i] *= rate;
-            if (num_sample - i - 1 < num_copied) 
-                rep_sample[num_sample - i - 1] *= rate;
-        }
-        
-        rep_sample  += num_copied;
-        num_rep_sample -= num_copied;
+    SpecHeader *h = &ctx->spec;
+
+    h->mode         = an->param.mode;
+    h->frame_size   = an->param.frame_size;
+    h->sample_rate  = an->param.sample_rate;
+    h->num_bin      = an->num_bin;
+    h->record_size  = SPEC_RECORD_SIZE(an->num_bin);
+    h->bin_offset   = sizeof(SpecHeader);
+    h->frame_offset = h->bin_offset + sizeof(double) * an->num_bin;
+
+    ctx->spec_pos = ftell(stdout);
+    fwrite(h, sizeof(SpecHeader), 1, stdout);
+    fwrite(an->freq, sizeof(double), an->num_bin, stdout);
+
+    ctx->record = calloc(1, h->record_size);
+    if (!ctx->record) {
+        perror("Failed to allocate memory for record");
+        exit(EXIT_FAILURE);
     }
+    ctx->spec_written = 1;
+}
+
+
+/*
+ *  1フレーム分の解析結果をバイナリ形式で出力する(FrameWriter)
+ */
+static size_t write_record(void *_ctx, const Analysis *an, long sample_point, const double *result)
+{
+    DftContext *ctx = _ctx;
+    int64_t sp = sample_point;
+    float *amp;
+    int r;
+
+    if (!ctx->spec_written)
+        write_spec_header(ctx, an);
+
+    amp = (float *)(ctx->record + 8);
+    memcpy(ctx->record, &sp, 8);
+    for (r = 0; r < an->num_bin; r++) {
+        amp[r] = result[r];
+        if (ctx->spec.max_amp < amp[r])
+            ctx->spec.max_amp = amp[r];
+    }
+
+    if (fwrite(ctx->record, ctx->spec.record_size, 1, stdout) != 1) {
+        perror("Failed to write record");
+        exit(EXIT_FAILURE);
+    }
+    ctx->spec.num_frame++;
+
+    ctx->num_frame++;
+    ctx->bytes_out += ctx->spec.record_size;
+    return ctx->spec.record_size;
 }
 
 
 /*
- *  離散フーリエ解析を行う。
+ *  wavファイルにあるサンプルフレーム数
  *
- *  sample     : 解析対象のサンプルデータ
- *  num_sample : サンプルの数
- *  result     : 解析結果の格納先。
- *               double 型の配列であり、1Hz～max_freq Hzまでの解析結果を
- *               各要素に格納していく。
- *  max_freq   : 解析を行う上限の周波数
- *  delta      : 解析を行う周波数の粒度。
- *               例えば、max_freq = 2000, delta = 5 のとき、
- *               解析は 5Hz, 10Hz, ... , 1995Hz, 2000Hz となり,
- *               結果は result[0], result[1], ... result[399] に格納される。
+ *  大きさの分からないストリームの場合は 0 を返す。
+ */
+static long wav_num_samples(const WavData *wav)
+{
+    return (wav->numSamples == (size_t)-1) ? 0 : (long)wav->numSamples;
+}
+
+
+/*
+ *  バイナリ形式の出力を終える
  *
+ *  出力先がシークできる場合は、解析に使ったサンプル数、フレーム数と
+ *  最大音量をヘッダに書き戻す。
+ *  追記モード(>> でのリダイレクトなど)では、書き込みが常に末尾に行われ、
+ *  ヘッダの位置に書き戻せないため、何もしない。
  */
-void dft(short *sample, size_t num_sample, double *result, double max_freq, double delta) 
+static void finish_spec(DftContext *ctx, const AnalysisParam *param)
 {
-    double span_per_sample = 2 * PI / num_sample;   // 全体の長さを2πとしたときの、1サンプルあたりの横軸方向の長さ
-    int w, t;
-
-    //  もし十分なサンプル長が存在しない場合は、波形を繰り返して
-    //  1秒分のサンプルを作る
-    size_t num_rep_sample = SAMPLE_RATE;             
-    short *rep_sample = malloc(sizeof(short) * num_rep_sample);
-    
-    make_repeated_sample(sample, num_sample, rep_sample, num_rep_sample); 
-
-    for (w = 1; w <= max_freq / delta; w++) {
-        double real = 0.0, imag = 0.0;
-
-        for (t = 0; t < num_rep_sample; t++) {
-            double theta = w * span_per_sample * t;
-            real += rep_sample[t] * cos(theta);
-            imag += rep_sample[t] * sin(theta);
+    //  フレームが1つもなかった場合も、ヘッダだけは出力する
+    if (!ctx->spec_written) {
+        Analysis *an = analysis_new(param);
+        write_spec_header(ctx, an);
+        analysis_free(an);
+    }
+
+    fflush(stdout);
+    ctx->spec.num_sample = ctx->sample_end;
+
+    int flags = fcntl(fileno(stdout), F_GETFL);
+    if (ctx->spec_pos >= 0 && flags != -1 && !(flags & O_APPEND)
+            && fseek(stdout, ctx->spec_pos, SEEK_SET) == 0) {
+        if (fwrite(&ctx->spec, sizeof(SpecHeader), 1, stdout) != 1 || fflush(stdout) != 0) {
+            perror("Failed to write header");
+            exit(EXIT_FAILURE);
         }
-        real *= 2 * PI / num_rep_sample / MAX_SINT;
-        imag *= 2 * PI / num_rep_sample / MAX_SINT;
-        
-        result[w - 1] = sqrt(real * real + imag * imag);
-        printf("%d: %f\n", w-1, result[w-1]);
     }
 
-    free(rep_sample);
+    free(ctx->record);
 }
 
 
+/*
+ *  スライディング DFT による解析(sdft モード)
+ *
+ *  サンプルを hop 個ずつ追加し、そのたびに直近 NUM_SAMPLE 個の解析結果を出力する。
+ *  ファイルの末尾を越える部分は 0 で埋める。
+ *
+ *  profile が NULL でなければ、各段階の時間を "main" のレーンに記録する。
+ */
+static void run_sliding(DftContext *ctx, const AnalysisParam *param, FrameWriter writer, Profile *profile)
+{
+    Analysis *an = analysis_new(param);
+    size_t need = param->frame_size;    //  次の出力までに追加するサンプル数
+    long frame_ptr = 0;                 //  窓の先頭のサンプル位置
+    long num_real = 0;                  //  ファイルから読み込んだサンプル数
+    ProfileMark mark;
+    size_t written;
+    int eof = 0;
+
+    an->lane = profile_lane_new(profile, "main");
+
+    while (ctx->max_size == -1 || frame_ptr <= ctx->max_size) {
+        while (need > 0) {
+            size_t n = (need < param->frame_size) ? need : param->frame_size;
+            const void *src = ctx->frame;
+            size_t got = 0;
+
+            //  メモリにマップしている場合は、マップした領域から直接追加する
+            profile_begin(an->lane, &mark);
+            if (eof) {
+                got = 0;
+            } else if (ctx->wav->samples) {
+                size_t rest = ctx->wav->numSamples - num_real;
+                got = (rest < n) ? rest : n;
+                src = ctx->wav->samples + num_real * ctx->frame_bytes;
+            } else {
+                got = read_data(ctx->wav, ctx->frame, n);
+            }
+            profile_end(an->lane, &mark, PROFILE_READ, got * ctx->frame_bytes);
+
+            if (got < n)
+                eof = 1;
+            if (got > 0)
+                analysis_slide(an, src, got);
+            if (got < n)
+                analysis_slide(an, NULL, n - got);
+
+            num_real += got;
+            need -= n;
+        }
+
+        //  窓がファイルの末尾を越えたら終了
+        if (frame_ptr >= num_real)
+            break;
+
+        profile_begin(an->lane, &mark);
+        written = writer(ctx, an, frame_ptr, an->result);
+        profile_end(an->lane, &mark, PROFILE_OUTPUT, written);
+
+        frame_ptr += ctx->hop;
+        need = ctx->hop;
+        if (an->lane)
+            an->lane->frame++;
+    }
+
+    ctx->sample_end = num_real;
+    analysis_free(an);
+}
+
 
 int main(int argc, char *argv[])
 {
-    short buf[NUM_SAMPLE];
-    size_t max_size = -1;
+    DftContext ctx;
+    AnalysisParam param;
+    int num_thread = 1;
+    int channel = SAMPLE_MIX;
+    int format = FORMAT_TEXT;
+    FrameWriter writer;
+    Profile *profile = NULL;
+    const char *trace_path = NULL;
+    int stats = 0;
+    int window_given = 0;
+    int opt;
+
+    static const struct option long_options[] = {
+        { "stats", no_argument,       NULL, OPT_STATS },
+        { "trace", required_argument, NULL, OPT_TRACE },
+        { "precision", required_argument, NULL, OPT_PRECISION },
+        { NULL, 0, NULL, 0 }
+    };
+
+    analysis_param_init(&param);
+    param.sample_rate = SAMPLE_RATE;
+    param.frame_size  = NUM_SAMPLE;
+    param.pad_size    = 0;
+    param.max_freq    = MAX_FREQ;
+
+    ctx.hop = NUM_SAMPLE;
+
+    while ((opt = getopt_long(argc, argv, "m:w:p:l:u:c:b:C:f:j:H:a:", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'm':
+            if (strcmp(optarg, "dft") == 0)
+                param.mode = MODE_DFT;
+            else if (strcmp(optarg, "goertzel") == 0)
+                param.mode = MODE_GOERTZEL;
+            else if (strcmp(optarg, "fft") == 0)
+                param.mode = MODE_FFT;
+            else if (strcmp(optarg, "sdft") == 0)
+                param.mode = MODE_SDFT;
+            else if (strcmp(optarg, "cqt") == 0)
+                param.mode = MODE_CQT;
+            else {
+                fprintf(stderr, "Unknown mode: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'w':
+            if ((param.window_type = window_type_from_name(optarg)) < 0) {
+                fprintf(stderr, "Unknown window: %s\n", optarg);
+                return 1;
+            }
+            window_given = 1;
+            break;
+        case 'p':
+            param.pad_size = atol(optarg);
+            break;
+        case 'l':
+            param.hz_low = atof(optarg);
+            break;
+        case 'u':
+            param.hz_high = atof(optarg);
+            break;
+        case 'c':
+            param.cents = atof(optarg);
+            break;
+        case 'b':
+            if ((param.bins_per_octave = atoi(optarg)) < 1) {
+                fprintf(stderr, "Invalid bins per octave: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'C':
+            if ((channel = atoi(optarg)) < 0) {
+                fprintf(stderr, "Invalid channel: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'f':
+            if (strcmp(optarg, "text") == 0)
+                format = FORMAT_TEXT;
+            else if (strcmp(optarg, "bin") == 0)
+                format = FORMAT_BIN;
+            else {
+                fprintf(stderr, "Unknown output format: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'H':
+            if (atol(optarg) < 1) {
+                fprintf(stderr, "Invalid hop size: %s\n", optarg);
+                return 1;
+            }
+            ctx.hop = atol(optarg);
+            break;
+        case 'a':
+            param.anchor = atol(optarg);
+            break;
+        case 'j':
+            if ((num_thread = atoi(optarg)) < 1) {
+                fprintf(stderr, "Invalid number of threads: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case OPT_STATS:
+            stats = 1;
+            break;
+        case OPT_TRACE:
+            trace_path = optarg;
+            break;
+        case OPT_PRECISION:
+            if (strcmp(optarg, "double") == 0)
+                param.precision = PRECISION_DOUBLE;
+            else if (strcmp(optarg, "float") == 0)
+                param.precision = PRECISION_FLOAT;
+            else {
+                fprintf(stderr, "Unknown precision: %s\n", optarg);
+                return 1;
+            }
+            break;
+        default:
+            usage();
+            return 1;
+        }
+    }
+    argv += optind - 1;
+
+    //  cqt モードの窓関数は各ビンのカーネルに掛けるので、裾の小さいものを既定とする
+    //  (taper では周波数領域のカーネルが疎にならない)
+    if (param.mode == MODE_CQT && !window_given)
+        param.window_type = WINDOW_HANN;
 
     if (!argv[1]) {
-        printf("Usage: dft [filename]\n");
+        usage();
         return 1;
     }
+    ctx.max_size = -1;
     if (argv[2]) {
-        max_size = atoi(argv[2]);
+        ctx.max_size = atoi(argv[2]);
     }
 
-    //  wavファイル読み込み
-    WavData *wav = open_wavfile(argv[1]);
+    //  トレースの出力先を開けない場合は、解析を始める前に終了する
+    if (stats || trace_path)
+        profile = profile_new(trace_path);
 
-    //  データ全長(1サンプルは2bytes)
-    printf("%ld\n", wav->dataChunkSize / 2); 
-    
-    //  サンプル間隔
-    printf("%d\n", NUM_SAMPLE);
+    //  wavファイル読み込み
+    //  ファイル全体をメモリにマップし、サンプルをコピーせずに参照する
+    ctx.wav = open_wavfile_mmap(argv[1]);
+    wav_sample_format(ctx.wav, channel, &param.format);
+    if (channel != SAMPLE_MIX && channel >= ctx.wav->wChannels) {
+        fprintf(stderr, "Invalid channel: %d (%d channels)\n", channel, ctx.wav->wChannels);
+        return 1;
+    }
+    if (ctx.wav->dwSamplesPerSec > 0)
+        param.sample_rate = ctx.wav->dwSamplesPerSec;
+    if (param.pad_size == 0)
+        param.pad_size = param.sample_rate / DELTA;
+
+    ctx.frame_bytes = ctx.wav->wBlockAlign;
+    ctx.frame_ptr = 0;
+    ctx.frame_len = 0;
+    ctx.frame = malloc(ctx.frame_bytes * NUM_SAMPLE);
+    ctx.num_frame = 0;
+    ctx.sample_end = 0;
+    ctx.bytes_out = 0;
+
+    if (format == FORMAT_BIN) {
+        //  ヘッダの残りは、最初のフレームを出力するときに埋める
+        memset(&ctx.spec, 0, sizeof(SpecHeader));
+        memcpy(ctx.spec.magic, SPEC_MAGIC, SPEC_MAGIC_SIZE);
+        ctx.spec.version     = SPEC_VERSION;
+        ctx.spec.header_size = sizeof(SpecHeader);
+        ctx.spec.num_sample  = wav_num_samples(ctx.wav);
+        ctx.spec.hop         = ctx.hop;
+        ctx.spec_written     = 0;
+        ctx.spec_pos         = -1;
+        writer = write_record;
+    } else {
+        //  データ全長(サンプルフレーム数)
+        //  data チャンクの大きさではなく、実際に読めるサンプルフレーム数とする
+        printf("%ld\n", wav_num_samples(ctx.wav));
+
+        //  サンプル間隔
+        printf("%ld\n", (long)ctx.hop);
+        writer = print_result;
+    }
 
     //  解析 -> 結果出力
-    long current_ptr = 0;
-    size_t size;
-    double result[MAX_FREQ / DELTA];
-    while ((size = read_data(wav, buf, NUM_SAMPLE)) > 0) {  // size はサンプル数(not bytes)
-        //  サンプル位置
-        printf("#%ld\n", current_ptr);
-
-        //  フーリエ解析
-        dft(buf, size, result, MAX_FREQ, DELTA);
-        
-        //  周波数＋音量 出力
-        int r;
-        for (r = 0; r < MAX_FREQ / DELTA; r++) {
-            if (result[r] > MIN_AMP)
-                printf("%d %f\n", (r+1) * DELTA, result[r]);
-        }
-
-        //  空行で終了
-        printf("\n");
-
-        current_ptr += size;
-
-        if (max_size != -1 && current_ptr > max_size) 
-            break;
+    //  解析に必要な領域は、スレッドごとに一度だけ確保される
+    if (param.mode == MODE_SDFT)
+        run_sliding(&ctx, &param, writer, profile);
+    else
+        pipeline_run(&param, num_thread, read_frame, writer, &ctx, profile);
+
+    if (format == FORMAT_BIN)
+        finish_spec(&ctx, &param);
+
+    if (stats) {
+        fflush(stdout);
+        profile_report(profile, stderr, ctx.num_frame,
+                       (double)ctx.sample_end * ctx.frame_bytes, ctx.bytes_out);
     }
+    profile_free(profile);
 
-    close_wavfile(wav);
+    free(ctx.frame);
+    close_wavfile(ctx.wav);
 
     return 0;
 }
-
-
-
@@ -9,8 +9,13 @@
 #include <math.h>
 #include <complex.h>
 #include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include "fft.h"
+#include "simd.h"
+#include "codelet.h"
 
-#define     PI      3.14159
+#define     PI      M_PI
 #define     PI2     (PI * 2)
 
 /*
@@ -50,7 +55,7 @@ int bit_reverse(int n, int log2n)
  *
  *  実際にこの fft 関数が行うのは、1段階のFFTのみで、
  *  多段で実行するために、再帰呼び出しが行われている。
- *  TODO: 再帰を使わないほうが効率良さそうな気がするので、改良の余地あり。
+ *  1成分ごとに再帰を行うため、全周波数成分が必要な場合は fft_all() を使うこと。
  *
  *  n     : 求めたい周波数成分( 0 <= n < 2^log2n )
  *  depth : 段数。再帰呼び出しの途中で fft()関数の内部から呼び出されるのでない限り、
@@ -100,6 +105,156 @@ complex fft(int n, int log2n, double *data)
 }
 
 
+/*
+ *  FFT プラン
+ *
+ *  プランの実装は fft_impl.h にあり、double 版と float 版の2通りに
+ *  インクルードする。ここでは、両者に共通の定数と関数を定義する。
+ */
+
+//  混合基数 FFT で扱う基数の最大値
+#define FFT_MAX_RADIX   7
+
+//  段数の上限(int で表せるサイズなら 2 の 31 乗が最大)
+#define FFT_MAX_STAGE   32
+
+//  混合基数 FFT で扱う基数。大きいものから順に素因数分解に用いる
+static const int fft_radix_order[] = { 7, 5, 3, 2 };
+#define FFT_NUM_RADIX   (sizeof(fft_radix_order) / sizeof(fft_radix_order[0]))
+
+
+//  malloc のラッパ関数
+//  確保に失敗した場合はエラー終了する。
+static void *_fft_alloc(size_t size)
+{
+    void *ptr = malloc(size);
+    if (!ptr) {
+        perror("Failed to allocate memory for fft");
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+
+//  exp(-2πi num / den) を求める。
+//  num は den で割った余りにしてから計算するので、大きな値でも精度が落ちない。
+static complex _fft_root(long long num, long long den)
+{
+    double theta = - PI2 * (double)(num % den) / den;
+    return cos(theta) + sin(theta) * I;
+}
+
+
+/*
+ *  混合基数の並べ替え表を作成する。
+ *
+ *  最後の段(基数 p)は、入力を p 個おきに取り出した p 個の部分列の
+ *  FFT 結果を結合する。部分列 r の結果は out[r * m] ～ out[r * m + m - 1]
+ *  (m = n / p)に置かれるので、これを再帰的にたどって
+ *  各位置に入るべき入力の要素番号を求める。
+ *  基数がすべて 2 の場合は、ビット反転と同じになる。
+ */
+static void _fft_make_perm(int *out, int offset, int stride, int n, const int *radix, int num_stage)
+{
+    int p, m, r;
+
+    if (num_stage == 0) {
+        out[0] = offset;
+        return;
+    }
+
+    p = radix[num_stage - 1];
+    m = n / p;
+    for (r = 0; r < p; r++)
+        _fft_make_perm(out + r * m, offset + r * stride, stride * p, m, radix, num_stage - 1);
+}
+
+
+//  double 版(fft_plan_*, fft_real_plan_*)
+#define FFT_REAL            double
+#define FFT_COMPLEX         complex
+#define FFT_ID(name)        fft ## name
+#define FFT_PLAN            FftPlan
+#define FFT_PLAN_TAG        _fft_plan
+#define FFT_REAL_PLAN       FftRealPlan
+#define FFT_REAL_PLAN_TAG   _fft_real_plan
+#define FFT_RADIX2          radix2
+#define FFT_CODELET         execute
+#define FFT_CONJ            conj
+#define FFT_CREAL           creal
+#define FFT_CIMAG           cimag
+#include "fft_impl.h"
+#undef FFT_REAL
+#undef FFT_COMPLEX
+#undef FFT_ID
+#undef FFT_PLAN
+#undef FFT_PLAN_TAG
+#undef FFT_REAL_PLAN
+#undef FFT_REAL_PLAN_TAG
+#undef FFT_RADIX2
+#undef FFT_CODELET
+#undef FFT_CONJ
+#undef FFT_CREAL
+#undef FFT_CIMAG
+
+//  float 版(fftf_plan_*, fftf_real_plan_*)
+#define FFT_REAL            float
+#define FFT_COMPLEX         float complex
+#define FFT_ID(name)        fftf ## name
+#define FFT_PLAN            FftfPlan
+#define FFT_PLAN_TAG        _fftf_plan
+#define FFT_REAL_PLAN       FftfRealPlan
+#define FFT_REAL_PLAN_TAG   _fftf_real_plan
+#define FFT_RADIX2          radix2f
+#define FFT_CODELET         executef
+#define FFT_CONJ            conjf
+#define FFT_CREAL           crealf
+#define FFT_CIMAG           cimagf
+#include "fft_impl.h"
+#undef FFT_REAL
+#undef FFT_COMPLEX
+#undef FFT_ID
+#undef FFT_PLAN
+#undef FFT_PLAN_TAG
+#undef FFT_REAL_PLAN
+#undef FFT_REAL_PLAN_TAG
+#undef FFT_RADIX2
+#undef FFT_CODELET
+#undef FFT_CONJ
+#undef FFT_CREAL
+#undef FFT_CIMAG
+
+
+/*
+ *  2^log2n 個のデータ全体に対して高速フーリエ変換を行う。
+ *
+ *  fft() は周波数成分を1つずつ再帰で求めるが、こちらは
+ *  ビット反転による並べ替えを行ったあと、バタフライ演算を
+ *  1段ずつ反復的に適用し、全周波数成分を一度に求める。
+ *  計算量は O(N log N)。
+ *
+ *  呼び出しのたびにプランを作成するので、同じサイズの変換を
+ *  繰り返す場合は fft_plan_new() で作成したプランを使うこと。
+ *
+ *  log2n : 入力データの数を、2の対数表記したもの。
+ *  data  : 入力データを格納する配列の先頭アドレス。
+ *          2 ^ log2n 個の complex 型データが格納されていなければならない。
+ *          演算結果は同じ配列に上書きされ、data[k] が k 番目の周波数成分となる。
+ *
+ */
+void fft_all(int log2n, complex *data)
+{
+    if (log2n < 0 || log2n > 30) {
+        fprintf(stderr, "fft_all() : log2n [%d] is invalid.", log2n);
+        exit(1);
+    }
+
+    FftPlan *plan = fft_plan_new(1 << log2n);
+    fft_plan_execute(plan, data);
+    fft_plan_free(plan);
+}
+
+
 #ifdef FFT_SAMPLE
 /*
  * 以下はサンプルプログラム。
@@ -117,6 +272,7 @@ int main(int argc, char *argv[])
 {
     const int datasize = 1 << DATASIZE_LOG2;
     double *wavdata = malloc(sizeof(double) * datasize);
+    complex *spectrum = malloc(sizeof(complex) * datasize);
     int i;
 
     for (i=0; i < datasize; i++) {
@@ -126,16 +282,23 @@ int main(int argc, char *argv[])
                      + sin(PI2 * i * 6 / datasize) * 0.2
                      ;
         printf("Wavdata[%d] : %f\n", i, wavdata[i]);
+        spectrum[i] = wavdata[i];
     }
 
+    //  全周波数成分を一度に求める
+    FftPlan *plan = fft_plan_new(datasize);
+    fft_plan_execute(plan, spectrum);
+    fft_plan_free(plan);
+
     for (i=0; i < datasize / 2; i++) {
-        complex result = fft(i, DATASIZE_LOG2, wavdata);
+        complex result = spectrum[i];
         double real = creal(result);
         double imag = cimag(result);
         double size = sqrt(real * real + imag * imag);
         printf("F[%d] : %f\n", i, size );
     }
 
+    free(spectrum);
     free(wavdata);
     return 0;
 }
@@ -8,12 +8,14 @@
 #ifndef __FFT_H__
 #define __FFT_H__
 
+#include <complex.h>
+
 /* 
  *  高速フーリエ変換を行う。
  *
  *  実際にこの fft 関数が行うのは、1段階のFFTのみで、
  *  多段で実行するために、再帰呼び出しが行われている。
- *  TODO: 再帰を使わないほうが効率良さそうな気がするので、改良の余地あり。
+ *  1成分ごとに再帰を行うため、全周波数成分が必要な場合は fft_all() を使うこと。
  *
  *  n     : 求めたい周波数成分( 0 <= n < 2^log2n )
  *  log2n : 入力データの数を、2の対数表記したもの。
@@ -28,6 +30,187 @@
 complex fft(int n, int log2n, double *data);
 
 
+/*
+ *  2^log2n 個のデータ全体に対して高速フーリエ変換を行い、
+ *  全周波数成分を一度に求める。
+ *
+ *  ビット反転による並べ替えのあと、バタフライ演算を反復的に
+ *  適用する(再帰は使わない)。計算量は O(N log N)。
+ *
+ *  log2n : 入力データの数を、2の対数表記したもの。
+ *  data  : 入力データを格納する配列の先頭アドレス。
+ *          2 ^ log2n 個の complex 型データが格納されていなければならない。
+ *          演算結果は同じ配列に上書きされ、data[k] が k 番目の周波数成分となる。
+ *
+ */
+void fft_all(int log2n, complex *data);
+
+
+/*
+ *  FFT プラン
+ *
+ *  同じサイズの変換を繰り返し行うためのオブジェクト。
+ *  回転因子のテーブルと並べ替え表を作成時に一度だけ計算し、
+ *  fft_plan_execute() ではメモリ確保も三角関数の計算も行わない。
+ *
+ *  変換サイズは任意。2, 3, 5, 7 の積であれば混合基数の FFT を、
+ *  それ以外は Bluestein のアルゴリズム(chirp-z 変換)を用いる。
+ *  いずれも計算量は O(N log N)。
+ *
+ *  使用例：
+ *    FftPlan *plan = fft_plan_new(1024);
+ *    while (...) {
+ *        fft_plan_execute(plan, data);
+ *    }
+ *    fft_plan_free(plan);
+ */
+typedef struct _fft_plan FftPlan;
+
+/*
+ *  FFT プランを作成する
+ *
+ *  n : 変換サイズ(1以上)。
+ */
+FftPlan *fft_plan_new(int n);
+
+/*
+ *  プランに従い、data に対して高速フーリエ変換を行う。
+ *
+ *  data : 入力データ。plan の変換サイズ分の complex 型データが必要。
+ *         演算結果は同じ配列に上書きされ、data[k] が k 番目の周波数成分となる。
+ *
+ *  プラン内の作業領域を使うため、同じプランを複数のスレッドから
+ *  同時に使ってはならない。
+ */
+void fft_plan_execute(FftPlan *plan, complex *data);
+
+/*
+ *  複数のデータに対して、まとめて高速フーリエ変換を行う。
+ *  (FFTW の advanced インタフェースと同じ指定方法)
+ *
+ *  howmany : 変換するデータの数
+ *  in      : 入力データ。b 番目のデータの t 番目の要素は in[b * idist + t * istride]
+ *  out     : 結果の格納先。b 番目の結果の k 番目の成分は out[b * odist + k * ostride]
+ *
+ *  in と out は、同じ領域(in == out で、間隔もすべて同じ)でなければ重なってはならない。
+ *  入力を連続した領域に写してから変換する必要がなく、並べ替えと同時に取り出す。
+ *
+ *  例：連続した frames 個のフレーム(1フレーム n 個)を変換する
+ *    fft_plan_execute_many(plan, frames, data, 1, n, data, 1, n);
+ */
+void fft_plan_execute_many(FftPlan *plan, int howmany,
+                           const complex *in, int istride, int idist,
+                           complex *out, int ostride, int odist);
+
+/*
+ *  プランの変換サイズを返す。
+ */
+int fft_plan_size(const FftPlan *plan);
+
+/*
+ *  FFT プランを開放する。
+ */
+void fft_plan_free(FftPlan *plan);
+
+
+/*
+ *  実数入力用 FFT プラン
+ *
+ *  入力が実数(PCM データなど)の場合に使用する。
+ *  n 個の実数を n/2 個の複素数に詰めて n/2 点の FFT を行い、
+ *  その結果を分離することで、複素 FFT のおよそ半分の演算量で済む。
+ *  (n が奇数の場合は、n 点の複素 FFT で代用する)
+ *  実数入力の FFT 結果は共役対称なので、重複しない n/2 + 1 個の
+ *  周波数成分のみを出力する。
+ */
+typedef struct _fft_real_plan FftRealPlan;
+
+/*
+ *  実数入力用 FFT プランを作成する
+ *
+ *  n : 変換サイズ(1以上)。
+ */
+FftRealPlan *fft_real_plan_new(int n);
+
+/*
+ *  プランに従い、実数データ in に対して高速フーリエ変換を行う。
+ *
+ *  in  : 入力データ。plan の変換サイズ(n)個の実数データが必要。
+ *  out : 結果の格納先。n/2 + 1 個の complex 型の領域が必要。
+ *        out[k] が k 番目の周波数成分となる。
+ */
+void fft_real_plan_execute(FftRealPlan *plan, const double *in, complex *out);
+
+/*
+ *  fft_real_plan_execute() の、16bit PCM データを直接入力とするもの。
+ *  値の大きさは変換しない(-32768 ～ 32767 のまま扱う)。
+ */
+void fft_real_plan_execute_pcm(FftRealPlan *plan, const short *in, complex *out);
+
+/*
+ *  複数の実数データに対して、まとめて高速フーリエ変換を行う。
+ *
+ *  howmany : 変換するデータの数
+ *  in      : 入力データ。b 番目のデータの t 番目の要素は in[b * idist + t * istride]
+ *  out     : 結果の格納先。b 番目の結果は out[b * odist] から n/2 + 1 個
+ *
+ *  例：インタリーブされたステレオの PCM データ(n サンプルフレーム)を
+ *      チャンネルごとに変換する
+ *    fft_real_plan_execute_pcm_many(plan, 2, pcm, 2, 1, out, n / 2 + 1);
+ */
+void fft_real_plan_execute_many(FftRealPlan *plan, int howmany,
+                                const double *in, int istride, int idist,
+                                complex *out, int odist);
+void fft_real_plan_execute_pcm_many(FftRealPlan *plan, int howmany,
+                                    const short *in, int istride, int idist,
+                                    complex *out, int odist);
+
+/*
+ *  実数入力用プランの変換サイズを返す。
+ */
+int fft_real_plan_size(const FftRealPlan *plan);
+
+/*
+ *  実数入力用 FFT プランを開放する。
+ */
+void fft_real_plan_free(FftRealPlan *plan);
+
+
+/*
+ *  単精度(float)版
+ *
+ *  fftf_ で始まるものは、データと回転因子を float 型で持つ。
+ *  引数と動作は、同名の fft_ で始まるもの(double 版)と同じ。
+ *  1回の SIMD 演算で double 版の2倍の要素を扱え、メモリの読み書きも半分で済む。
+ *  誤差はおおよそ最大成分の 1e-6 倍程度なので、しきい値で切る
+ *  スペクトログラムには十分だが、基準値を求める場合は double 版を使うこと。
+ *
+ *  回転因子などのテーブルは double で計算してから float に丸める。
+ */
+typedef struct _fftf_plan FftfPlan;
+typedef struct _fftf_real_plan FftfRealPlan;
+
+FftfPlan *fftf_plan_new(int n);
+void fftf_plan_execute(FftfPlan *plan, float complex *data);
+void fftf_plan_execute_many(FftfPlan *plan, int howmany,
+                            const float complex *in, int istride, int idist,
+                            float complex *out, int ostride, int odist);
+int fftf_plan_size(const FftfPlan *plan);
+void fftf_plan_free(FftfPlan *plan);
+
+FftfRealPlan *fftf_real_plan_new(int n);
+void fftf_real_plan_execute(FftfRealPlan *plan, const float *in, float complex *out);
+void fftf_real_plan_execute_pcm(FftfRealPlan *plan, const short *in, float complex *out);
+void fftf_real_plan_execute_many(FftfRealPlan *plan, int howmany,
+                                 const float *in, int istride, int idist,
+                                 float complex *out, int odist);
+void fftf_real_plan_execute_pcm_many(FftfRealPlan *plan, int howmany,
+                                     const short *in, int istride, int idist,
+                                     float complex *out, int odist);
+int fftf_real_plan_size(const FftfRealPlan *plan);
+void fftf_real_plan_free(FftfRealPlan *plan);
+
+
 #endif  //  __FFT_H__
 
 
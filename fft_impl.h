@@ -0,0 +1,706 @@
+/*
+ *  fft_impl.h
+ *
+ *  FFT プランの実装(精度ごとのテンプレート)
+ *
+ *  fft.c から、double 版と float 版の2回インクルードする。
+ *  インクルードする前に、次のマクロを定義しておくこと。
+ *
+ *    FFT_REAL          : 実数の型(double, float)
+ *    FFT_COMPLEX       : 複素数の型(complex, float complex)
+ *    FFT_ID(name)      : 関数名に精度ごとの接頭辞を付ける(fft##name, fftf##name)
+ *    FFT_PLAN          : プランの型(FftPlan, FftfPlan)
+ *    FFT_PLAN_TAG      : プランの構造体タグ(_fft_plan, _fftf_plan)
+ *    FFT_REAL_PLAN     : 実数入力用プランの型(FftRealPlan, FftfRealPlan)
+ *    FFT_REAL_PLAN_TAG : 実数入力用プランの構造体タグ
+ *    FFT_RADIX2        : 基数2のバタフライ演算の、SimdKernel のメンバー名(radix2, radix2f)
+ *    FFT_CODELET       : コードレットの変換関数の、FftCodelet のメンバー名(execute, executef)
+ *    FFT_CONJ, FFT_CREAL, FFT_CIMAG : 複素数の関数(conj, conjf など)
+ *
+ *  回転因子などのテーブルは double で計算し、最後に FFT_REAL に丸める。
+ *  演算中に double へ昇格しないよう、定数は FFT_REAL にキャストして使う。
+ *
+ */
+
+
+/*
+ *  FFT プラン
+ *
+ *  同じサイズの変換を何度も行う場合に、回転因子(twiddle)のテーブルと
+ *  並べ替え表をあらかじめ作成しておくためのもの。
+ *  fft_plan_execute() の実行中には、メモリ確保も三角関数の計算も行わない。
+ *
+ *  変換サイズ n が 2, 3, 5, 7 の積で表される場合は混合基数の FFT を行う。
+ *  それ以外の素因数を含む場合は、Bluestein のアルゴリズム(chirp-z 変換)で
+ *  2のべき乗サイズの FFT による畳み込みに帰着させる。
+ */
+struct FFT_PLAN_TAG {
+    int         n;          //  変換サイズ
+    int         num_stage;  //  バタフライ演算の段数
+    int         radix[FFT_MAX_STAGE];       //  各段の基数
+    int         tw_offset[FFT_MAX_STAGE];   //  各段の回転因子の、twiddle 内での開始位置
+    int         num_swap;   //  並べ替えで入れ替える組の数(並べ替えが対合の場合)
+    int         *swap;      //  並べ替えで入れ替える要素番号の組(2個ずつ num_swap 組)
+    int         *perm;      //  並べ替え表(対合でない場合)。位置 i には入力の perm[i] 番目が入る
+    FFT_COMPLEX *twiddle;   //  回転因子。段ごとに連続して格納
+    FFT_COMPLEX *work;      //  作業領域
+    FFT_COMPLEX *batch;     //  出力の間隔が 1 でない場合の作業領域(必要になった時に確保)
+    void (*radix2)(FFT_COMPLEX *data, int n, int m, const FFT_COMPLEX *W);
+                            //  基数2のバタフライ演算(CPU に合わせて選んだもの)
+    const FftCodelet *codelet;  //  固定サイズのコードレット(ある場合のみ。テーブルは作らない)
+
+    //  Bluestein のアルゴリズムを使う場合のみ
+    FFT_PLAN    *conv;      //  畳み込みに使う 2 のべき乗サイズのプラン
+    FFT_COMPLEX *chirp;     //  exp(-πi k^2 / n)  (0 <= k < n)
+    FFT_COMPLEX *chirp_fft; //  畳み込みの相手(共役の chirp)の FFT 結果
+};
+
+
+//  混合基数 FFT のプランを作成する。n は 2, 3, 5, 7 の積でなければならない。
+static void FFT_ID(_plan_init_radix)(FFT_PLAN *plan)
+{
+    const int n = plan->n;
+    int i, j, r, s, rest, m, num_twiddle;
+
+    //  素因数分解。大きい基数から順に並べ、基数2の段を後ろにまとめる
+    plan->num_stage = 0;
+    rest = n;
+    for (i = 0; i < FFT_NUM_RADIX; i++) {
+        while (rest % fft_radix_order[i] == 0) {
+            plan->radix[plan->num_stage++] = fft_radix_order[i];
+            rest /= fft_radix_order[i];
+        }
+    }
+
+    //  並べ替え表
+    plan->perm = _fft_alloc(sizeof(int) * n);
+    _fft_make_perm(plan->perm, 0, 1, n, plan->radix, plan->num_stage);
+
+    //  並べ替えが対合(2回行うと元に戻る)なら、入れ替えの組だけを保持して
+    //  その場で並べ替える。そうでなければ作業領域を経由する。
+    for (i = 0; i < n; i++) {
+        if (plan->perm[plan->perm[i]] != i)
+            break;
+    }
+    if (i == n) {
+        plan->num_swap = 0;
+        plan->swap = _fft_alloc(sizeof(int) * (n + 1));
+        for (i = 0; i < n; i++) {
+            if (i < plan->perm[i]) {
+                plan->swap[plan->num_swap * 2]     = i;
+                plan->swap[plan->num_swap * 2 + 1] = plan->perm[i];
+                plan->num_swap++;
+            }
+        }
+        free(plan->perm);
+        plan->perm = NULL;
+    } else {
+        plan->work = _fft_alloc(sizeof(FFT_COMPLEX) * n);
+    }
+
+    //  回転因子のテーブル
+    //  基数 p、部分変換の長さ m の段について
+    //    twiddle[tw_offset + (r - 1) * m + j] = exp(-2πi r j / pm)  (1 <= r < p, 0 <= j < m)
+    //  基数2以外の段では、その後に p 点の DFT に使う exp(-2πi q / p) (0 <= q < p) を続ける。
+    num_twiddle = 0;
+    m = 1;
+    for (s = 0; s < plan->num_stage; s++) {
+        int p = plan->radix[s];
+        plan->tw_offset[s] = num_twiddle;
+        num_twiddle += (p - 1) * m + (p == 2 ? 0 : p);
+        m *= p;
+    }
+    plan->twiddle = _fft_alloc(sizeof(FFT_COMPLEX) * (num_twiddle > 0 ? num_twiddle : 1));
+
+    m = 1;
+    for (s = 0; s < plan->num_stage; s++) {
+        int p = plan->radix[s];
+        FFT_COMPLEX *W = plan->twiddle + plan->tw_offset[s];
+
+        for (r = 1; r < p; r++) {
+            for (j = 0; j < m; j++)
+                W[(r - 1) * m + j] = _fft_root((long long)r * j, p * m);
+        }
+        if (p != 2) {
+            for (j = 0; j < p; j++)
+                W[(p - 1) * m + j] = _fft_root(j, p);
+        }
+        m *= p;
+    }
+}
+
+
+//  Bluestein のアルゴリズムによるプランを作成する。
+//
+//  X[k] = c[k] Σ (x[t] c[t]) conj(c[k - t])   (c[k] = exp(-πi k^2 / n))
+//  より、x[t] c[t] と conj(c) の畳み込みを 2 のべき乗サイズの FFT で求める。
+static void FFT_ID(_plan_init_bluestein)(FFT_PLAN *plan)
+{
+    const int n = plan->n;
+    int m = 1, k;
+
+    while (m < 2 * n - 1)
+        m <<= 1;
+
+    plan->conv = FFT_ID(_plan_new)(m);
+    plan->work = _fft_alloc(sizeof(FFT_COMPLEX) * m);
+    plan->chirp = _fft_alloc(sizeof(FFT_COMPLEX) * n);
+    plan->chirp_fft = _fft_alloc(sizeof(FFT_COMPLEX) * m);
+
+    //  k^2 / 2n を 1 で割った余りにしてから三角関数を計算する
+    for (k = 0; k < n; k++)
+        plan->chirp[k] = _fft_root((long long)k * k, 2LL * n);
+
+    //  畳み込みの相手 conj(c[k]) を、負の添字は末尾から折り返して並べる。
+    //  逆変換時の 1/m の正規化もここに含めておく。
+    for (k = 0; k < m; k++)
+        plan->chirp_fft[k] = 0;
+    for (k = 0; k < n; k++) {
+        complex c = conj(_fft_root((long long)k * k, 2LL * n)) / m;
+        plan->chirp_fft[k] = c;
+        if (k > 0)
+            plan->chirp_fft[m - k] = c;
+    }
+    FFT_ID(_plan_execute)(plan->conv, plan->chirp_fft);
+}
+
+
+/*
+ *  FFT プランを作成する
+ *
+ *  n : 変換サイズ(1以上)。
+ *      コードレットのあるサイズ(codelet.h)はそれを、
+ *      2, 3, 5, 7 の積であれば混合基数の FFT、
+ *      それ以外は Bluestein のアルゴリズムを用いる。
+ */
+FFT_PLAN *FFT_ID(_plan_new)(int n)
+{
+    FFT_PLAN *plan;
+    int rest, i;
+
+    if (n < 1) {
+        fprintf(stderr, "%s() : size [%d] is invalid.\n", __func__, n);
+        exit(EXIT_FAILURE);
+    }
+
+    plan = _fft_alloc(sizeof(FFT_PLAN));
+    memset(plan, 0, sizeof(FFT_PLAN));
+    plan->n = n;
+    plan->radix2 = simd_get_kernel()->FFT_RADIX2;
+
+    plan->codelet = fft_codelet_find(n);
+    if (plan->codelet)
+        return plan;
+
+    //  2, 3, 5, 7 以外の素因数を含むかどうか
+    rest = n;
+    for (i = 0; i < FFT_NUM_RADIX; i++) {
+        while (rest % fft_radix_order[i] == 0)
+            rest /= fft_radix_order[i];
+    }
+
+    if (rest == 1)
+        FFT_ID(_plan_init_radix)(plan);
+    else
+        FFT_ID(_plan_init_bluestein)(plan);
+
+    return plan;
+}
+
+
+//  基数3のバタフライ演算(1段分)
+static void FFT_ID(_radix3)(FFT_COMPLEX *data, int n, int m, const FFT_COMPLEX *W)
+{
+    const FFT_COMPLEX *W1 = W;
+    const FFT_COMPLEX *W2 = W + m;
+    const FFT_REAL s3 = - sqrt(0.75);       //  sin(-2π/3)
+    const FFT_REAL half = 0.5;
+    int j, k;
+
+    for (k = 0; k < n; k += 3 * m) {
+        for (j = 0; j < m; j++) {
+            FFT_COMPLEX x0 = data[k + j];
+            FFT_COMPLEX x1 = data[k + j + m]     * W1[j];
+            FFT_COMPLEX x2 = data[k + j + 2 * m] * W2[j];
+
+            FFT_COMPLEX sum  = x1 + x2;
+            FFT_COMPLEX diff = (x1 - x2) * s3 * I;
+            FFT_COMPLEX base = x0 - half * sum;
+
+            data[k + j]         = x0 + sum;
+            data[k + j + m]     = base + diff;
+            data[k + j + 2 * m] = base - diff;
+        }
+    }
+}
+
+
+//  基数5のバタフライ演算(1段分)
+static void FFT_ID(_radix5)(FFT_COMPLEX *data, int n, int m, const FFT_COMPLEX *W)
+{
+    const FFT_REAL c1 = cos(PI2 / 5), c2 = cos(PI2 * 2 / 5);
+    const FFT_REAL s1 = - sin(PI2 / 5), s2 = - sin(PI2 * 2 / 5);
+    int j, k;
+
+    for (k = 0; k < n; k += 5 * m) {
+        for (j = 0; j < m; j++) {
+            FFT_COMPLEX x0 = data[k + j];
+            FFT_COMPLEX x1 = data[k + j + m]     * W[j];
+            FFT_COMPLEX x2 = data[k + j + 2 * m] * W[m + j];
+            FFT_COMPLEX x3 = data[k + j + 3 * m] * W[2 * m + j];
+            FFT_COMPLEX x4 = data[k + j + 4 * m] * W[3 * m + j];
+
+            FFT_COMPLEX a1 = x1 + x4, b1 = x1 - x4;
+            FFT_COMPLEX a2 = x2 + x3, b2 = x2 - x3;
+
+            FFT_COMPLEX r1 = x0 + c1 * a1 + c2 * a2;
+            FFT_COMPLEX r2 = x0 + c2 * a1 + c1 * a2;
+            FFT_COMPLEX i1 = (s1 * b1 + s2 * b2) * I;
+            FFT_COMPLEX i2 = (s2 * b1 - s1 * b2) * I;
+
+            data[k + j]         = x0 + a1 + a2;
+            data[k + j + m]     = r1 + i1;
+            data[k + j + 4 * m] = r1 - i1;
+            data[k + j + 2 * m] = r2 + i2;
+            data[k + j + 3 * m] = r2 - i2;
+        }
+    }
+}
+
+
+//  任意の基数 p のバタフライ演算(1段分)
+//  W の後ろには、p 点の DFT に使う exp(-2πi q / p) が格納されている。
+static void FFT_ID(_radix_generic)(FFT_COMPLEX *data, int n, int m, int p, const FFT_COMPLEX *W)
+{
+    const FFT_COMPLEX *root = W + (p - 1) * m;
+    FFT_COMPLEX x[FFT_MAX_RADIX];
+    int j, k, q, r;
+
+    for (k = 0; k < n; k += p * m) {
+        for (j = 0; j < m; j++) {
+            x[0] = data[k + j];
+            for (r = 1; r < p; r++)
+                x[r] = data[k + j + r * m] * W[(r - 1) * m + j];
+
+            for (q = 0; q < p; q++) {
+                FFT_COMPLEX sum = x[0];
+                int idx = 0;
+                for (r = 1; r < p; r++) {
+                    idx += q;
+                    if (idx >= p)
+                        idx -= p;
+                    sum += x[r] * root[idx];
+                }
+                data[k + j + q * m] = sum;
+            }
+        }
+    }
+}
+
+
+//  混合基数 FFT のバタフライ演算を行う(並べ替えは済んでいるものとする)
+static void FFT_ID(_execute_stages)(FFT_PLAN *plan, FFT_COMPLEX *data)
+{
+    const int n = plan->n;
+    int s, m;
+
+    //  m は部分変換の長さ
+    m = 1;
+    for (s = 0; s < plan->num_stage; s++) {
+        int p = plan->radix[s];
+        const FFT_COMPLEX *W = plan->twiddle + plan->tw_offset[s];
+
+        switch (p) {
+        case 2:
+            plan->radix2(data, n, m, W);
+            break;
+        case 3:
+            FFT_ID(_radix3)(data, n, m, W);
+            break;
+        case 5:
+            FFT_ID(_radix5)(data, n, m, W);
+            break;
+        default:
+            FFT_ID(_radix_generic)(data, n, m, p, W);
+            break;
+        }
+        m *= p;
+    }
+}
+
+
+//  混合基数 FFT を実行する
+static void FFT_ID(_execute_radix)(FFT_PLAN *plan, FFT_COMPLEX *data)
+{
+    const int n = plan->n;
+    int i;
+
+    //  並べ替え
+    if (plan->perm) {
+        memcpy(plan->work, data, sizeof(FFT_COMPLEX) * n);
+        for (i = 0; i < n; i++)
+            data[i] = plan->work[plan->perm[i]];
+    } else {
+        for (i = 0; i < plan->num_swap; i++) {
+            int a = plan->swap[i * 2];
+            int b = plan->swap[i * 2 + 1];
+            FFT_COMPLEX tmp = data[a];
+            data[a] = data[b];
+            data[b] = tmp;
+        }
+    }
+
+    FFT_ID(_execute_stages)(plan, data);
+}
+
+
+//  Bluestein のアルゴリズムで FFT を実行する
+static void FFT_ID(_execute_bluestein)(FFT_PLAN *plan, FFT_COMPLEX *data)
+{
+    const int n = plan->n;
+    const int m = plan->conv->n;
+    FFT_COMPLEX *work = plan->work;
+    int k;
+
+    for (k = 0; k < n; k++)
+        work[k] = data[k] * plan->chirp[k];
+    for (k = n; k < m; k++)
+        work[k] = 0;
+
+    //  畳み込み。逆変換は共役をとって順変換で行う
+    FFT_ID(_plan_execute)(plan->conv, work);
+    for (k = 0; k < m; k++)
+        work[k] = FFT_CONJ(work[k] * plan->chirp_fft[k]);
+    FFT_ID(_plan_execute)(plan->conv, work);
+
+    for (k = 0; k < n; k++)
+        data[k] = FFT_CONJ(work[k]) * plan->chirp[k];
+}
+
+
+/*
+ *  プランに従い、data に対して高速フーリエ変換を行う。
+ *
+ *  plan : fft_plan_new() で作成したプラン
+ *  data : 入力データ。plan の変換サイズ分の complex 型データが必要。
+ *         演算結果は同じ配列に上書きされ、data[k] が k 番目の周波数成分となる。
+ *
+ *  plan 内の作業領域を使うため、同じプランを複数のスレッドから
+ *  同時に使ってはならない。
+ */
+void FFT_ID(_plan_execute)(FFT_PLAN *plan, FFT_COMPLEX *data)
+{
+    if (plan->codelet)
+        plan->codelet->FFT_CODELET(data, plan->radix2);
+    else if (plan->conv)
+        FFT_ID(_execute_bluestein)(plan, data);
+    else
+        FFT_ID(_execute_radix)(plan, data);
+}
+
+
+/*
+ *  複数のデータに対して、まとめて高速フーリエ変換を行う。
+ *
+ *  plan    : fft_plan_new() で作成したプラン
+ *  howmany : 変換するデータの数
+ *  in      : 入力データ。b 番目のデータの t 番目の要素は in[b * idist + t * istride]
+ *  out     : 結果の格納先。b 番目の結果の k 番目の成分は out[b * odist + k * ostride]
+ *
+ *  in と out は、同じ領域(in == out で、間隔もすべて同じ)でなければ重なってはならない。
+ *  並べ替えを作業領域で行うプランでは、入力の取り出しと並べ替えを同時に行う。
+ *  ostride が 1 でない場合は、作業領域で変換してから書き出す。
+ *  この作業領域は最初の呼び出しの時に確保する。
+ */
+void FFT_ID(_plan_execute_many)(FFT_PLAN *plan, int howmany,
+                                const FFT_COMPLEX *in, int istride, int idist,
+                                FFT_COMPLEX *out, int ostride, int odist)
+{
+    const int n = plan->n;
+    int b, i;
+
+    if (ostride != 1 && !plan->batch)
+        plan->batch = _fft_alloc(sizeof(FFT_COMPLEX) * n);
+
+    for (b = 0; b < howmany; b++) {
+        const FFT_COMPLEX *src = in + (ptrdiff_t)b * idist;
+        FFT_COMPLEX *dst = out + (ptrdiff_t)b * odist;
+        FFT_COMPLEX *data = (ostride == 1) ? dst : plan->batch;
+
+        if (src == data && istride == 1) {
+            FFT_ID(_plan_execute)(plan, data);
+        } else if (plan->perm) {
+            for (i = 0; i < n; i++)
+                data[i] = src[(ptrdiff_t)plan->perm[i] * istride];
+            FFT_ID(_execute_stages)(plan, data);
+        } else {
+            for (i = 0; i < n; i++)
+                data[i] = src[(ptrdiff_t)i * istride];
+            FFT_ID(_plan_execute)(plan, data);
+        }
+
+        if (data != dst) {
+            for (i = 0; i < n; i++)
+                dst[(ptrdiff_t)i * ostride] = data[i];
+        }
+    }
+}
+
+
+/*
+ *  プランの変換サイズを返す。
+ */
+int FFT_ID(_plan_size)(const FFT_PLAN *plan)
+{
+    return plan->n;
+}
+
+
+/*
+ *  FFT プランを開放する。
+ */
+void FFT_ID(_plan_free)(FFT_PLAN *plan)
+{
+    if (plan) {
+        FFT_ID(_plan_free)(plan->conv);
+        free(plan->swap);
+        free(plan->perm);
+        free(plan->twiddle);
+        free(plan->work);
+        free(plan->batch);
+        free(plan->chirp);
+        free(plan->chirp_fft);
+        free(plan);
+    }
+}
+
+
+/*
+ *  実数入力用 FFT プラン
+ *
+ *  n 個の実数データを n/2 個の複素数データとみなして(偶数番目を実部、
+ *  奇数番目を虚部に詰める) n/2 点の FFT を行い、その結果を分離して
+ *  n 点の実数 FFT の結果を得る。
+ *  実数入力の FFT 結果は共役対称であるため、重複しない n/2 + 1 個の
+ *  周波数成分のみを出力する。
+ *
+ *  n が奇数の場合は詰め込みができないので、n 点の複素 FFT をそのまま行う。
+ */
+struct FFT_REAL_PLAN_TAG {
+    int         n;          //  変換サイズ(実数データの個数)
+    FFT_PLAN    *half;      //  n/2 点の複素 FFT プラン(n が偶数の場合)
+    FFT_COMPLEX *twiddle;   //  分離に用いる回転因子 exp(-2πi k / n)  (0 <= k <= n/2)
+    FFT_PLAN    *full;      //  n 点の複素 FFT プラン(n が奇数の場合)
+    FFT_COMPLEX *work;      //  n 点の複素 FFT の作業領域(n が奇数の場合)
+};
+
+
+/*
+ *  実数入力用 FFT プランを作成する
+ *
+ *  n : 変換サイズ(1以上)。
+ */
+FFT_REAL_PLAN *FFT_ID(_real_plan_new)(int n)
+{
+    FFT_REAL_PLAN *plan;
+    int k;
+
+    if (n < 1) {
+        fprintf(stderr, "%s() : size [%d] is invalid.\n", __func__, n);
+        exit(EXIT_FAILURE);
+    }
+
+    plan = _fft_alloc(sizeof(FFT_REAL_PLAN));
+    memset(plan, 0, sizeof(FFT_REAL_PLAN));
+    plan->n = n;
+
+    if (n % 2 == 1) {
+        plan->full = FFT_ID(_plan_new)(n);
+        plan->work = _fft_alloc(sizeof(FFT_COMPLEX) * n);
+        return plan;
+    }
+
+    plan->half = FFT_ID(_plan_new)(n / 2);
+    plan->twiddle = _fft_alloc(sizeof(FFT_COMPLEX) * (n / 2 + 1));
+    for (k = 0; k <= n / 2; k++)
+        plan->twiddle[k] = _fft_root(k, n);
+
+    return plan;
+}
+
+
+//  n が奇数の場合の変換。work に詰めた n 点の複素 FFT を行い、
+//  重複しない n/2 + 1 個を out に写す。
+static void FFT_ID(_real_execute_full)(FFT_REAL_PLAN *plan, FFT_COMPLEX *out)
+{
+    FFT_ID(_plan_execute)(plan->full, plan->work);
+    memcpy(out, plan->work, sizeof(FFT_COMPLEX) * (plan->n / 2 + 1));
+}
+
+
+/*
+ *  n/2 点の FFT 結果 out[0] ～ out[n/2 - 1] を、n 点の実数 FFT の結果
+ *  out[0] ～ out[n/2] に分離する。
+ *
+ *  k 番目と n/2 - k 番目の成分は互いに相手の値のみから求まるので、
+ *  2個ずつ組にして、その場で書き換えていく。
+ */
+static void FFT_ID(_real_untangle)(const FFT_REAL_PLAN *plan, FFT_COMPLEX *out)
+{
+    const int n2 = plan->n / 2;
+    const FFT_COMPLEX *W = plan->twiddle;
+    const FFT_REAL half = 0.5;
+    int k;
+
+    //  直流成分とナイキスト周波数の成分
+    FFT_COMPLEX z0 = out[0];
+    out[0]  = FFT_CREAL(z0) + FFT_CIMAG(z0);
+    out[n2] = FFT_CREAL(z0) - FFT_CIMAG(z0);
+
+    for (k = 1; k <= n2 / 2; k++) {
+        FFT_COMPLEX zk = out[k];
+        FFT_COMPLEX zm = out[n2 - k];
+
+        //  偶数番目(E)と奇数番目(O)のデータの FFT 結果に分ける
+        FFT_COMPLEX ek = (zk + FFT_CONJ(zm)) * half;
+        FFT_COMPLEX ok = (zk - FFT_CONJ(zm)) * -half * I;
+        FFT_COMPLEX em = (zm + FFT_CONJ(zk)) * half;
+        FFT_COMPLEX om = (zm - FFT_CONJ(zk)) * -half * I;
+
+        out[k]      = ek + W[k] * ok;
+        out[n2 - k] = em + W[n2 - k] * om;
+    }
+}
+
+
+//  間隔 istride で並んだ実数データ in を変換する
+static void FFT_ID(_real_execute_strided)(FFT_REAL_PLAN *plan, const FFT_REAL *in, int istride,
+                                          FFT_COMPLEX *out)
+{
+    const int n2 = plan->n / 2;
+    int k;
+
+    if (plan->full) {
+        for (k = 0; k < plan->n; k++)
+            plan->work[k] = in[(ptrdiff_t)k * istride];
+        FFT_ID(_real_execute_full)(plan, out);
+        return;
+    }
+
+    //  偶数番目を実部、奇数番目を虚部として詰める
+    for (k = 0; k < n2; k++)
+        out[k] = in[(ptrdiff_t)2 * k * istride] + in[(ptrdiff_t)(2 * k + 1) * istride] * I;
+
+    FFT_ID(_plan_execute)(plan->half, out);
+    FFT_ID(_real_untangle)(plan, out);
+}
+
+
+//  間隔 istride で並んだ 16bit PCM データ in を変換する
+static void FFT_ID(_real_execute_pcm_strided)(FFT_REAL_PLAN *plan, const short *in, int istride,
+                                              FFT_COMPLEX *out)
+{
+    const int n2 = plan->n / 2;
+    int k;
+
+    if (plan->full) {
+        for (k = 0; k < plan->n; k++)
+            plan->work[k] = in[(ptrdiff_t)k * istride];
+        FFT_ID(_real_execute_full)(plan, out);
+        return;
+    }
+
+    for (k = 0; k < n2; k++)
+        out[k] = (FFT_REAL)in[(ptrdiff_t)2 * k * istride]
+               + (FFT_REAL)in[(ptrdiff_t)(2 * k + 1) * istride] * I;
+
+    FFT_ID(_plan_execute)(plan->half, out);
+    FFT_ID(_real_untangle)(plan, out);
+}
+
+
+/*
+ *  プランに従い、実数データ in に対して高速フーリエ変換を行う。
+ *
+ *  plan : fft_real_plan_new() で作成したプラン
+ *  in   : 入力データ。plan の変換サイズ(n)個の実数データが必要。
+ *  out  : 結果の格納先。n/2 + 1 個の complex 型の領域が必要。
+ *         out[k] が k 番目の周波数成分となる。
+ *         (n/2 より大きい成分は、out[n - k] の共役に等しい)
+ */
+void FFT_ID(_real_plan_execute)(FFT_REAL_PLAN *plan, const FFT_REAL *in, FFT_COMPLEX *out)
+{
+    FFT_ID(_real_execute_strided)(plan, in, 1, out);
+}
+
+
+/*
+ *  fft_real_plan_execute() の、16bit PCM データを直接入力とするもの。
+ *  FFT_REAL への変換と詰め込みを同時に行う。
+ *  値の大きさは変換しない(-32768 ～ 32767 のまま扱う)。
+ */
+void FFT_ID(_real_plan_execute_pcm)(FFT_REAL_PLAN *plan, const short *in, FFT_COMPLEX *out)
+{
+    FFT_ID(_real_execute_pcm_strided)(plan, in, 1, out);
+}
+
+
+/*
+ *  複数の実数データに対して、まとめて高速フーリエ変換を行う。
+ *
+ *  howmany : 変換するデータの数
+ *  in      : 入力データ。b 番目のデータの t 番目の要素は in[b * idist + t * istride]
+ *  out     : 結果の格納先。b 番目の結果は out[b * odist] から n/2 + 1 個
+ *
+ *  詰め込みの際に間隔 istride で取り出すので、インタリーブされた
+ *  複数チャンネルのデータを、チャンネルごとに分けずに変換できる。
+ */
+void FFT_ID(_real_plan_execute_many)(FFT_REAL_PLAN *plan, int howmany,
+                                     const FFT_REAL *in, int istride, int idist,
+                                     FFT_COMPLEX *out, int odist)
+{
+    int b;
+
+    for (b = 0; b < howmany; b++)
+        FFT_ID(_real_execute_strided)(plan, in + (ptrdiff_t)b * idist, istride,
+                                      out + (ptrdiff_t)b * odist);
+}
+
+
+/*
+ *  fft_real_plan_execute_many() の、16bit PCM データを直接入力とするもの。
+ */
+void FFT_ID(_real_plan_execute_pcm_many)(FFT_REAL_PLAN *plan, int howmany,
+                                         const short *in, int istride, int idist,
+                                         FFT_COMPLEX *out, int odist)
+{
+    int b;
+
+    for (b = 0; b < howmany; b++)
+        FFT_ID(_real_execute_pcm_strided)(plan, in + (ptrdiff_t)b * idist, istride,
+                                          out + (ptrdiff_t)b * odist);
+}
+
+
+/*
+ *  実数入力用プランの変換サイズを返す。
+ */
+int FFT_ID(_real_plan_size)(const FFT_REAL_PLAN *plan)
+{
+    return plan->n;
+}
+
+
+/*
+ *  実数入力用 FFT プランを開放する。
+ */
+void FFT_ID(_real_plan_free)(FFT_REAL_PLAN *plan)
+{
+    if (plan) {
+        FFT_ID(_plan_free)(plan->half);
+        FFT_ID(_plan_free)(plan->full);
+        free(plan->twiddle);
+        free(plan->work);
+        free(plan);
+    }
+}
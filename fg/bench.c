@@ -0,0 +1,283 @@
+/*
+ * bench.c
+ *   freqgraph の読み込みと描画のベンチマーク
+ *
+ *     make bench
+ *     ./bench [-t seconds] [filter]
+ *
+ *   合成した解析結果(テキスト形式・バイナリ形式)を一時ファイルに書き出し、
+ *   read_file() による読み込み、ピラミッドの作成、タイルの描画を計測する。
+ *   出力の形式は ../benchutil.h を参照。
+ *
+ *   描画の計測には GTK の初期化が必要なので、画面がない環境では行わない。
+ */
+
+#include <gtk/gtk.h>
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "benchutil.h"
+#include "specfile.h"
+#include "freqdatalist.h"
+#include "freqgraph.h"
+#include "graphview.h"
+#include "pyramid.h"
+#include "tilecache.h"
+
+//  合成するデータのフレーム間隔とビンの数
+#define BENCH_INTERVAL      2205
+#define BENCH_NUM_BIN       200
+
+//  描画の計測で描くタイルの数(横, 縦)
+#define BENCH_TILE_X        8
+#define BENCH_TILE_Y        7
+
+
+//  frame 番目のフレームの、bin 番目のビンの音量
+static double _synth_amp(long frame, int bin)
+{
+    double a = 0.05 * (1 + sin(frame * 0.05 + bin * 0.3)) * (1 + cos(bin * 0.11));
+    return (a > 0.011) ? a : 0.011;
+}
+
+//  bin 番目のビンの周波数
+static int _synth_freq(int bin)
+{
+    return 20 + bin * 10;
+}
+
+
+//  一時ファイルの名前を作る
+static void _temp_name(char *filename)
+{
+    int fd;
+
+    strcpy(filename, "/tmp/fgbenchXXXXXX");
+    if ((fd = mkstemp(filename)) < 0) {
+        perror("Failed to create temporary file");
+        exit(EXIT_FAILURE);
+    }
+    close(fd);
+}
+
+
+//  テキスト形式(dft -f text の出力)で num_frame フレーム分を書き出す
+static void _write_text(const char *filename, long num_frame)
+{
+    FILE *fp = fopen(filename, "w");
+    long f;
+    int b;
+
+    if (!fp) {
+        perror("Failed to create temporary file");
+        exit(EXIT_FAILURE);
+    }
+
+    fprintf(fp, "%ld\n%d\n", num_frame * BENCH_INTERVAL, BENCH_INTERVAL);
+    for (f = 0; f < num_frame; f++) {
+        fprintf(fp, "#%ld\n", f * BENCH_INTERVAL);
+        for (b = 0; b < BENCH_NUM_BIN; b++)
+            fprintf(fp, "%d %.6f\n", _synth_freq(b), _synth_amp(f, b));
+        fprintf(fp, "\n");
+    }
+
+    fclose(fp);
+}
+
+
+//  バイナリ形式(dft -f bin の出力)で num_frame フレーム分を書き出す
+static void _write_spec(const char *filename, long num_frame)
+{
+    FILE *fp = fopen(filename, "wb");
+    SpecHeader h;
+    double freq[BENCH_NUM_BIN];
+    unsigned char record[SPEC_RECORD_SIZE(BENCH_NUM_BIN)];
+    long f;
+    int b;
+
+    if (!fp) {
+        perror("Failed to create temporary file");
+        exit(EXIT_FAILURE);
+    }
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, SPEC_MAGIC, SPEC_MAGIC_SIZE);
+    h.version = SPEC_VERSION;
+    h.header_size = sizeof(SpecHeader);
+    h.sample_rate = 44100;
+    h.num_sample = num_frame * BENCH_INTERVAL;
+    h.num_frame = num_frame;
+    h.bin_offset = sizeof(SpecHeader);
+    h.frame_offset = h.bin_offset + sizeof(freq);
+    h.hop = BENCH_INTERVAL;
+    h.frame_size = BENCH_INTERVAL;
+    h.num_bin = BENCH_NUM_BIN;
+    h.record_size = sizeof(record);
+    fwrite(&h, sizeof(h), 1, fp);
+
+    for (b = 0; b < BENCH_NUM_BIN; b++)
+        freq[b] = _synth_freq(b);
+    fwrite(freq, sizeof(freq), 1, fp);
+
+    memset(record, 0, sizeof(record));
+    for (f = 0; f < num_frame; f++) {
+        int64_t sample_point = f * BENCH_INTERVAL;
+        memcpy(record, &sample_point, 8);
+        for (b = 0; b < BENCH_NUM_BIN; b++) {
+            float amp = _synth_amp(f, b);
+            memcpy(record + 8 + 4 * b, &amp, 4);
+        }
+        fwrite(record, sizeof(record), 1, fp);
+    }
+
+    fclose(fp);
+}
+
+
+/*
+ *  read_file() : 読み込んで、開放するまで
+ */
+typedef struct {
+    char        filename[64];
+} ReadBench;
+
+static void _bench_read(void *_ctx)
+{
+    ReadBench *ctx = _ctx;
+    FreqdataList fl;
+
+    read_file(ctx->filename, &fl);
+    freqdata_list_clear(&fl);
+}
+
+static void bench_read(void)
+{
+    static const long size[] = { 1000, 10000, 50000 };
+    ReadBench ctx;
+    int i;
+
+    for (i = 0; i < sizeof(size) / sizeof(size[0]); i++) {
+        if (bench_selected("read_file_text")) {
+            _temp_name(ctx.filename);
+            _write_text(ctx.filename, size[i]);
+            bench_run("read_file_text", size[i], size[i] * BENCH_INTERVAL, _bench_read, &ctx);
+            unlink(ctx.filename);
+        }
+        if (bench_selected("read_file_bin")) {
+            _temp_name(ctx.filename);
+            _write_spec(ctx.filename, size[i]);
+            bench_run("read_file_bin", size[i], size[i] * BENCH_INTERVAL, _bench_read, &ctx);
+            unlink(ctx.filename);
+        }
+    }
+}
+
+
+/*
+ *  pyramid_new() : 読み込み後の、縮小表示用データの作成
+ */
+static void _bench_pyramid(void *fl)
+{
+    pyramid_free(pyramid_new(fl, ((FreqdataList *)fl)->maxamp));
+}
+
+static void bench_pyramid(void)
+{
+    static const long size[] = { 1000, 10000, 50000 };
+    char filename[64];
+    FreqdataList fl;
+    int i;
+
+    if (!bench_selected("pyramid_new"))
+        return;
+
+    for (i = 0; i < sizeof(size) / sizeof(size[0]); i++) {
+        _temp_name(filename);
+        _write_spec(filename, size[i]);
+        read_file(filename, &fl);
+        unlink(filename);
+
+        bench_run("pyramid_new", size[i], size[i] * BENCH_INTERVAL, _bench_pyramid, &fl);
+        freqdata_list_clear(&fl);
+    }
+}
+
+
+/*
+ *  タイルの描画 : BENCH_TILE_X × BENCH_TILE_Y 枚のタイルを描く
+ *
+ *  ワーカースレッドと同じ描画関数(graphview_render_tile())を、このスレッドで直接呼ぶ。
+ */
+typedef struct {
+    GraphView   *gv;
+    Raster      *raster;
+    gdouble     zoom_x;
+} DrawBench;
+
+static void _bench_draw(void *_ctx)
+{
+    DrawBench *ctx = _ctx;
+    TileKey key;
+
+    key.zoom_x = ctx->zoom_x;
+    key.zoom_y = ctx->gv->zoom_y;
+    for (key.ty = 0; key.ty < BENCH_TILE_Y; key.ty++) {
+        for (key.tx = 0; key.tx < BENCH_TILE_X; key.tx++)
+            graphview_render_tile(ctx->gv, &key, ctx->raster);
+    }
+}
+
+static void bench_draw(void)
+{
+    //  既定の倍率、およびピラミッドを使う縮小表示
+    static const double zoom_x[] = { 0.0025, 0.0005, 0.00005 };
+    static const long size = 50000;
+    char filename[64], name[64];
+    FreqdataList fl;
+    DrawBench ctx;
+    int i;
+
+    if (!bench_selected("draw"))
+        return;
+
+    _temp_name(filename);
+    _write_spec(filename, size);
+    read_file(filename, &fl);
+    unlink(filename);
+
+    ctx.gv = graphview_new(NULL);
+    graphview_set_sample_data(ctx.gv, &fl);
+    ctx.raster = raster_new(TILE_SIZE, TILE_SIZE);
+
+    for (i = 0; i < sizeof(zoom_x) / sizeof(zoom_x[0]); i++) {
+        ctx.zoom_x = zoom_x[i];
+        //  名前に、1ピクセルあたりのフレーム数を付ける
+        sprintf(name, "draw_tiles@%gfpp", 1.0 / (BENCH_INTERVAL * zoom_x[i]));
+        bench_run(name, size, (double)BENCH_TILE_X * BENCH_TILE_Y * TILE_SIZE * TILE_SIZE,
+                  _bench_draw, &ctx);
+    }
+
+    raster_free(ctx.raster);
+    graphview_free_with_samples(ctx.gv);
+}
+
+
+int main(int argc, char *argv[])
+{
+    gboolean has_display = gtk_init_check(&argc, &argv);
+
+    bench_init(argc, argv);
+
+    bench_read();
+    bench_pyramid();
+    if (has_display)
+        bench_draw();
+    else
+        printf("# draw: skipped (GTK could not be initialised)\n");
+
+    return 0;
+}
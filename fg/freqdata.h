@@ -1,5 +1,10 @@
 /*
  * freqdata.h
+ *   あるサンプルポイントにおける (周波数, 音量) の組の並び
+ *
+ *   組そのものは FreqdataList がまとめて保持しており、Freqdata は
+ *   そのうち1フレーム分の範囲を参照するだけのもの。
+ *   freqdata_list_get() で取得する。
  */
 
 #ifndef __FREQDATA_H__
@@ -12,65 +17,28 @@
 //  Freqdata 構造体
 typedef struct _freqdata {
     long        sample_point;   //  開始からのサンプル数
-    GPtrArray   *ampdata_ary;   //  sample_point における(周波数,音量)の組を保持する配列
+    int         num_amp;        //  sample_point における(周波数,音量)の組の数
+    const gint32 *freq;         //  各組の周波数(num_amp 個)
+    const gfloat *amp;          //  各組の音量(num_amp 個)
     int         index_next;     //  現在の読み取り位置。
+    Ampdata     current;        //  freqdata_next_ampdata() で返す組
 } Freqdata;
 
 
 /*
- * freqdata オブジェクトを新規作成する
- */
-Freqdata *freqdata_new(void); 
-
-
-/*
- * freqdata オブジェクトを新規作成する(パラメータ指定あり)
- *
- * 引数：
- *   sample_point : 対象のサンプルポイント(データ開始時点からのサンプル数)
- *
- */
-Freqdata *freqdata_new_with_param(long sample_point);
-
-
-/*
- * freqdata に登録されている ampdata 構造体を順次取得する
+ * freqdata に含まれる (周波数, 音量) の組を順次取得する
  * 
  * 引数：
  *   data : Freqdata 構造体
  * 
  * 戻値：
  *   Ampdata 構造体を、先頭から順次返していく。
+ *   返す領域は data 内にあり、次の呼び出しで上書きされる。
  *   最後に到達したあと、再度リクエストされたときは NULL を返す。
  */
 Ampdata *freqdata_next_ampdata(Freqdata *data);
 
 
-/*
- * 新しい周波数・音量の組を追加する
- *
- * 引数：
- *   data : 追加対象の Freqdata 構造体
- *   freq : 追加するデータの周波数
- *   amp  : 追加するデータの音量
- *
- */
-void freqdata_add_ampdata(Freqdata *data, int freq, double amp);
-
-
-/*
- * Freqdata 構造体を開放する
- */
-void freqdata_free(Freqdata *data);
-
-
-/* 
- * Freqdata 構造体を開放する
- * GPtrArray の element_free_func として利用可能なバージョン
- */
-void g_freqdata_free(gpointer data);
-
-
 #endif
 
 
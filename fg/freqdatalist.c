@@ -0,0 +1,151 @@
+/*
+ * freqdatalist.c
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "freqdatalist.h"
+
+
+//  realloc のラッパ関数
+//  確保に失敗した場合はエラー終了する。
+static void *_freqdata_list_realloc(void *ptr, size_t size)
+{
+    ptr = realloc(ptr, size);
+    if (!ptr && size > 0) {
+        perror("Failed to allocate memory for freqdata list");
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+
+/*
+ * 空のリストに初期化する
+ */
+void freqdata_list_init(FreqdataList *fl)
+{
+    memset(fl, 0, sizeof(FreqdataList));
+    fl->offset = _freqdata_list_realloc(NULL, sizeof(gsize));
+    fl->offset[0] = 0;
+}
+
+
+//  フレームの領域を frame_capacity 個分にする
+static void _resize_frame(FreqdataList *fl, gsize frame_capacity)
+{
+    fl->sample_point = _freqdata_list_realloc(fl->sample_point, sizeof(glong) * frame_capacity);
+    fl->offset = _freqdata_list_realloc(fl->offset, sizeof(gsize) * (frame_capacity + 1));
+    fl->frame_capacity = frame_capacity;
+}
+
+
+//  組の領域を amp_capacity 個分にする
+static void _resize_amp(FreqdataList *fl, gsize amp_capacity)
+{
+    fl->freq = _freqdata_list_realloc(fl->freq, sizeof(gint32) * amp_capacity);
+    fl->amp  = _freqdata_list_realloc(fl->amp,  sizeof(gfloat) * amp_capacity);
+    fl->amp_capacity = amp_capacity;
+}
+
+
+/*
+ * 少なくとも num_frame 個のフレームと num_amp 個の組を
+ * 追加の確保なしで格納できるようにする
+ */
+void freqdata_list_reserve(FreqdataList *fl, gsize num_frame, gsize num_amp)
+{
+    if (num_frame > fl->frame_capacity)
+        _resize_frame(fl, num_frame);
+    if (num_amp > fl->amp_capacity)
+        _resize_amp(fl, num_amp);
+}
+
+
+/*
+ * 新しいフレームを末尾に追加する
+ */
+void freqdata_list_add_frame(FreqdataList *fl, long sample_point)
+{
+    if (fl->num_frame == fl->frame_capacity)
+        _resize_frame(fl, fl->frame_capacity ? fl->frame_capacity * 2 : 256);
+
+    fl->sample_point[fl->num_frame] = sample_point;
+    fl->num_frame++;
+    fl->offset[fl->num_frame] = fl->num_amp;
+}
+
+
+/*
+ * 末尾のフレームに、周波数・音量の組を追加する
+ */
+void freqdata_list_add_ampdata(FreqdataList *fl, int freq, double amp)
+{
+    if (fl->num_amp == fl->amp_capacity)
+        _resize_amp(fl, fl->amp_capacity ? fl->amp_capacity * 2 : 4096);
+
+    fl->freq[fl->num_amp] = freq;
+    fl->amp[fl->num_amp]  = amp;
+    fl->num_amp++;
+    fl->offset[fl->num_frame] = fl->num_amp;
+}
+
+
+/*
+ * src のフレームを、すべて fl の末尾に追加する
+ */
+void freqdata_list_append(FreqdataList *fl, const FreqdataList *src)
+{
+    gsize f;
+
+    freqdata_list_reserve(fl, fl->num_frame + src->num_frame, fl->num_amp + src->num_amp);
+
+    memcpy(fl->sample_point + fl->num_frame, src->sample_point, sizeof(glong) * src->num_frame);
+    for (f = 1; f <= src->num_frame; f++)
+        fl->offset[fl->num_frame + f] = fl->num_amp + src->offset[f];
+    memcpy(fl->freq + fl->num_amp, src->freq, sizeof(gint32) * src->num_amp);
+    memcpy(fl->amp  + fl->num_amp, src->amp,  sizeof(gfloat) * src->num_amp);
+
+    fl->num_frame += src->num_frame;
+    fl->num_amp   += src->num_amp;
+}
+
+
+/*
+ * 確保済みで使っていない領域を開放する
+ */
+void freqdata_list_trim(FreqdataList *fl)
+{
+    if (fl->frame_capacity > fl->num_frame)
+        _resize_frame(fl, fl->num_frame);
+    if (fl->amp_capacity > fl->num_amp)
+        _resize_amp(fl, fl->num_amp);
+}
+
+
+/*
+ * n 番目のフレームを取得する
+ */
+void freqdata_list_get(const FreqdataList *fl, gsize n, Freqdata *data)
+{
+    data->sample_point = fl->sample_point[n];
+    data->num_amp      = fl->offset[n + 1] - fl->offset[n];
+    data->freq         = fl->freq + fl->offset[n];
+    data->amp          = fl->amp  + fl->offset[n];
+    data->index_next   = 0;
+}
+
+
+/*
+ * 保持している領域を開放する(fl 自体は開放しない)
+ */
+void freqdata_list_clear(FreqdataList *fl)
+{
+    free(fl->sample_point);
+    free(fl->offset);
+    free(fl->freq);
+    free(fl->amp);
+    memset(fl, 0, sizeof(FreqdataList));
+}
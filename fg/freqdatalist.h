@@ -1,20 +1,91 @@
 /*
  * freqdatalist.h
- *   Freqdata 構造体の配列を扱う。
+ *   全フレームの (周波数, 音量) の組を保持する。
+ *
+ *   組はフレームごとのオブジェクトとしてではなく、周波数と音量の
+ *   2つの配列に全フレーム分を続けて格納する。n 番目のフレームの組は
+ *   offset[n] ～ offset[n + 1] - 1 番目の要素となる。
+ *   描画や最大値の探索では、これらの配列を先頭から順に読むだけでよい。
  */
 
 #ifndef __FREQDATALIST_H__
 #define __FREQDATALIST_H__
 
 #include <glib.h>
+#include "freqdata.h"
 
 //  FreqdataList 構造体
 typedef struct _freqdata_list {
-    long        num_sample;     //  このリストに含まれるFreqdata構造体の数
+    long        num_sample;     //  wavファイル全体のサンプル数
     int         interval;       //  あるサンプルから次のサンプルまでの間隔(サンプル数)
-    GPtrArray   *list;          //  Freqdata 構造体のポインタを保持する配列
+    double      maxamp;         //  全データ中の最大音量。0 の場合は不明(読み込み後に求める)
+
+    gsize       num_frame;      //  フレームの数
+    gsize       num_amp;        //  全フレームの (周波数, 音量) の組の数
+    glong       *sample_point;  //  各フレームのサンプルポイント(num_frame 個)
+    gsize       *offset;        //  各フレームの最初の組の位置(num_frame + 1 個)
+    gint32      *freq;          //  周波数(num_amp 個)
+    gfloat      *amp;           //  音量(num_amp 個)
+    gsize       frame_capacity; //  確保済みのフレーム数
+    gsize       amp_capacity;   //  確保済みの組の数
 } FreqdataList;
 
 
+/*
+ * 空のリストに初期化する
+ */
+void freqdata_list_init(FreqdataList *fl);
+
+
+/*
+ * 少なくとも num_frame 個のフレームと num_amp 個の組を
+ * 追加の確保なしで格納できるようにする
+ */
+void freqdata_list_reserve(FreqdataList *fl, gsize num_frame, gsize num_amp);
+
+
+/*
+ * 新しいフレームを末尾に追加する
+ *
+ * 引数：
+ *   sample_point : フレームのサンプルポイント
+ */
+void freqdata_list_add_frame(FreqdataList *fl, long sample_point);
+
+
+/*
+ * 末尾のフレームに、周波数・音量の組を追加する
+ */
+void freqdata_list_add_ampdata(FreqdataList *fl, int freq, double amp);
+
+
+/*
+ * src のフレームを、すべて fl の末尾に追加する
+ */
+void freqdata_list_append(FreqdataList *fl, const FreqdataList *src);
+
+
+/*
+ * 確保済みで使っていない領域を開放する
+ */
+void freqdata_list_trim(FreqdataList *fl);
+
+
+/*
+ * n 番目のフレームを取得する
+ *
+ * 引数：
+ *   n    : フレームの番号(0 ～ num_frame - 1)
+ *   data : 取得先。fl の領域を参照するので、fl を変更するまで有効。
+ */
+void freqdata_list_get(const FreqdataList *fl, gsize n, Freqdata *data);
+
+
+/*
+ * 保持している領域を開放する(fl 自体は開放しない)
+ */
+void freqdata_list_clear(FreqdataList *fl);
+
+
 #endif
 
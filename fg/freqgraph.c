@@ -6,22 +6,34 @@
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "ampdata.h"
 #include "freqdata.h"
 #include "freqdatalist.h"
+#include "freqgraph.h"
 #include "graphview.h"
+#include "specfile.h"
+
+//  バイナリ形式で、これ以下の音量のビンは読み込まない
+//  (テキスト形式で dft が出力するしきい値と同じ)
+#define MIN_AMP     0.01
 
 
 //  デバッグ用
-void print_g_ptr_array(GPtrArray *array)
+void print_freqdata_list(const FreqdataList *fl)
 {
-    int f, a;
-    for (f=0; f < array->len; f++) {
-        Freqdata *freq = g_ptr_array_index(array, f);
-        printf("#%ld\n", freq->sample_point);
-        for (a=0; a < freq->ampdata_ary->len; a++) {
-            Ampdata *amp = g_ptr_array_index(freq->ampdata_ary, a);
+    Freqdata freq;
+    Ampdata *amp;
+    gsize f;
+
+    for (f=0; f < fl->num_frame; f++) {
+        freqdata_list_get(fl, f, &freq);
+        printf("#%ld\n", freq.sample_point);
+        while ((amp = freqdata_next_ampdata(&freq)) != NULL) {
             printf("%d %8.5f\n", amp->freq, amp->amp);
         }
         printf("\n");
@@ -29,70 +41,344 @@ void print_g_ptr_array(GPtrArray *array)
 }
 
 
-void read_file(const char *filename, FreqdataList *fl) 
+/*
+ *  バイナリ形式(dft -f bin)のファイルを読み込む
+ *
+ *  ファイルをメモリにマップし、固定長のレコードを順に参照する。
+ *  文字列の解析は行わない。
+ */
+void read_spec_file(const char *filename, FreqdataList *fl)
 {
-    FILE *fp;
-    char buf[256];
-
-    fl->list = g_ptr_array_new_with_free_func(g_freqdata_free);
+    struct stat st;
+    const unsigned char *map;
+    const SpecHeader *h;
+    const double *freq;
+    guint64 num_frame, f;
+    double maxamp = 0.0;
+    int fd, b;
 
-    if (!(fp = fopen(filename, "r"))) {
+    if ((fd = open(filename, O_RDONLY)) < 0 || fstat(fd, &st) != 0) {
         fprintf(stderr, "Failed to open file %s\n", filename);
         exit(EXIT_FAILURE);
     }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        perror("Failed to map file");
+        exit(EXIT_FAILURE);
+    }
+    close(fd);
 
-    //  総サンプル数
-    fgets(buf, 256, fp);
-    fl->num_sample = atol(buf);
+    //  周波数テーブルとレコードがファイル内に収まっていることを確かめる
+    //  (壊れたファイルで、マップした領域の外を参照しないように)
+    h = (const SpecHeader *)map;
+    if (st.st_size < sizeof(SpecHeader) || h->version != SPEC_VERSION
+        || h->bin_offset < sizeof(SpecHeader) || h->bin_offset % sizeof(double) != 0
+        || h->bin_offset > st.st_size
+        || h->num_bin > (st.st_size - h->bin_offset) / sizeof(double)
+        || h->frame_offset < h->bin_offset + sizeof(double) * h->num_bin
+        || h->frame_offset > st.st_size || h->record_size < SPEC_RECORD_SIZE(h->num_bin)) {
+        fprintf(stderr, "Invalid format %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
 
-    //  サンプル間隔
-    fgets(buf, 256, fp);
-    fl->interval = atoi(buf);
-
-    while(1) {
-        
-        if ( !fgets(buf, 256, fp) ) {
-            if (feof(fp)) 
-                break;
-            else {
-                fprintf(stderr, "Failed to read from file");
+    //  ヘッダに書き戻されていない場合は、ファイルの大きさから求める
+    num_frame = (st.st_size - h->frame_offset) / h->record_size;
+    if (h->num_frame > 0 && h->num_frame < num_frame)
+        num_frame = h->num_frame;
+
+    freqdata_list_init(fl);
+    fl->num_sample = h->num_sample;
+    fl->interval   = h->hop;
+    freqdata_list_reserve(fl, num_frame, 0);
+
+    freq = (const double *)(map + h->bin_offset);
+    for (f = 0; f < num_frame; f++) {
+        const unsigned char *rec = map + h->frame_offset + f * h->record_size;
+        const float *amp = (const float *)(rec + 8);
+        gint64 sample_point;
+
+        memcpy(&sample_point, rec, 8);
+        freqdata_list_add_frame(fl, sample_point);
+
+        for (b = 0; b < h->num_bin; b++) {
+            if (maxamp < amp[b])
+                maxamp = amp[b];
+            if (amp[b] > MIN_AMP)
+                freqdata_list_add_ampdata(fl, lround(freq[b]), amp[b]);
+        }
+    }
+    freqdata_list_trim(fl);
+
+    //  サンプル数がヘッダに書き戻されていない場合は、最後のフレームの末尾とする
+    if (fl->num_sample <= 0 && fl->num_frame > 0)
+        fl->num_sample = fl->sample_point[fl->num_frame - 1] + h->frame_size;
+
+    fl->maxamp = (h->max_amp > 0) ? h->max_amp : maxamp;
+
+    munmap((void *)map, st.st_size);
+}
+
+
+//  テキスト形式の読み込みで、1スレッドあたりの最小のバイト数
+//  (これより小さいファイルでは、スレッドの数を減らす)
+#define MIN_CHUNK_SIZE  (256 * 1024)
+
+//  テキスト形式の読み込みを行うスレッド数の上限
+#define MAX_LOAD_THREAD 64
+
+
+//  テキスト形式の一部分(フレームの区切りで分割したもの)
+typedef struct _load_chunk {
+    const char  *begin;         //  先頭('#' で始まる行の先頭)
+    const char  *end;           //  末尾(次の部分の先頭)
+    FreqdataList list;          //  読み込んだフレーム
+} LoadChunk;
+
+
+//  10 の累乗(小数部の桁数から割る数を求める)
+static const double pow10_table[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+    1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18,
+};
+
+
+//  整数を読み取る
+//  *pp は読み取った次の文字まで進める。小数部があれば読み飛ばす(atoi と同じく切り捨て)。
+static long _parse_long(const char **pp, const char *end)
+{
+    const char *p = *pp;
+    long v = 0;
+    int neg = 0;
+
+    if (p < end && (*p == '-' || *p == '+'))
+        neg = (*p++ == '-');
+    while (p < end && *p >= '0' && *p <= '9')
+        v = v * 10 + (*p++ - '0');
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && *p >= '0' && *p <= '9')
+            p++;
+    }
+
+    *pp = p;
+    return neg ? -v : v;
+}
+
+
+//  "%f" で出力された小数を読み取る
+//  仮数部を整数として読み取り、最後に 10 の累乗で一度だけ割る。
+//  桁数が多い場合や指数部がある場合は strtod() に任せる。
+//  数字がない場合("nan", "inf" など)は 0 を返し、*pp は進めない。
+static double _parse_double(const char **pp, const char *end)
+{
+    const char *p = *pp;
+    guint64 mant = 0;
+    int digits = 0, frac = 0;
+    int neg = 0;
+
+    if (p < end && (*p == '-' || *p == '+'))
+        neg = (*p++ == '-');
+    while (p < end && *p >= '0' && *p <= '9') {
+        mant = mant * 10 + (*p++ - '0');
+        digits++;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && *p >= '0' && *p <= '9') {
+            mant = mant * 10 + (*p++ - '0');
+            digits++;
+            frac++;
+        }
+    }
+
+    if (digits == 0)
+        return 0.0;
+
+    if (digits > 18 || (p < end && (*p == 'e' || *p == 'E'))) {
+        char *q;
+        double v = strtod(*pp, &q);
+        *pp = q;
+        return v;
+    }
+
+    *pp = p;
+    return neg ? -(mant / pow10_table[frac]) : mant / pow10_table[frac];
+}
+
+
+//  次の行の先頭まで進める
+static const char *_next_line(const char *p, const char *end)
+{
+    const char *nl = memchr(p, '\n', end - p);
+    return nl ? nl + 1 : end;
+}
+
+
+//  テキスト形式の一部分を読み込む(スレッドとして実行される)
+static gpointer _load_chunk(gpointer _chunk)
+{
+    LoadChunk *chunk = _chunk;
+    const char *p = chunk->begin;
+    const char *end = chunk->end;
+
+    freqdata_list_init(&chunk->list);
+
+    while (p < end) {
+        if (*p == '\n') {   //  空行
+            p++;
+            continue;
+        }
+        if (*p != '#') {
+            const char *eol = _next_line(p, end);
+            fprintf(stderr, "Invalid format %.*s\n", (int)(eol - p), p);
+            exit(EXIT_FAILURE);
+        }
+
+        //  Sample point
+        p++;
+        freqdata_list_add_frame(&chunk->list, _parse_long(&p, end));
+        p = _next_line(p, end);
+
+        //  周波数＋音量データを追加していく
+        //  空行が出たら、このフレームは終了
+        //  音量が数値でない行("nan", "inf" など、有限でない値を含む)は不正とする
+        while (p < end && *p != '\n') {
+            const char *line = p;
+            int freq = _parse_long(&p, end);
+            while (p < end && *p == ' ')
+                p++;
+            const char *num = p;
+            double amp = _parse_double(&p, end);
+            if (p == num || !isfinite(amp)) {
+                const char *eol = _next_line(line, end);
+                fprintf(stderr, "Invalid format %.*s\n", (int)(eol - line), line);
                 exit(EXIT_FAILURE);
             }
+
+            freqdata_list_add_ampdata(&chunk->list, freq, amp);
+            p = _next_line(p, end);
         }
+    }
 
-        if (buf[0] == '#') {    //  Sample point
-
-            long sample_point = atol(buf + 1);
-            Freqdata *freqdata = freqdata_new_with_param(sample_point);
-            
-            //  周波数＋音量データを追加していく
-            //　データの終端は、改行文字(\n) + \0 で、文字列長は1。これが出たら終了。
-            while ( fgets(buf, 256, fp) && strlen(buf) > 1 ) {
-                //  改行文字＋スペースは、\0に変換
-                char *buf_amp = strchr(buf, ' ');
-                *buf_amp = '\0';
-                buf_amp++;
-
-                int freq = atoi(buf);
-                double amp = atof(buf_amp);
-                Ampdata *ampdata = ampdata_new_with_param(freq, amp); 
-                g_ptr_array_add(freqdata->ampdata_ary, (gpointer)ampdata);
-            }
+    return NULL;
+}
 
-            g_ptr_array_add(fl->list, (gpointer)freqdata);
 
-        } else {
-            fprintf(stderr, "Invalid format %s\n", buf);
-            exit(EXIT_FAILURE);
+/*
+ *  テキスト形式のファイルを読み込む
+ *
+ *  ファイルをメモリにマップし、フレームの区切り('#' で始まる行)で
+ *  いくつかに分割して、複数のスレッドで並行して読み込む。
+ *  読み込んだフレームは、ファイル内の順に fl に並べる。
+ *  各スレッドの結果をつなげる際に、必要な大きさの領域を一度だけ確保する。
+ */
+void read_file(const char *filename, FreqdataList *fl) 
+{
+    struct stat st;
+    const char *map, *p, *end;
+    LoadChunk chunk[MAX_LOAD_THREAD];
+    GThread *thread[MAX_LOAD_THREAD];
+    gsize num_frame = 0, num_amp = 0;
+    int num_thread, i;
+    int fd;
+
+    if ((fd = open(filename, O_RDONLY)) < 0 || fstat(fd, &st) != 0) {
+        fprintf(stderr, "Failed to open file %s\n", filename);
+        exit(EXIT_FAILURE);
+    }
+
+    //  バイナリ形式かどうか
+    if (st.st_size >= SPEC_MAGIC_SIZE) {
+        char magic[SPEC_MAGIC_SIZE];
+        if (read(fd, magic, SPEC_MAGIC_SIZE) == SPEC_MAGIC_SIZE
+            && memcmp(magic, SPEC_MAGIC, SPEC_MAGIC_SIZE) == 0) {
+            close(fd);
+            read_spec_file(filename, fl);
+            return;
+        }
+    }
+
+    freqdata_list_init(fl);
+
+    if (st.st_size == 0) {
+        close(fd);
+        return;
+    }
+
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        perror("Failed to map file");
+        exit(EXIT_FAILURE);
+    }
+    close(fd);
+    madvise((void *)map, st.st_size, MADV_SEQUENTIAL);
+
+    p = map;
+    end = map + st.st_size;
+
+    //  総サンプル数
+    fl->num_sample = _parse_long(&p, end);
+    p = _next_line(p, end);
+
+    //  サンプル間隔
+    fl->interval = _parse_long(&p, end);
+    p = _next_line(p, end);
+
+    //  スレッド数は CPU の数まで。ただし1スレッドあたり MIN_CHUNK_SIZE 以上とする
+    num_thread = g_get_num_processors();
+    if (num_thread > (end - p) / MIN_CHUNK_SIZE)
+        num_thread = (end - p) / MIN_CHUNK_SIZE;
+    if (num_thread > MAX_LOAD_THREAD)
+        num_thread = MAX_LOAD_THREAD;
+    if (num_thread < 1)
+        num_thread = 1;
+
+    //  おおよそ等分した位置から、次のフレームの先頭まで進めて区切る
+    for (i = 0; i < num_thread; i++) {
+        const char *split = (i == 0) ? p : p + (end - p) / num_thread * i;
+        if (i > 0) {
+            if (split < chunk[i - 1].begin)
+                split = chunk[i - 1].begin;
+            while (split < end && !(*split == '#' && split[-1] == '\n'))
+                split = _next_line(split, end);
         }
+        chunk[i].begin = split;
+    }
+    for (i = 0; i < num_thread; i++)
+        chunk[i].end = (i + 1 < num_thread) ? chunk[i + 1].begin : end;
+
+    if (num_thread == 1) {
+        _load_chunk(&chunk[0]);
+    } else {
+        for (i = 0; i < num_thread; i++)
+            thread[i] = g_thread_new("loader", _load_chunk, &chunk[i]);
+        for (i = 0; i < num_thread; i++)
+            g_thread_join(thread[i]);
+    }
+
+    //  読み込んだ順につなげる
+    for (i = 0; i < num_thread; i++) {
+        num_frame += chunk[i].list.num_frame;
+        num_amp   += chunk[i].list.num_amp;
+    }
+    freqdata_list_reserve(fl, num_frame, num_amp);
+    for (i = 0; i < num_thread; i++) {
+        freqdata_list_append(fl, &chunk[i].list);
+        freqdata_list_clear(&chunk[i].list);
     }
 
-    print_g_ptr_array(fl->list);
+    //  総サンプル数が不明(0)の場合は、最後のフレームの位置から求める
+    if (fl->num_sample <= 0 && fl->num_frame > 0)
+        fl->num_sample = fl->sample_point[fl->num_frame - 1] + fl->interval;
 
-    fclose(fp);
+    munmap((void *)map, st.st_size);
 }
 
 
+#ifndef FREQGRAPH_NO_MAIN
+//  ベンチマーク(bench.c)から read_file() などを使う場合は、
+//  -DFREQGRAPH_NO_MAIN を指定してコンパイルする。
+
 static void destroy(GtkWidget *widget, GraphView *gv) 
 {
     graphview_free_with_samples(gv);
@@ -106,8 +392,22 @@ int main(int argc, char *argv[])
     GtkWidget *window;
     FreqdataList fl;
     GraphView *gv;
+    int debug = 0;
+
+    //  -d : 読み込んだデータを標準出力に出力する(デバッグ用)
+    if (argc > 1 && strcmp(argv[1], "-d") == 0) {
+        debug = 1;
+        argv++;
+        argc--;
+    }
+    if (argc < 2) {
+        fprintf(stderr, "Usage: freqgraph [-d] filename\n");
+        return 1;
+    }
 
     read_file(argv[1], &fl);
+    if (debug)
+        print_freqdata_list(&fl);
 
     gtk_init(&argc, &argv);
 
@@ -127,4 +427,4 @@ int main(int argc, char *argv[])
     return 0;
 }
 
-
+#endif  // FREQGRAPH_NO_MAIN
@@ -0,0 +1,40 @@
+/*
+ * freqgraph.h
+ *   解析結果(dft の出力)のファイルを読み込む
+ *
+ *   freqgraph 本体のほか、ベンチマーク(bench.c)からも使う。
+ */
+
+#ifndef __FREQGRAPH_H__
+#define __FREQGRAPH_H__
+
+#include "freqdatalist.h"
+
+
+/*
+ * 解析結果のファイルを読み込む
+ *
+ * 引数：
+ *   filename : ファイル名。テキスト形式とバイナリ形式(dft -f bin)のどちらでもよい
+ *   fl       : 読み込んだ結果の格納先。この関数の中で初期化する
+ *
+ * バイナリ形式かどうかは、ファイル先頭のマジックナンバーで判定する。
+ */
+void read_file(const char *filename, FreqdataList *fl);
+
+
+/*
+ * バイナリ形式(dft -f bin)のファイルを読み込む
+ *
+ * 引数は read_file() と同じ。
+ */
+void read_spec_file(const char *filename, FreqdataList *fl);
+
+
+/*
+ * 読み込んだ結果を、テキスト形式で標準出力に出力する(デバッグ用)
+ */
+void print_freqdata_list(const FreqdataList *fl);
+
+
+#endif
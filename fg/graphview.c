@@ -13,6 +13,9 @@
 #include "graphview.h"
 #include "freqdata.h"
 #include "ampdata.h"
+#include "raster.h"
+#include "pyramid.h"
+#include "tilecache.h"
 
 #define log2(x)     log(x)/log(2)
 
@@ -37,36 +40,50 @@
 
 
 
-static void _set_gc_color(GdkGC *gc, guint16 red, guint16 green, guint16 blue)
+//  画面左上の、グラフ全体での座標を求める
+//  スクロール位置の端数で1ピクセルずれないよう、四捨五入する。
+static void _get_screen_origin(const GraphView *gv, glong *x, glong *y)
 {
-    GdkColor    color;
+    *x = floor(gv->screen_left_samplepoint * gv->zoom_x + 0.5);
+    *y = floor((SCREEN_TOP_HZLOG2 - gv->screen_top_hzlog2) * gv->zoom_y + 0.5);
+}
 
-    color.red   = red;
-    color.green = green;
-    color.blue  = blue;
 
-    gdk_gc_set_rgb_fg_color(gc, &color);
-}
+/*
+ *  表示位置を変更する
+ *
+ *    描画済みの画素はスクロールした分だけずらし、
+ *    新しく画面に入った部分だけを描き直させる。
+ *    (gdk_window_scroll() が、その部分の再描画を要求する)
+ */
+static void _scroll_to(GraphView *gv, glong left_samplepoint, gdouble top_hzlog2)
+{
+    glong old_x, old_y, new_x, new_y;
 
+    _get_screen_origin(gv, &old_x, &old_y);
+    gv->screen_left_samplepoint = left_samplepoint;
+    gv->screen_top_hzlog2 = top_hzlog2;
+    _get_screen_origin(gv, &new_x, &new_y);
+
+    //  まだ画面に表示されていなければ、描き直すものはない
+    if (!gv->graph->window)
+        return;
+
+    if (old_x != new_x || old_y != new_y)
+        gdk_window_scroll(gv->graph->window, old_x - new_x, old_y - new_y);
+}
 
 
 static void _horizontal_changed(GtkAdjustment *horizontal, GraphView *gv)
 {
-    gint width, height;
-    gdk_drawable_get_size(gv->graph->window, &width, &height);
-
-    gv->screen_left_samplepoint = gtk_adjustment_get_value(horizontal);
-    gtk_widget_queue_draw_area(gv->graph, 0, 0, width, height);
+    _scroll_to(gv, gtk_adjustment_get_value(horizontal), gv->screen_top_hzlog2);
 }  
 
 
 static void _vertical_changed(GtkAdjustment *vertical, GraphView *gv)
 {
-    gint width, height;
-    gdk_drawable_get_size(gv->graph->window, &width, &height);
-
-    gv->screen_top_hzlog2 = SCREEN_TOP_HZLOG2 - gtk_adjustment_get_value(vertical) + SCREEN_BOTTOM_HZLOG2;
-    gtk_widget_queue_draw_area(gv->graph, 0, 0, width, height);
+    _scroll_to(gv, gv->screen_left_samplepoint,
+               SCREEN_TOP_HZLOG2 - gtk_adjustment_get_value(vertical) + SCREEN_BOTTOM_HZLOG2);
 }
 
 
@@ -104,10 +121,29 @@ void _init_vadjustment(GraphView *gv)
 }  
 
 
-gint _get_y_from_hz(GraphView *gv, gdouble hz) 
+//  周波数を、タイル上の y 座標に変換する
+static gint _get_y_from_hz(const TileKey *key, gdouble hz) 
 {
     return 
-        (gv->screen_top_hzlog2 - log2(hz)) * gv->zoom_y ;
+        floor((SCREEN_TOP_HZLOG2 - log2(hz)) * key->zoom_y) - key->ty * TILE_SIZE;
+}
+
+//  サンプルポイントを、タイル上の x 座標に変換する
+static gint _get_x_from_samplepoint(const TileKey *key, gdouble samplepoint)
+{
+    return floor(samplepoint * key->zoom_x) - key->tx * TILE_SIZE;
+}
+
+//  タイルの左端のサンプルポイント
+static gdouble _tile_left_samplepoint(const TileKey *key)
+{
+    return key->tx * TILE_SIZE / key->zoom_x;
+}
+
+//  タイルの上端の周波数(2の対数)
+static gdouble _tile_top_hzlog2(const TileKey *key)
+{
+    return SCREEN_TOP_HZLOG2 - key->ty * TILE_SIZE / key->zoom_y;
 }
 
 /*
@@ -120,26 +156,25 @@ gint _get_y_from_hz(GraphView *gv, gdouble hz)
  *
  *    hz_high_limit : 画面上端の周波数
  *    zoom : 拡大率。1オクターブを画面上のpix数で表したもの
+ *
+ *    線は、タイル key の画素バッファ r に描く。
  */ 
-static void _draw_tone_lines(GraphView *gv) 
+static void _draw_tone_lines(const TileKey *key, Raster *r) 
 {
-    GtkWidget *graph = gv->graph;
-    GdkGC *gc = gdk_gc_new(graph->window);
+    static const unsigned char dark[3]  = { 156, 156, 156 };
+    static const unsigned char light[3] = { 214, 214, 214 };
 
-    //  表示領域の水平,垂直座標の範囲
-    gint screen_left   =   0;
+    //  表示領域の垂直座標の範囲
     gint screen_top    =   0;
-    gint screen_right;
-    gint screen_bottom;
-
-    gdk_drawable_get_size(graph->window, &screen_right, &screen_bottom);
+    gint screen_bottom =   r->height;
 
     //  画面に表示される周波数の上限
-    int hz_high_limit = pow(2.0, gv->screen_top_hzlog2);
+    const double top_hzlog2 = _tile_top_hzlog2(key);
+    int hz_high_limit = pow(2.0, top_hzlog2);
 
     //  画面に表示される周波数の下限
     //  １より小さい場合は、1を下限とする。
-    double hzlog2_low_limit = gv->screen_top_hzlog2 - (screen_bottom - screen_top) / gv->zoom_y;
+    double hzlog2_low_limit = top_hzlog2 - (screen_bottom - screen_top) / key->zoom_y;
     if (hzlog2_low_limit < SCREEN_BOTTOM_HZLOG2) 
         hzlog2_low_limit = SCREEN_BOTTOM_HZLOG2;
     
@@ -158,22 +193,16 @@ static void _draw_tone_lines(GraphView *gv)
         int t;
         for (t = 0; t < 7; t++) {
             //  C なら濃い色、それ以外は薄い線
-            if (t == 2)
-                _set_gc_color(gc, 40000, 40000, 40000);
-            else 
-                _set_gc_color(gc, 55000, 55000, 55000);
+            const unsigned char *color = (t == 2) ? dark : light;
             
             double hz_curr = hz_a * pow( HALFTONE, guide_tone[t] );
              
             //  周波数を、画面上のy座標に変換
-            int y = _get_y_from_hz(gv, hz_curr);
+            int y = _get_y_from_hz(key, hz_curr);
 
             //  y が表示領域内の場合のみ、描画を行う
             if ( y <= screen_bottom && y >= screen_top ) {
-                gdk_draw_line(  graph->window, gc,
-                                screen_left,   y,
-                                screen_right,  y
-                );
+                raster_hline(r, y, color);
             } else if ( y < screen_top ) {
                 //  上限まで描き終えたので、これ以上は描画の必要はない
                 break;
@@ -181,76 +210,271 @@ static void _draw_tone_lines(GraphView *gv)
         } 
         hz_a *= 2;  //  基準のAを1オクターブ上げる
     }
+}
+
+
+/*
+ *  音量に対応する色の表を作る
+ *
+ *    音量が強いほど原色(緑)に近くする。
+ *    最大音量の 1/3 以下のものは描画しない。
+ *    (表示上の最大音量は 0.1 で頭打ちにする)
+ */
+static void _init_color_lut(GraphView *gv)
+{
+    ColorLut *lut = &gv->lut;
+    double maxamp = (gv->maxamp > 0.1) ? 0.1 : gv->maxamp;
+    int i;
+
+    lut->scale = (maxamp > 0) ? (COLOR_LUT_SIZE - 1) / maxamp : 0.0;
+    lut->min_amp = maxamp / 3;
+
+    for (i = 0; i < COLOR_LUT_SIZE; i++) {
+        double rate = (double)i / (COLOR_LUT_SIZE - 1);     //  音量 / 最大音量
+        int red     = 65535 - floor(rate * 65535);
+        int green   = 65535 - floor(rate * 30000);
+        int blue    = 65535 - floor(rate * 65535);
+        if (red   < 0)  red   = 0;
+        if (green < 0)  green = 0;
+        if (blue  < 0)  blue  = 0;
+
+        lut->rgb[i][0] = red   >> 8;
+        lut->rgb[i][1] = green >> 8;
+        lut->rgb[i][2] = blue  >> 8;
+    }
+}
 
-    g_object_unref(gc);
+
+/*
+ *  ピラミッドの段 lv を、タイル key の画素バッファ r に描く
+ *
+ *    1列を、幅が (1列のフレーム数 × フレーム間隔 × zoom_x) の縦の帯として描く。
+ *    描画の量は、データの量ではなく画面の大きさに比例する。
+ */
+static void _draw_pyramid(const GraphView *gv, const TileKey *key, Raster *r,
+                          const PyramidLevel *lv)
+{
+    const Pyramid *pm = gv->pyramid;
+    const ColorLut *lut = &gv->lut;
+    const double column_samples = (double)lv->frames_per_column * gv->samples->interval;
+    const double top_hzlog2 = _tile_top_hzlog2(key);
+    const gint bar_width  = ceil(column_samples * key->zoom_x);
+    const gint bar_height = ceil(key->zoom_y / PYRAMID_ROWS_PER_OCTAVE);
+    const unsigned char *color[256];
+    gsize c;
+    int q, row;
+
+    //  量子化した音量から色を引く表(描画しないものは NULL)
+    for (q = 0; q < 256; q++) {
+        double amp = q * pm->amp_scale;
+        color[q] = (amp > lut->min_amp) ? lut->rgb[color_lut_index(lut, amp)] : NULL;
+    }
+
+    //  表示範囲にある行
+    //  行 row の上端は、周波数が pyramid_row_hzlog2(row + 1) の位置
+    //  上隣のタイルからはみ出してくる行も含める。
+    int row_start = floor((top_hzlog2 - r->height / key->zoom_y - PYRAMID_HZLOG2_LOW)
+                          * PYRAMID_ROWS_PER_OCTAVE);
+    int row_end   = ceil((top_hzlog2 - PYRAMID_HZLOG2_LOW) * PYRAMID_ROWS_PER_OCTAVE) + 1;
+    if (row_start < 0)
+        row_start = 0;
+    if (row_end > pm->num_row)
+        row_end = pm->num_row;
+
+    //  左隣のタイルからはみ出してくる列も含める
+    gsize column_start = floor(_tile_left_samplepoint(key) / column_samples);
+    if (column_start > 0)
+        column_start--;
+
+    for (c = column_start; c < lv->num_column; c++) {
+        const guint8 *cell = lv->cell + c * pm->num_row;
+        gint x = _get_x_from_samplepoint(key, c * column_samples);
+
+        //  右端を越えたら、以降の列は表示されない
+        if (x >= r->width)
+            break;
+
+        for (row = row_start; row < row_end; row++) {
+            if (color[cell[row]]) {
+                gint y = floor((SCREEN_TOP_HZLOG2 - pyramid_row_hzlog2(row + 1)) * key->zoom_y)
+                         - key->ty * TILE_SIZE;
+                raster_fill_rect(r, x, y, bar_width, bar_height, color[cell[row]]);
+            }
+        }
+    }
 }
 
 
-static gboolean _draw_graph(GtkWidget *graph, GdkEventExpose *event, gpointer _gv)
+/*
+ *  タイル key の範囲にあるフレームを画素バッファ r に描く
+ *
+ *    タイルの左端から右端までにあるフレームだけを対象とする。
+ *    1ピクセルに2フレーム以上が重なる倍率では、ピラミッドから描く。
+ */
+static void _draw_samples(const GraphView *gv, const TileKey *key, Raster *r)
 {
-    GdkGC       *gc;
-    GraphView   *gv = _gv;
-    FreqdataList *samples = gv->samples;
+    const FreqdataList *samples = gv->samples;
+    const ColorLut *lut = &gv->lut;
+    //  1ピクセルに 1～2 フレームが重なる倍率でも、幅を 0 にしない
+    const gint bar_width = MAX(1, ceil(samples->interval * key->zoom_x));
+    const PyramidLevel *lv;
+    gsize f, a;
+
+    if (samples->interval <= 0)
+        return;
+
+    lv = pyramid_select(gv->pyramid, 1.0 / (samples->interval * key->zoom_x));
+    if (lv) {
+        _draw_pyramid(gv, key, r, lv);
+        return;
+    }
 
-    printf("Top : %f, Left: %ld\n", gv->screen_top_hzlog2, gv->screen_left_samplepoint);
+    //  左隣のタイルからはみ出してくるフレームも含める
+    gsize sp_index_start = floor( _tile_left_samplepoint(key) / samples->interval );
+    if (sp_index_start > 0)
+        sp_index_start--;
 
-    //  表示画面の幅と高さ
-    gint width, height;
-    gdk_drawable_get_size(graph->window, &width, &height);
+    for (f = sp_index_start; f < samples->num_frame; f++) {
+        gint x = _get_x_from_samplepoint(key, samples->sample_point[f]);
 
-    gc = gdk_gc_new(graph->window);
+        //  右端を越えたら、以降のフレームは表示されない
+        if (x >= r->width)
+            break;
+
+        //  このフレームの組は、配列上で連続している
+        for (a = samples->offset[f]; a < samples->offset[f + 1]; a++) {
+            if (samples->amp[a] > lut->min_amp) {
+                raster_fill_rect(r, x, _get_y_from_hz(key, samples->freq[a]),
+                                 bar_width, 3, lut->rgb[color_lut_index(lut, samples->amp[a])]);
+            }
+        }
+    }
+}
+
+
+/*
+ *  タイル key を描画する(ワーカースレッドから呼ばれる)
+ *
+ *    サンプルデータ・色の表・ピラミッドは読むだけなので、ロックは不要。
+ */
+static void _render_tile(const TileKey *key, Raster *r, gpointer _gv)
+{
+    static const unsigned char white[3] = { 255, 255, 255 };
+    const GraphView *gv = _gv;
 
     //　全体を白で塗りつぶす
-    _set_gc_color(gc, 65535, 65535, 65535);
-    gdk_draw_rectangle( graph->window,
-                        gc,
-                        TRUE,       //  filled
-                        0, 0,       //  x, y
-                        width, height //  width, height
-    );
+    raster_fill(r, white);
 
     //  基準音にグレーのラインを引く
-    _draw_tone_lines(gv);
-    
+    _draw_tone_lines(key, r);
+
     //  音を描画していく
-    int f, a;
-    int sp_index_start = floor( gv->screen_left_samplepoint / samples->interval );
-    for (f = sp_index_start; f < samples->list->len; f++) {
-        Freqdata *freq = g_ptr_array_index(samples->list, f);
-    
-        for (a=0; a < freq->ampdata_ary->len; a++) {
-            Ampdata *amp = g_ptr_array_index(freq->ampdata_ary, a);
-   
-            //  TODO: 
-            double _amp = amp->amp;
-            double _maxamp = gv->maxamp;
-            if (_amp > 0.1) _amp = 0.1;
-            if (_maxamp > 0.1) _maxamp = 0.1;
-            //
-    
-            //  音量が強いほど原色に近くする
-            if (_amp > _maxamp / 3) {
-                int red     = 65535 - floor(_amp * 65535 / _maxamp);
-                int green   = 65535 - floor(_amp * 30000 / _maxamp);
-                int blue    = 65535 - floor(_amp * 65535 / _maxamp);
-                if (red   < 0)  red   = 0;
-                if (green < 0)  green = 0;
-                if (blue  < 0)  blue  = 0;
-                
-                _set_gc_color(gc, red, green, blue);
-                
-                gdk_draw_rectangle( graph->window, 
-                                    gc, 
-                                    TRUE,
-                                    (freq->sample_point - gv->screen_left_samplepoint) * gv->zoom_x,
-                                    _get_y_from_hz(gv, amp->freq),
-                                    samples->interval * gv->zoom_x,
-                                    3
-                );
+    _draw_samples(gv, key, r);
+}
+
+
+/*
+ *  描画が終わったタイルの範囲を描き直す(メインスレッドから呼ばれる)
+ */
+static void _tile_ready(const TileKey *key, gpointer _gv)
+{
+    GraphView *gv = _gv;
+    gint width, height;
+    glong origin_x, origin_y;
+
+    if (!key) {
+        gtk_widget_queue_draw(gv->graph);
+        return;
+    }
+
+    //  倍率が変わっていれば、もう表示されない
+    if (key->zoom_x != gv->zoom_x || key->zoom_y != gv->zoom_y)
+        return;
+
+    gdk_drawable_get_size(gv->graph->window, &width, &height);
+    _get_screen_origin(gv, &origin_x, &origin_y);
+    gint x = key->tx * TILE_SIZE - origin_x;
+    gint y = key->ty * TILE_SIZE - origin_y;
+    if (x + TILE_SIZE > 0 && x < width && y + TILE_SIZE > 0 && y < height)
+        gtk_widget_queue_draw_area(gv->graph, x, y, TILE_SIZE, TILE_SIZE);
+}
+
+
+/*
+ *  描画が終わっていないタイルの代わりに表示するものを描く
+ *
+ *    基準音のラインだけを描いたもの。
+ */
+static void _draw_placeholder(const TileKey *key, Raster *r)
+{
+    static const unsigned char white[3] = { 255, 255, 255 };
+
+    raster_resize(r, TILE_SIZE, TILE_SIZE);
+    raster_fill(r, white);
+    _draw_tone_lines(key, r);
+}
+
+
+/*
+ *  画面を描画する
+ *
+ *    描き直しを要求された範囲(event->area)に掛かるタイルを、
+ *    キャッシュから取り出して、その範囲の部分だけを転送する。
+ *    描画が終わっていないタイルは、ワーカースレッドに描画を依頼し、
+ *    終わるまでは代わりのものを表示しておく。
+ */
+static gboolean _draw_graph(GtkWidget *graph, GdkEventExpose *event, gpointer _gv)
+{
+    GdkGC       *gc;
+    GraphView   *gv = _gv;
+    TileKey     key;
+
+    //  描き直す範囲(画面上の座標)
+    const GdkRectangle *area = &event->area;
+    if (area->width <= 0 || area->height <= 0)
+        return TRUE;
+
+    //  同じ範囲の、グラフ全体での座標
+    glong origin_x, origin_y;
+    _get_screen_origin(gv, &origin_x, &origin_y);
+    glong left   = origin_x + area->x;
+    glong top    = origin_y + area->y;
+    glong right  = left + area->width;
+    glong bottom = top + area->height;
+
+    key.zoom_x = gv->zoom_x;
+    key.zoom_y = gv->zoom_y;
+
+    //  画面に掛かるタイルの数の2倍を保持する
+    //  (スクロール中に画面外へ出た描画待ちのタイルがあっても、依頼できるように)
+    gint width, height;
+    gdk_drawable_get_size(graph->window, &width, &height);
+    tile_cache_reserve(gv->tiles, 2 * (width / TILE_SIZE + 2) * (height / TILE_SIZE + 2));
+
+    gc = gdk_gc_new(graph->window);
+    for (key.ty = top / TILE_SIZE; key.ty * TILE_SIZE < bottom; key.ty++) {
+        for (key.tx = left / TILE_SIZE; key.tx * TILE_SIZE < right; key.tx++) {
+            const Raster *tile = gv->samples ? tile_cache_lookup(gv->tiles, &key) : NULL;
+            if (!tile) {
+                _draw_placeholder(&key, gv->raster);
+                tile = gv->raster;
             }
+
+            //  タイルのうち、描き直す範囲に掛かる部分
+            glong x0 = MAX(left,   key.tx * TILE_SIZE);
+            glong y0 = MAX(top,    key.ty * TILE_SIZE);
+            glong x1 = MIN(right,  (key.tx + 1) * TILE_SIZE);
+            glong y1 = MIN(bottom, (key.ty + 1) * TILE_SIZE);
+
+            gdk_draw_rgb_image( graph->window, gc,
+                                x0 - origin_x, y0 - origin_y,
+                                x1 - x0, y1 - y0,
+                                GDK_RGB_DITHER_NONE,
+                                tile->pixels + (y0 - key.ty * TILE_SIZE) * tile->rowstride
+                                             + (x0 - key.tx * TILE_SIZE) * 3,
+                                tile->rowstride );
         }
     }
-
     g_object_unref(gc); 
 
     return TRUE;
@@ -277,6 +501,11 @@ GraphView *graphview_new(GtkWidget *window)
     gv->screen_left_samplepoint = SCREEN_LEFT_SAMPLEPOINT;
     gv->zoom_x = ZOOM_X;
     gv->zoom_y = ZOOM_Y;
+    gv->samples = NULL;
+    gv->maxamp = 0.0;
+    gv->raster = raster_new(0, 0);
+    gv->pyramid = NULL;
+    gv->tiles = tile_cache_new(_render_tile, _tile_ready, gv);
 
     //  スクロールウィンドウの生成
     gv->swin = gtk_scrolled_window_new(NULL, NULL);
@@ -308,17 +537,12 @@ GraphView *graphview_new(GtkWidget *window)
 double _get_maxamp(FreqdataList *sample)
 {
     double max = 0.00;
-    int f, a;
+    gsize a;
     
-    GPtrArray *flist = sample->list;
-    for (f=0; f < flist->len; f++) {
-        Freqdata *fdata = g_ptr_array_index( flist, f );
-        GPtrArray *alist = fdata->ampdata_ary;
-        for (a=0; a < alist->len; a++) {
-            Ampdata *adata = g_ptr_array_index( alist, a );
-            if (max < fabs(adata->amp)) 
-                max = fabs(adata->amp);
-        }
+    //  全フレームの音量は1つの配列に並んでいる
+    for (a=0; a < sample->num_amp; a++) {
+        if (max < fabs(sample->amp[a])) 
+            max = fabs(sample->amp[a]);
     }
 
     return max;
@@ -337,19 +561,37 @@ double _get_maxamp(FreqdataList *sample)
 void graphview_set_sample_data(GraphView *gv, FreqdataList *sample)
 {
     gint width, height;
+
+    //  描画中のタイルが、古いデータを参照しないようにする
+    tile_cache_clear(gv->tiles);
     gv->samples = sample;
 
     GtkAdjustment *horizontal 
         = gtk_scrolled_window_get_hadjustment( GTK_SCROLLED_WINDOW(gv->swin) );
     gtk_adjustment_set_upper(horizontal, sample->num_sample);
 
-    gv->maxamp = _get_maxamp(sample);
+    //  ファイルに最大音量が記録されていれば、それを使う
+    gv->maxamp = (sample->maxamp > 0) ? sample->maxamp : _get_maxamp(sample);
+    _init_color_lut(gv);
+
+    //  縮小表示用のピラミッドを作る
+    pyramid_free(gv->pyramid);
+    gv->pyramid = pyramid_new(sample, gv->maxamp);
     
     //  サンプルデータに合わせてDrawingAreaの大きさを変える
     width  = (sample->num_sample * sample->interval) * ZOOM_X;
     height = (SCREEN_TOP_HZLOG2 - SCREEN_BOTTOM_HZLOG2) * ZOOM_Y; 
     gtk_widget_set_size_request(gv->graph, width, height);
 }
+
+
+/*
+ * タイルを1枚描画する
+ */
+void graphview_render_tile(const GraphView *gv, const TileKey *key, Raster *r)
+{
+    _render_tile(key, r, (gpointer)gv);
+}
     
 
 /*
@@ -357,6 +599,9 @@ void graphview_set_sample_data(GraphView *gv, FreqdataList *sample)
  *
  */
 void graphview_free(GraphView *gv) {
+    tile_cache_free(gv->tiles);
+    raster_free(gv->raster);
+    pyramid_free(gv->pyramid);
     free(gv);
 }
 
@@ -367,7 +612,7 @@ void graphview_free(GraphView *gv) {
  */
 void graphview_free_with_samples(GraphView *gv)
 {
-    g_ptr_array_free(gv->samples->list, TRUE);
+    freqdata_list_clear(gv->samples);
     graphview_free(gv);
 }   
 
@@ -11,6 +11,9 @@
 #include <glib.h>
 
 #include "freqdatalist.h"
+#include "raster.h"
+#include "pyramid.h"
+#include "tilecache.h"
 
 
 typedef struct _graphview {
@@ -22,6 +25,10 @@ typedef struct _graphview {
     gdouble         zoom_y;                     //   y軸ズームレベル(pixel/octave)
     GtkWidget       *swin;                      //   スクロールウィンドウ
     GtkWidget       *graph;                     //   グラフを表示するエリア
+    Raster          *raster;                    //   描画待ちのタイルの代わりに表示するもの
+    ColorLut        lut;                        //   音量から色を引く表
+    Pyramid         *pyramid;                   //   縮小表示用のデータ
+    TileCache       *tiles;                     //   描画済みのタイル
 } GraphView;
 
 
@@ -52,6 +59,20 @@ GraphView *graphview_new(GtkWidget *window);
 void graphview_set_sample_data(GraphView *gv, FreqdataList *sample);
     
 
+/*
+ * タイルを1枚描画する
+ *
+ * 引数：
+ *   gv  : 描画する GraphView オブジェクト
+ *   key : 描画するタイル
+ *   r   : 描画先の画素バッファ(TILE_SIZE × TILE_SIZE)
+ *
+ * タイルキャッシュのワーカースレッドが使うものと同じ描画処理を、
+ * 呼び出し元のスレッドで行う。描画の計測(bench.c)のためのもの。
+ */
+void graphview_render_tile(const GraphView *gv, const TileKey *key, Raster *r);
+
+
 /*
  * Graphview オブジェクトを開放する
  */
@@ -0,0 +1,166 @@
+/*
+ * pyramid.c
+ *   縮小表示用の多段階の解像度のデータ(ピラミッド)
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "pyramid.h"
+
+
+//  calloc のラッパ関数
+//  確保に失敗した場合はエラー終了する。
+static void *_pyramid_calloc(size_t num, size_t size)
+{
+    void *ptr = calloc(num ? num : 1, size);
+    if (!ptr) {
+        perror("Failed to allocate memory for pyramid");
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+
+//  周波数から行を引く表を作る
+//  範囲外の周波数は -1 とする。
+static int *_make_row_table(const FreqdataList *fl, int num_row, gint32 *max_freq)
+{
+    int *row;
+    gsize a;
+    gint32 f;
+
+    *max_freq = 0;
+    for (a = 0; a < fl->num_amp; a++) {
+        if (*max_freq < fl->freq[a])
+            *max_freq = fl->freq[a];
+    }
+
+    row = _pyramid_calloc(*max_freq + 1, sizeof(int));
+    for (f = 0; f <= *max_freq; f++) {
+        double r = (f > 0) ? floor((log2(f) - PYRAMID_HZLOG2_LOW) * PYRAMID_ROWS_PER_OCTAVE) : -1;
+        row[f] = (r >= 0 && r < num_row) ? (int)r : -1;
+    }
+
+    return row;
+}
+
+
+/*
+ * ピラミッドを作成する
+ *
+ * 1段目は元のデータから、2段目以降は1つ前の段の2列ずつから作る。
+ */
+Pyramid *pyramid_new(const FreqdataList *fl, double maxamp)
+{
+    Pyramid *pm = _pyramid_calloc(1, sizeof(Pyramid));
+    const int num_row = (PYRAMID_HZLOG2_HIGH - PYRAMID_HZLOG2_LOW) * PYRAMID_ROWS_PER_OCTAVE;
+    glong num_frame_index = 0;
+    gint32 max_freq;
+    int *row;
+    gsize f, a;
+    int l;
+
+    pm->num_row = num_row;
+    pm->amp_scale = (maxamp > 0) ? maxamp / 255 : 1.0;
+    if (fl->num_frame == 0 || fl->interval <= 0)
+        return pm;
+
+    //  フレーム番号の最大値
+    for (f = 0; f < fl->num_frame; f++) {
+        glong index = fl->sample_point[f] / fl->interval;
+        if (num_frame_index < index + 1)
+            num_frame_index = index + 1;
+    }
+
+    //  1段目
+    PyramidLevel *lv = &pm->level[0];
+    lv->frames_per_column = 2;
+    lv->num_column = (num_frame_index + 1) / 2;
+    lv->cell = _pyramid_calloc(lv->num_column * num_row, sizeof(guint8));
+
+    row = _make_row_table(fl, num_row, &max_freq);
+    for (f = 0; f < fl->num_frame; f++) {
+        glong index = fl->sample_point[f] / fl->interval;
+        guint8 *column;
+
+        if (index < 0)
+            continue;
+        column = lv->cell + (index / 2) * num_row;
+
+        for (a = fl->offset[f]; a < fl->offset[f + 1]; a++) {
+            int r = (fl->freq[a] >= 0) ? row[fl->freq[a]] : -1;
+            double q;
+
+            if (r < 0)
+                continue;
+
+            //  量子化で音量が下がらないよう、切り上げる
+            q = ceil(fl->amp[a] / pm->amp_scale);
+            if (q > 255)
+                q = 255;
+            if (column[r] < q)
+                column[r] = q;
+        }
+    }
+    free(row);
+
+    //  2段目以降
+    for (l = 1; l < PYRAMID_MAX_LEVEL && pm->level[l - 1].num_column > 1; l++) {
+        const PyramidLevel *prev = &pm->level[l - 1];
+        gsize c;
+        int r;
+
+        lv = &pm->level[l];
+        lv->frames_per_column = prev->frames_per_column * 2;
+        lv->num_column = (prev->num_column + 1) / 2;
+        lv->cell = _pyramid_calloc(lv->num_column * num_row, sizeof(guint8));
+
+        for (c = 0; c < prev->num_column; c++) {
+            const guint8 *src = prev->cell + c * num_row;
+            guint8 *dst = lv->cell + (c / 2) * num_row;
+            for (r = 0; r < num_row; r++) {
+                if (dst[r] < src[r])
+                    dst[r] = src[r];
+            }
+        }
+    }
+    pm->num_level = l;
+
+    return pm;
+}
+
+
+/*
+ * 表示の倍率に合った段を選ぶ
+ */
+const PyramidLevel *pyramid_select(const Pyramid *pm, double frames_per_pixel)
+{
+    const PyramidLevel *found = NULL;
+    int l;
+
+    for (l = 0; l < pm->num_level; l++) {
+        if (pm->level[l].frames_per_column > frames_per_pixel)
+            break;
+        found = &pm->level[l];
+    }
+
+    return found;
+}
+
+
+/*
+ * Pyramid オブジェクトを開放する
+ */
+void pyramid_free(Pyramid *pm)
+{
+    int l;
+
+    if (pm) {
+        for (l = 0; l < pm->num_level; l++)
+            free(pm->level[l].cell);
+        free(pm);
+    }
+}
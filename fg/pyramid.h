@@ -0,0 +1,92 @@
+/*
+ * pyramid.h
+ *   縮小表示用の多段階の解像度のデータ(ピラミッド)
+ *
+ *   横方向(時間)に縮小して表示すると、画面の1ピクセルに多数のフレームが
+ *   重なる。その場合でもすべてのフレームを描画していると、描画の時間が
+ *   データの量に比例してしまう。
+ *
+ *   そこで、あらかじめ 2^n フレームずつ(n = 1, 2, ...)まとめたデータを
+ *   作っておき、表示の倍率に合ったものを描画する。周波数の方向も、
+ *   対数で等間隔の行にまとめる。まとめる際は、音量の最大値を取る。
+ *   音量は 8bit に量子化して保持する。
+ *
+ *   GTK/GDK には依存しない。
+ */
+
+#ifndef __PYRAMID_H__
+#define __PYRAMID_H__
+
+#include <glib.h>
+#include "freqdatalist.h"
+
+//  周波数方向の行の数(1オクターブあたり)
+#define PYRAMID_ROWS_PER_OCTAVE     64
+
+//  行の範囲(周波数の2の対数)
+#define PYRAMID_HZLOG2_LOW          5.0
+#define PYRAMID_HZLOG2_HIGH         14.0
+
+//  段の数の上限
+#define PYRAMID_MAX_LEVEL           40
+
+
+//  ピラミッドの1段分
+//  列 c は、フレーム番号(サンプルポイント / interval)が
+//  c * frames_per_column ～ (c + 1) * frames_per_column - 1 のものをまとめたもの。
+typedef struct _pyramid_level {
+    glong       frames_per_column;  //  1列にまとめたフレーム数(2 の累乗)
+    gsize       num_column;         //  列の数
+    guint8      *cell;              //  音量(列 c, 行 r の値は cell[c * num_row + r])
+} PyramidLevel;
+
+
+//  Pyramid 構造体
+typedef struct _pyramid {
+    int         num_row;            //  行の数
+    double      amp_scale;          //  音量 = cell の値 * amp_scale
+    int         num_level;          //  段の数
+    PyramidLevel level[PYRAMID_MAX_LEVEL];  //  level[i] は 2^(i+1) フレームずつまとめたもの
+} Pyramid;
+
+
+/*
+ * ピラミッドを作成する
+ *
+ * 引数：
+ *   fl     : 元のデータ
+ *   maxamp : 量子化の基準とする最大音量
+ */
+Pyramid *pyramid_new(const FreqdataList *fl, double maxamp);
+
+
+/*
+ * 表示の倍率に合った段を選ぶ
+ *
+ * 引数：
+ *   frames_per_pixel : 画面の1ピクセルあたりのフレーム数
+ *
+ * 戻値：
+ *   1列のフレーム数が frames_per_pixel 以下で最も大きい段。
+ *   frames_per_pixel が 2 未満の場合は NULL(元のデータを描画する)。
+ */
+const PyramidLevel *pyramid_select(const Pyramid *pm, double frames_per_pixel);
+
+
+/*
+ * 行 r の下端の周波数(2の対数)
+ */
+static inline double pyramid_row_hzlog2(int r)
+{
+    return PYRAMID_HZLOG2_LOW + (double)r / PYRAMID_ROWS_PER_OCTAVE;
+}
+
+
+/*
+ * Pyramid オブジェクトを開放する
+ */
+void pyramid_free(Pyramid *pm);
+
+
+#endif
+
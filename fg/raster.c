@@ -0,0 +1,121 @@
+/*
+ * raster.c
+ *   RGB の画素バッファへの描画を行う
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "raster.h"
+
+
+/*
+ * Raster オブジェクトを新規作成する
+ */
+Raster *raster_new(int width, int height)
+{
+    Raster *r = malloc(sizeof(Raster));
+    if (!r) {
+        perror("Failed to allocate memory for raster");
+        exit(EXIT_FAILURE);
+    }
+    r->pixels = NULL;
+    r->capacity = 0;
+    raster_resize(r, width, height);
+    return r;
+}
+
+
+/*
+ * 大きさを変更する
+ */
+void raster_resize(Raster *r, int width, int height)
+{
+    size_t size;
+
+    if (width < 0)  width = 0;
+    if (height < 0) height = 0;
+
+    r->width = width;
+    r->height = height;
+    r->rowstride = (width * 3 + 3) & ~3;    //  4 バイト境界に揃える
+
+    size = (size_t)r->rowstride * height;
+    if (size > r->capacity) {
+        free(r->pixels);
+        r->pixels = malloc(size);
+        if (!r->pixels) {
+            perror("Failed to allocate memory for raster");
+            exit(EXIT_FAILURE);
+        }
+        r->capacity = size;
+    }
+}
+
+
+/*
+ * 全体を1色で塗りつぶす
+ */
+void raster_fill(Raster *r, const unsigned char *rgb)
+{
+    raster_fill_rect(r, 0, 0, r->width, r->height, rgb);
+}
+
+
+/*
+ * 水平線を引く
+ */
+void raster_hline(Raster *r, int y, const unsigned char *rgb)
+{
+    raster_fill_rect(r, 0, y, r->width, 1, rgb);
+}
+
+
+/*
+ * 塗りつぶした矩形を描く
+ *
+ * 1行目を塗り、2行目以降はそれをコピーする。
+ */
+void raster_fill_rect(Raster *r, int x, int y, int width, int height, const unsigned char *rgb)
+{
+    unsigned char *row, *p;
+    int i;
+
+    //  はみ出す部分を切り取る
+    if (x < 0) {
+        width += x;
+        x = 0;
+    }
+    if (y < 0) {
+        height += y;
+        y = 0;
+    }
+    if (x + width > r->width)
+        width = r->width - x;
+    if (y + height > r->height)
+        height = r->height - y;
+    if (width <= 0 || height <= 0)
+        return;
+
+    row = r->pixels + (size_t)y * r->rowstride + x * 3;
+    for (i = 0, p = row; i < width; i++, p += 3) {
+        p[0] = rgb[0];
+        p[1] = rgb[1];
+        p[2] = rgb[2];
+    }
+    for (i = 1; i < height; i++)
+        memcpy(row + (size_t)i * r->rowstride, row, width * 3);
+}
+
+
+/*
+ * Raster オブジェクトを開放する
+ */
+void raster_free(Raster *r)
+{
+    if (r) {
+        free(r->pixels);
+        free(r);
+    }
+}
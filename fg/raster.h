@@ -0,0 +1,94 @@
+/*
+ * raster.h
+ *   RGB の画素バッファへの描画を行う
+ *
+ *   描画はすべてメモリ上のバッファに対して行い、画面への転送は
+ *   呼び出し元が一度だけ行う(gdk_draw_rgb_image() など)。
+ *   GTK/GDK には依存しない。
+ */
+
+#ifndef __RASTER_H__
+#define __RASTER_H__
+
+#include <stddef.h>
+
+//  色の表の大きさ
+#define COLOR_LUT_SIZE  256
+
+
+//  Raster 構造体
+typedef struct _raster {
+    int             width;      //  幅(pixel)
+    int             height;     //  高さ(pixel)
+    int             rowstride;  //  1行あたりのバイト数
+    unsigned char   *pixels;    //  画素(1画素あたり R, G, B の3バイト)
+    size_t          capacity;   //  確保済みのバイト数
+} Raster;
+
+
+//  音量から色を引く表
+//  音量 amp の色は rgb[min(amp * scale, COLOR_LUT_SIZE - 1)]。
+//  音量が min_amp 以下の場合は描画しない。
+typedef struct _color_lut {
+    double          scale;
+    double          min_amp;
+    unsigned char   rgb[COLOR_LUT_SIZE][3];
+} ColorLut;
+
+
+/*
+ * Raster オブジェクトを新規作成する
+ */
+Raster *raster_new(int width, int height);
+
+
+/*
+ * 大きさを変更する
+ *
+ * 内容は不定となる。確保済みの領域で足りる場合は、確保し直さない。
+ */
+void raster_resize(Raster *r, int width, int height);
+
+
+/*
+ * 全体を1色で塗りつぶす
+ */
+void raster_fill(Raster *r, const unsigned char *rgb);
+
+
+/*
+ * 水平線を引く
+ *
+ * y が範囲外の場合は何もしない。
+ */
+void raster_hline(Raster *r, int y, const unsigned char *rgb);
+
+
+/*
+ * 塗りつぶした矩形を描く
+ *
+ * バッファからはみ出す部分は描画しない。
+ */
+void raster_fill_rect(Raster *r, int x, int y, int width, int height, const unsigned char *rgb);
+
+
+/*
+ * 音量に対応する色の添字を返す
+ */
+static inline int color_lut_index(const ColorLut *lut, double amp)
+{
+    double i = amp * lut->scale;
+    if (i >= COLOR_LUT_SIZE - 1)
+        return COLOR_LUT_SIZE - 1;
+    return (i > 0) ? (int)i : 0;
+}
+
+
+/*
+ * Raster オブジェクトを開放する
+ */
+void raster_free(Raster *r);
+
+
+#endif
+
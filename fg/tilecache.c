@@ -0,0 +1,243 @@
+/*
+ * tilecache.c
+ *   描画済みのタイルを保持するキャッシュ
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "tilecache.h"
+
+
+static void _render_tile(gpointer _tile, gpointer _tc);
+
+
+//  ワーカースレッドのプールを作る
+static GThreadPool *_new_pool(TileCache *tc)
+{
+    int num_thread = g_get_num_processors();
+    if (num_thread > MAX_RENDER_THREAD)
+        num_thread = MAX_RENDER_THREAD;
+    if (num_thread < 1)
+        num_thread = 1;
+
+    return g_thread_pool_new(_render_tile, tc, num_thread, FALSE, NULL);
+}
+
+
+//  キーが等しいかどうか
+static gboolean _key_equal(const TileKey *a, const TileKey *b)
+{
+    return a->tx == b->tx && a->ty == b->ty
+        && a->zoom_x == b->zoom_x && a->zoom_y == b->zoom_y;
+}
+
+
+/*
+ * TileCache オブジェクトを新規作成する
+ */
+TileCache *tile_cache_new(TileRenderFunc render, TileReadyFunc ready_func, gpointer data)
+{
+    TileCache *tc = malloc(sizeof(TileCache));
+
+    if (!tc) {
+        perror("Failed to allocate memory for tile cache");
+        exit(EXIT_FAILURE);
+    }
+
+    tc->tile = NULL;
+    tc->num_tile = 0;
+    tile_cache_reserve(tc, TILE_CACHE_SIZE);
+    tc->clock = 0;
+    g_mutex_init(&tc->lock);
+    tc->render = render;
+    tc->ready_func = ready_func;
+    tc->data = data;
+    tc->num_ready = 0;
+    tc->idle_id = 0;
+    tc->pool = _new_pool(tc);
+
+    return tc;
+}
+
+
+/*
+ * 保持するタイルの数を num 個以上にする
+ *
+ * ワーカースレッドは Tile へのポインタを持つので、Tile 自体は移動しない。
+ */
+void tile_cache_reserve(TileCache *tc, int num)
+{
+    int i;
+
+    if (num <= tc->num_tile)
+        return;
+
+    tc->tile = realloc(tc->tile, sizeof(Tile *) * num);
+    if (!tc->tile) {
+        perror("Failed to allocate memory for tile cache");
+        exit(EXIT_FAILURE);
+    }
+    for (i = tc->num_tile; i < num; i++) {
+        Tile *tile = malloc(sizeof(Tile));
+        if (!tile) {
+            perror("Failed to allocate memory for tile");
+            exit(EXIT_FAILURE);
+        }
+        tile->state = TILE_EMPTY;
+        tile->last_used = 0;
+        tile->raster = raster_new(TILE_SIZE, TILE_SIZE);
+        tc->tile[i] = tile;
+    }
+    tc->num_tile = num;
+}
+
+
+//  描画が終わったタイルを知らせる(メインスレッドで実行されるアイドル関数)
+static gboolean _notify_ready(gpointer _tc)
+{
+    TileCache *tc = _tc;
+    TileKey ready[TILE_CACHE_SIZE];
+    int num_ready, i;
+
+    g_mutex_lock(&tc->lock);
+    num_ready = tc->num_ready;
+    if (num_ready > 0)
+        memcpy(ready, tc->ready, sizeof(TileKey) * num_ready);
+    tc->num_ready = 0;
+    tc->idle_id = 0;
+    g_mutex_unlock(&tc->lock);
+
+    if (num_ready < 0)
+        tc->ready_func(NULL, tc->data);
+    for (i = 0; i < num_ready; i++)
+        tc->ready_func(&ready[i], tc->data);
+
+    return FALSE;
+}
+
+
+//  タイルを描画する(ワーカースレッドで実行される)
+//
+//  描画待ちのタイルは、メインスレッドからは変更されないので、
+//  画素バッファにはロックせずに描画してよい。
+static void _render_tile(gpointer _tile, gpointer _tc)
+{
+    TileCache *tc = _tc;
+    Tile *tile = _tile;
+
+    tc->render(&tile->key, tile->raster, tc->data);
+
+    g_mutex_lock(&tc->lock);
+    tile->state = TILE_READY;
+    if (tc->num_ready >= 0 && tc->num_ready < TILE_CACHE_SIZE)
+        tc->ready[tc->num_ready++] = tile->key;
+    else
+        tc->num_ready = -1;
+    if (!tc->idle_id)
+        tc->idle_id = g_idle_add(_notify_ready, tc);
+    g_mutex_unlock(&tc->lock);
+}
+
+
+/*
+ * 描画済みのタイルを取得する
+ */
+const Raster *tile_cache_lookup(TileCache *tc, const TileKey *key)
+{
+    Tile *found = NULL, *victim = NULL;
+    int i, state;
+
+    tc->clock++;
+
+    g_mutex_lock(&tc->lock);
+    for (i = 0; i < tc->num_tile; i++) {
+        Tile *tile = tc->tile[i];
+
+        if (tile->state != TILE_EMPTY && _key_equal(&tile->key, key)) {
+            found = tile;
+            break;
+        }
+
+        //  描画待ちのもの以外で、最も長く使われていないものを捨てる候補とする
+        if (tile->state == TILE_PENDING)
+            continue;
+        if (!victim
+                || (victim->state != TILE_EMPTY
+                    && (tile->state == TILE_EMPTY || tile->last_used < victim->last_used)))
+            victim = tile;
+    }
+
+    if (found) {
+        found->last_used = tc->clock;
+        state = found->state;
+        g_mutex_unlock(&tc->lock);
+        return (state == TILE_READY) ? found->raster : NULL;
+    }
+
+    //  すべて描画待ちの場合は依頼しない。
+    //  いずれかの描画が終わったときに全体を描き直させ、そこで改めて依頼する
+    if (victim) {
+        victim->key = *key;
+        victim->state = TILE_PENDING;
+        victim->last_used = tc->clock;
+    } else {
+        tc->num_ready = -1;
+    }
+    g_mutex_unlock(&tc->lock);
+
+    if (victim)
+        g_thread_pool_push(tc->pool, victim, NULL);
+
+    return NULL;
+}
+
+
+//  描画待ちのタイルをすべて片付け、スレッドを終了する
+static void _stop_pool(TileCache *tc)
+{
+    //  待ち行列に残っているものは描画せず、描画中のものは終わるまで待つ
+    g_thread_pool_free(tc->pool, TRUE, TRUE);
+    tc->pool = NULL;
+
+    if (tc->idle_id) {
+        g_source_remove(tc->idle_id);
+        tc->idle_id = 0;
+    }
+    tc->num_ready = 0;
+}
+
+
+/*
+ * すべてのタイルを捨てる
+ */
+void tile_cache_clear(TileCache *tc)
+{
+    int i;
+
+    _stop_pool(tc);
+    for (i = 0; i < tc->num_tile; i++)
+        tc->tile[i]->state = TILE_EMPTY;
+    tc->pool = _new_pool(tc);
+}
+
+
+/*
+ * TileCache オブジェクトを開放する
+ */
+void tile_cache_free(TileCache *tc)
+{
+    int i;
+
+    if (tc) {
+        _stop_pool(tc);
+        for (i = 0; i < tc->num_tile; i++) {
+            raster_free(tc->tile[i]->raster);
+            free(tc->tile[i]);
+        }
+        free(tc->tile);
+        g_mutex_clear(&tc->lock);
+        free(tc);
+    }
+}
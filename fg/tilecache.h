@@ -0,0 +1,134 @@
+/*
+ * tilecache.h
+ *   描画済みのタイルを保持するキャッシュ
+ *
+ *   グラフ全体を TILE_SIZE × TILE_SIZE ピクセルのタイルに分割し、
+ *   タイルごとに画素バッファへ描画する。描画はワーカースレッドで行い、
+ *   メインスレッドは描画済みのタイルを画面に転送するだけとする。
+ *
+ *   描画済みのタイルは tile_cache_reserve() で指定した数(最小 TILE_CACHE_SIZE 個)まで
+ *   保持し、足りなくなった場合は最も長く使われていないものを捨てる。
+ */
+
+#ifndef __TILECACHE_H__
+#define __TILECACHE_H__
+
+#include <glib.h>
+#include "raster.h"
+
+//  タイルの一辺の大きさ(pixel)
+#define TILE_SIZE           256
+
+//  保持するタイルの数の最小値
+//  画面の大きさに応じて、tile_cache_reserve() で増やす。
+#define TILE_CACHE_SIZE     128
+
+//  描画を行うスレッドの数の上限
+#define MAX_RENDER_THREAD   4
+
+//  タイルの状態
+#define TILE_EMPTY      0   //  未使用
+#define TILE_PENDING    1   //  描画待ち、または描画中
+#define TILE_READY      2   //  描画済み
+
+
+//  タイルを特定するキー
+//  タイル (tx, ty) は、グラフ全体の座標で
+//  x = tx * TILE_SIZE ～ (tx + 1) * TILE_SIZE - 1,
+//  y = ty * TILE_SIZE ～ (ty + 1) * TILE_SIZE - 1 の範囲。
+//  グラフ全体の座標は、倍率 (zoom_x, zoom_y) によって変わる。
+typedef struct _tile_key {
+    glong       tx;
+    glong       ty;
+    gdouble     zoom_x;
+    gdouble     zoom_y;
+} TileKey;
+
+
+//  タイル
+typedef struct _tile {
+    TileKey     key;
+    int         state;          //  TILE_EMPTY, TILE_PENDING, TILE_READY
+    guint64     last_used;      //  最後に参照した時刻(TileCache の clock)
+    Raster      *raster;        //  画素バッファ(TILE_SIZE × TILE_SIZE)
+} Tile;
+
+
+//  タイルを描画する関数(ワーカースレッドから呼ばれる)
+typedef void (*TileRenderFunc)(const TileKey *key, Raster *r, gpointer data);
+
+//  タイルの描画が終わったことを知らせる関数(メインスレッドから呼ばれる)
+//  key が NULL の場合は、どのタイルか特定できないので全体を描き直すこと。
+typedef void (*TileReadyFunc)(const TileKey *key, gpointer data);
+
+
+//  TileCache 構造体
+typedef struct _tile_cache {
+    Tile            **tile;         //  タイル(num_tile 個)。メインスレッドからのみ参照する
+    int             num_tile;
+    guint64         clock;          //  参照のたびに増やす
+    GMutex          lock;           //  tile[]->state と ready[] を保護する
+    GThreadPool     *pool;
+    TileRenderFunc  render;
+    TileReadyFunc   ready_func;
+    gpointer        data;           //  render, ready_func に渡すデータ
+
+    //  描画が終わり、まだ知らせていないタイル
+    TileKey         ready[TILE_CACHE_SIZE];
+    int             num_ready;      //  -1 の場合は溢れたか、依頼できなかったタイルがある
+    guint           idle_id;        //  知らせるためのアイドル関数(0 なら未登録)
+} TileCache;
+
+
+/*
+ * TileCache オブジェクトを新規作成する
+ *
+ * 引数：
+ *   render     : タイルを描画する関数
+ *   ready_func : タイルの描画が終わったことを知らせる関数
+ *   data       : render, ready_func に渡すデータ
+ */
+TileCache *tile_cache_new(TileRenderFunc render, TileReadyFunc ready_func, gpointer data);
+
+
+/*
+ * 保持するタイルの数を num 個以上にする
+ *
+ * 画面に同時に表示されるタイルの数より十分多くしておくこと。
+ * 減らすことはしない。メインスレッドからのみ呼ぶこと。
+ */
+void tile_cache_reserve(TileCache *tc, int num);
+
+
+/*
+ * 描画済みのタイルを取得する
+ *
+ * 戻値：
+ *   描画済みであれば、その画素バッファ。
+ *   そうでなければ NULL を返し、まだ依頼していなければ描画を依頼する。
+ *   すべてのタイルが描画待ちで依頼できなかった場合は、いずれかの描画が
+ *   終わったときに、全体の描き直しを知らせる(ready_func に NULL を渡す)。
+ *
+ *   返した画素バッファは、次に tile_cache_lookup() を呼ぶまで有効。
+ *   メインスレッドからのみ呼ぶこと。
+ */
+const Raster *tile_cache_lookup(TileCache *tc, const TileKey *key);
+
+
+/*
+ * すべてのタイルを捨てる
+ *
+ * 描画中のタイルがあれば、終わるまで待つ。
+ * 描画に使うデータを変更する前に呼ぶこと。
+ */
+void tile_cache_clear(TileCache *tc);
+
+
+/*
+ * TileCache オブジェクトを開放する
+ */
+void tile_cache_free(TileCache *tc);
+
+
+#endif
+
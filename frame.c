@@ -0,0 +1,248 @@
+/*
+ *  frame.c
+ *
+ *  解析フレームの切り出しを行う
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "frame.h"
+
+
+//  窓関数の名前と種類の対応
+static const struct {
+    const char  *name;
+    int         type;
+} window_names[] = {
+    { "rect",       WINDOW_RECT     },
+    { "taper",      WINDOW_TAPER    },
+    { "hann",       WINDOW_HANN     },
+    { "hamming",    WINDOW_HAMMING  },
+    { "blackman",   WINDOW_BLACKMAN },
+};
+
+
+//  malloc のラッパ関数
+//  確保に失敗した場合はエラー終了する。
+static void *_frame_alloc(size_t size)
+{
+    void *ptr = malloc(size);
+    if (!ptr) {
+        perror("Failed to allocate memory for framer");
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+
+/*
+ *  窓関数の名前から種類を得る
+ */
+int window_type_from_name(const char *name)
+{
+    int i;
+
+    for (i = 0; i < sizeof(window_names) / sizeof(window_names[0]); i++) {
+        if (strcmp(name, window_names[i].name) == 0)
+            return window_names[i].type;
+    }
+    return -1;
+}
+
+
+/*
+ *  窓関数のテーブルを作成する
+ */
+void window_make(double *window, size_t size, int window_type)
+{
+    size_t i;
+
+    for (i = 0; i < size; i++) {
+        double x = (size > 1) ? 2 * M_PI * i / (size - 1) : 0.0;
+
+        switch (window_type) {
+        case WINDOW_HANN:
+            window[i] = 0.5 - 0.5 * cos(x);
+            break;
+        case WINDOW_HAMMING:
+            window[i] = 0.54 - 0.46 * cos(x);
+            break;
+        case WINDOW_BLACKMAN:
+            window[i] = 0.42 - 0.5 * cos(x) + 0.08 * cos(2 * x);
+            break;
+        default:
+            window[i] = 1.0;
+            break;
+        }
+    }
+
+    //  両端の音量を直線的に絞る
+    if (window_type == WINDOW_TAPER) {
+        for (i = 0; i < NUM_REDUCE && i < size; i++) {
+            double rate = (double)i / NUM_REDUCE;
+            window[i] *= rate;
+            window[size - i - 1] *= rate;
+        }
+    }
+}
+
+
+/*
+ *  Framer オブジェクトを新規作成する
+ */
+Framer *framer_new(size_t frame_size, size_t pad_size, int window_type)
+{
+    Framer *fr;
+
+    if (frame_size == 0) {
+        fprintf(stderr, "framer_new() : frame size must be positive\n");
+        exit(EXIT_FAILURE);
+    }
+    if (pad_size < frame_size)
+        pad_size = frame_size;
+
+    fr = _frame_alloc(sizeof(Framer));
+    fr->frame_size  = frame_size;
+    fr->pad_size    = pad_size;
+    fr->window_type = window_type;
+    fr->window      = _frame_alloc(sizeof(double) * frame_size);
+    fr->tail_window = _frame_alloc(sizeof(double) * frame_size);
+    fr->tail_size   = 0;
+    fr->buf         = _frame_alloc(sizeof(double) * pad_size);
+    fr->num_sample  = 0;
+    fr->gain        = 0.0;
+    fr->buff        = NULL;
+    fr->num_samplef = 0;
+
+    window_make(fr->window, frame_size, window_type);
+
+    //  0 埋めの部分は、以降のフレームでも書き換えない
+    memset(fr->buf, 0, sizeof(double) * pad_size);
+
+    return fr;
+}
+
+
+/*
+ *  サンプルデータに窓関数を掛けてフレームに読み込む
+ */
+const double *framer_load(Framer *fr, const void *sample, size_t num_sample, const SampleFormat *fmt)
+{
+    const double *window = fr->window;
+    double *buf = fr->buf;
+    double gain = 0.0;
+    size_t i;
+
+    if (num_sample > fr->frame_size)
+        num_sample = fr->frame_size;
+
+    //  短いフレーム(ファイル末尾)は、その長さの窓関数を掛ける
+    //  末尾のフレームは同じ長さが続くことが多いので、直前のものを使い回す
+    if (num_sample < fr->frame_size) {
+        if (fr->tail_size != num_sample) {
+            window_make(fr->tail_window, num_sample, fr->window_type);
+            fr->tail_size = num_sample;
+        }
+        window = fr->tail_window;
+    }
+
+    sample_convert(sample, num_sample, fmt, window, buf);
+    for (i = 0; i < num_sample; i++)
+        gain += window[i];
+
+    //  前のフレームより短い場合は、その差の部分を 0 に戻す
+    if (num_sample < fr->num_sample)
+        memset(buf + num_sample, 0, sizeof(double) * (fr->num_sample - num_sample));
+
+    fr->num_sample = num_sample;
+    fr->gain = gain;
+
+    return buf;
+}
+
+
+/*
+ *  サンプルデータに窓関数を掛けて、float 型のフレームに読み込む
+ */
+const float *framer_load_float(Framer *fr, const void *sample, size_t num_sample, const SampleFormat *fmt)
+{
+    const double *buf;
+    size_t i;
+
+    if (!fr->buff) {
+        fr->buff = _frame_alloc(sizeof(float) * fr->pad_size);
+        memset(fr->buff, 0, sizeof(float) * fr->pad_size);
+        fr->num_samplef = 0;
+    }
+
+    buf = framer_load(fr, sample, num_sample, fmt);
+    num_sample = fr->num_sample;
+    for (i = 0; i < num_sample; i++)
+        fr->buff[i] = buf[i];
+
+    //  前のフレームより短い場合は、その差の部分を 0 に戻す
+    if (num_sample < fr->num_samplef)
+        memset(fr->buff + num_sample, 0, sizeof(float) * (fr->num_samplef - num_sample));
+    fr->num_samplef = num_sample;
+
+    return fr->buff;
+}
+
+
+/*
+ *  Framer オブジェクトを開放する
+ */
+void framer_free(Framer *fr)
+{
+    if (fr) {
+        free(fr->window);
+        free(fr->tail_window);
+        free(fr->buf);
+        free(fr->buff);
+        free(fr);
+    }
+}
+
+
+/*
+ * サンプル数が足りない場合に、十分な長さ(num_rep_sample)のサンプルを作成する。
+ *
+ * 基本的には、元の波形を繰り返しつなげていき、要求されるサンプル数まで
+ * 伸長する。
+ * ただし、つなぎ目のところで急激な音量の変化が発生すると正しい解析が
+ * 行えないため、つなぎ目部分の音量を抑えるようにする。
+ *
+ * sample         : 元のサンプルデータ
+ * num_sample     : 元のサンプルデータのサンプル数
+ * rep_sample     : 伸長したサンプルを格納する場所。領域はあらかじめ呼び出し元で確保すること。
+ * num_rep_sample : 要求されるサンプル数。
+ *
+ */
+void make_repeated_sample
+(const short *sample, const size_t num_sample, short *rep_sample, size_t num_rep_sample)
+{
+    //  num_rep_sample : コピーが必要な残りサンプル数。 
+    while (num_rep_sample > 0) {
+        //  この回で実際にコピーするサンプル数
+        size_t num_copied = (num_sample < num_rep_sample) ? num_sample : num_rep_sample;
+
+        memcpy(rep_sample, sample, num_copied * sizeof(short));
+        
+        //  元サンプルの両側の音量を絞る。
+        //  (サンプルの切れ目をなめらかにするため)
+        int i;
+        for (i = 0; i < NUM_REDUCE; i++ ) {
+            double rate = (double)i / NUM_REDUCE;
+            if (i < num_copied) 
+                rep_sample[i] *= rate;
+            if (num_sample - i - 1 < num_copied) 
+                rep_sample[num_sample - i - 1] *= rate;
+        }
+        
+        rep_sample  += num_copied;
+        num_rep_sample -= num_copied;
+    }
+}
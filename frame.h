@@ -0,0 +1,137 @@
+/*
+ *  frame.h
+ *
+ *  解析フレームの切り出しを行う
+ *
+ *  サンプルデータに窓関数を掛け、必要な周波数分解能が得られる長さまで
+ *  0 で埋めたフレームを作る。窓関数のテーブルとフレームの領域は
+ *  作成時に一度だけ確保し、以降のフレームでは使い回す。
+ *
+ */
+
+#ifndef __FRAME_H__
+#define __FRAME_H__
+
+#include <stddef.h>
+#include "sample.h"
+
+//  窓関数の種類
+#define WINDOW_RECT         0   //  矩形窓(窓なし)
+#define WINDOW_TAPER        1   //  両端 NUM_REDUCE サンプルだけを直線的に絞る
+#define WINDOW_HANN         2   //  ハン窓
+#define WINDOW_HAMMING      3   //  ハミング窓
+#define WINDOW_BLACKMAN     4   //  ブラックマン窓
+
+//  WINDOW_TAPER で音量を絞るサンプル数
+#define NUM_REDUCE  10
+
+
+//  Framer 構造体
+typedef struct _framer {
+    size_t      frame_size;     //  1フレームのサンプル数
+    size_t      pad_size;       //  0 で埋めたあとのフレームの長さ(frame_size 以上)
+    int         window_type;    //  窓関数の種類
+    double      *window;        //  窓関数のテーブル(frame_size 個)
+    double      *tail_window;   //  frame_size より短いフレーム用の窓関数のテーブル
+    size_t      tail_size;      //  tail_window の長さ(0 なら未作成)
+    double      *buf;           //  窓を掛けたフレーム(pad_size 個)
+    size_t      num_sample;     //  直前に読み込んだサンプル数
+    double      gain;           //  直前に読み込んだ範囲の窓関数の総和(振幅の正規化用)
+    float       *buff;          //  buf の float 版(pad_size 個)。framer_load_float() で確保する
+    size_t      num_samplef;    //  buff に直前に読み込んだサンプル数
+} Framer;
+
+
+/*
+ *  窓関数の名前から種類を得る
+ *
+ *  name : "rect", "taper", "hann", "hamming", "blackman" のいずれか
+ *
+ *  戻値：
+ *    窓関数の種類。該当するものがない場合は -1。
+ */
+int window_type_from_name(const char *name);
+
+
+/*
+ *  窓関数のテーブルを作成する
+ *
+ *  引数：
+ *    window      : テーブルの格納先(size 個)
+ *    size        : 窓の長さ
+ *    window_type : 窓関数の種類(WINDOW_*)
+ */
+void window_make(double *window, size_t size, int window_type);
+
+
+/*
+ *  Framer オブジェクトを新規作成する
+ *
+ *  引数：
+ *    frame_size  : 1フレームのサンプル数
+ *    pad_size    : 0 で埋めたあとのフレームの長さ。frame_size より小さい場合は frame_size とする。
+ *    window_type : 窓関数の種類(WINDOW_*)
+ */
+Framer *framer_new(size_t frame_size, size_t pad_size, int window_type);
+
+
+/*
+ *  サンプルデータに窓関数を掛けてフレームに読み込む
+ *
+ *  引数：
+ *    fr         : Framer オブジェクト
+ *    sample     : サンプルデータ(fmt の形式)
+ *    num_sample : サンプル数(サンプルフレームの数)。frame_size より少ない場合
+ *                 (ファイル末尾など)は、残りを 0 で埋める。
+ *    fmt        : サンプルデータの形式
+ *
+ *  型の変換とチャンネルの取り出しは、窓関数の乗算と同時に行う。
+ *  frame_size より短いフレームには、その長さで作り直した窓関数を掛ける
+ *  (frame_size の窓の先頭部分だけを掛けると、末尾が急に途切れるため)。
+ *
+ *  戻値：
+ *    窓を掛けて 0 で埋めたフレーム(fr->buf)。pad_size 個のデータを持つ。
+ */
+const double *framer_load(Framer *fr, const void *sample, size_t num_sample, const SampleFormat *fmt);
+
+
+/*
+ *  サンプルデータに窓関数を掛けて、float 型のフレームに読み込む
+ *
+ *  引数は framer_load() と同じ。
+ *
+ *  framer_load() で読み込んだ部分(num_sample 個)だけを float に変換する。
+ *  0 埋めの部分は、最初に確保したときに 0 とし、以降は前のフレームより
+ *  短い場合にその差の部分だけを 0 に戻す。
+ *
+ *  戻値：
+ *    窓を掛けて 0 で埋めたフレーム(fr->buff)。pad_size 個のデータを持つ。
+ */
+const float *framer_load_float(Framer *fr, const void *sample, size_t num_sample, const SampleFormat *fmt);
+
+
+/*
+ *  Framer オブジェクトを開放する
+ */
+void framer_free(Framer *fr);
+
+
+/*
+ *  サンプル数が足りない場合に、十分な長さ(num_rep_sample)のサンプルを作成する。
+ *
+ *  元の波形を繰り返しつなげていき、要求されるサンプル数まで伸長する。
+ *  つなぎ目の両側 NUM_REDUCE サンプルの音量は直線的に絞る。
+ *
+ *  以前の dft() で用いていた方法。現在の解析では framer_load() による
+ *  0 埋めを用いており、この関数は比較のためにのみ残している。
+ *
+ *  sample         : 元のサンプルデータ
+ *  num_sample     : 元のサンプルデータのサンプル数
+ *  rep_sample     : 伸長したサンプルを格納する場所。領域はあらかじめ呼び出し元で確保すること。
+ *  num_rep_sample : 要求されるサンプル数。
+ */
+void make_repeated_sample
+(const short *sample, const size_t num_sample, short *rep_sample, size_t num_rep_sample);
+
+
+#endif  //  __FRAME_H__
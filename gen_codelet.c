@@ -0,0 +1,251 @@
+/*
+ *  gen_codelet.c
+ *
+ *  固定サイズの FFT(コードレット)のソースを生成する
+ *
+ *  使い方：
+ *    gen_codelet > codelet_gen.c
+ *
+ *  生成するものは codelet.h を参照。
+ *  基数2の時間間引き FFT で、演算の内容は汎用の FFT プランと同じ。
+ *  ただし、回転因子が 1 や -i となるものは積を省く。
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define     PI      M_PI
+#define     PI2     (PI * 2)
+
+//  展開する部分変換の長さ(最初の LEAF_BITS 段をまとめて展開する)
+#define     LEAF_BITS   5
+#define     LEAF        (1 << LEAF_BITS)
+
+//  生成するサイズ(2 のべき乗で、小さい順に並べること)
+static const int sizes[] = { 1024, 2048, 4096, 8192 };
+#define     NUM_SIZE    (sizeof(sizes) / sizeof(sizes[0]))
+
+
+//  精度ごとの型と名前
+typedef struct _precision {
+    const char  *real;      //  実数の型
+    const char  *complex;   //  複素数の型
+    const char  *id;        //  関数名の接頭辞
+    const char  *radix2;    //  基数2のバタフライ演算の型
+    const char  *suffix;    //  定数の接尾辞
+    int         digits;     //  定数の有効桁数(値を丸めずに表せる桁数)
+} Precision;
+
+static const Precision precisions[] = {
+    { "double", "complex",       "_codelet",  "Radix2Func",  "",  17 },
+    { "float",  "float complex", "_codeletf", "Radix2fFunc", "f", 9 },
+};
+
+
+//  exp(-2πi num / den)
+//  fft.c の _fft_root() と同じ方法で計算する。
+static void _root(long long num, long long den, double *re, double *im)
+{
+    double theta = - PI2 * (double)(num % den) / den;
+    *re = cos(theta);
+    *im = sin(theta);
+}
+
+
+//  定数を出力する
+//  整数になる値にも小数点を付ける(接尾辞 f を付けられるように)。
+static void _print_const(const Precision *p, double value)
+{
+    char buf[64];
+
+    if (p->suffix[0])
+        value = (float)value;
+    snprintf(buf, sizeof(buf), "%.*g", p->digits, value);
+    if (!strpbrk(buf, ".e"))
+        strcat(buf, ".0");
+    printf("%s%s", buf, p->suffix);
+}
+
+
+//  size ビットのビット反転
+static int _bit_reverse(int i, int size)
+{
+    int r = 0;
+
+    for (size >>= 1; size > 0; size >>= 1) {
+        r = (r << 1) | (i & 1);
+        i >>= 1;
+    }
+    return r;
+}
+
+
+//  回転因子のテーブル
+//  部分変換の長さ m (LEAF <= m < 最大サイズ)の段の回転因子
+//  exp(-2πi j / 2m) (0 <= j < m) を、m の小さい順に連続して並べる。
+//  m の段の開始位置は m - LEAF となる。
+static void _gen_twiddle(const Precision *p, int max_size)
+{
+    int m, j;
+
+    printf("static const %s %s_twiddle[%d] = {\n", p->real, p->id, (max_size - LEAF) * 2);
+    for (m = LEAF; m < max_size; m *= 2) {
+        for (j = 0; j < m; j++) {
+            double re, im;
+            _root(j, 2 * m, &re, &im);
+            printf("    ");
+            _print_const(p, re);
+            printf(", ");
+            _print_const(p, im);
+            printf(",\n");
+        }
+    }
+    printf("};\n\n");
+}
+
+
+//  並べ替え(ビット反転)で入れ替える要素番号の組
+static void _gen_swap(int size)
+{
+    int i, num_swap = 0;
+
+    printf("static const unsigned short codelet_swap_%d[] = {\n", size);
+    for (i = 0; i < size; i++) {
+        int r = _bit_reverse(i, size);
+        if (i < r) {
+            printf("%s%d, %d,", (num_swap % 8 == 0) ? "    " : " ", i, r);
+            if (++num_swap % 8 == 0)
+                printf("\n");
+        }
+    }
+    if (num_swap % 8 != 0)
+        printf("\n");
+    printf("};\n");
+    printf("#define CODELET_NUM_SWAP_%d %d\n\n", size, num_swap);
+}
+
+
+//  並べ替えを行う関数
+static void _gen_swap_func(const Precision *p)
+{
+    printf("static void %s_swap(%s *data, const unsigned short *swap, int num_swap)\n", p->id, p->complex);
+    printf("{\n");
+    printf("    int i;\n\n");
+    printf("    for (i = 0; i < num_swap; i++) {\n");
+    printf("        %s tmp = data[swap[i * 2]];\n", p->complex);
+    printf("        data[swap[i * 2]] = data[swap[i * 2 + 1]];\n");
+    printf("        data[swap[i * 2 + 1]] = tmp;\n");
+    printf("    }\n");
+    printf("}\n\n");
+}
+
+
+//  LEAF 点ずつの変換(最初の LEAF_BITS 段)を展開した関数
+//  実部を r0, r1, ...、虚部を i0, i1, ... に読み込み、段ごとにバタフライ演算を並べる。
+static void _gen_leaf(const Precision *p)
+{
+    int m, k, j;
+
+    printf("static void %s_leaf(%s *data, int n)\n", p->id, p->complex);
+    printf("{\n");
+    printf("    %s *x = (%s *)data;\n", p->real, p->real);
+    printf("    %s *end = x + n * 2;\n\n", p->real);
+    printf("    for (; x < end; x += %d) {\n", LEAF * 2);
+    printf("        %s tr, ti;\n", p->real);
+    for (k = 0; k < LEAF; k++)
+        printf("        %s r%d = x[%d], i%d = x[%d];\n", p->real, k, k * 2, k, k * 2 + 1);
+
+    for (m = 1; m < LEAF; m *= 2) {
+        printf("\n        //  m = %d\n", m);
+        for (k = 0; k < LEAF; k += 2 * m) {
+            for (j = 0; j < m; j++) {
+                int a = k + j, b = k + j + m;
+                double c, s;
+
+                if (j == 0) {
+                    //  W = 1
+                    printf("        tr = r%d; ti = i%d;\n", b, b);
+                } else if (j * 2 == m) {
+                    //  W = -i
+                    printf("        tr = i%d; ti = -r%d;\n", b, b);
+                } else {
+                    _root(j, 2 * m, &c, &s);
+                    printf("        tr = r%d * ", b);
+                    _print_const(p, c);
+                    printf(" - i%d * ", b);
+                    _print_const(p, s);
+                    printf("; ti = r%d * ", b);
+                    _print_const(p, s);
+                    printf(" + i%d * ", b);
+                    _print_const(p, c);
+                    printf(";\n");
+                }
+                printf("        r%d = r%d - tr; i%d = i%d - ti; r%d += tr; i%d += ti;\n",
+                       b, a, b, a, a, a);
+            }
+        }
+    }
+
+    printf("\n");
+    for (k = 0; k < LEAF; k++)
+        printf("        x[%d] = r%d; x[%d] = i%d;\n", k * 2, k, k * 2 + 1, k);
+    printf("    }\n");
+    printf("}\n\n");
+}
+
+
+//  サイズ size の変換を行う関数
+//  残りの段は、部分変換の長さと回転因子の位置を定数として radix2 を呼ぶ。
+static void _gen_codelet(const Precision *p, int size)
+{
+    int m;
+
+    printf("static void %s_%d(%s *data, %s radix2)\n", p->id, size, p->complex, p->radix2);
+    printf("{\n");
+    printf("    const %s *W = (const %s *)%s_twiddle;\n\n", p->complex, p->complex, p->id);
+    printf("    %s_swap(data, codelet_swap_%d, CODELET_NUM_SWAP_%d);\n", p->id, size, size);
+    printf("    %s_leaf(data, %d);\n", p->id, size);
+    for (m = LEAF; m < size; m *= 2)
+        printf("    radix2(data, %d, %d, W + %d);\n", size, m, m - LEAF);
+    printf("}\n\n");
+}
+
+
+int main(void)
+{
+    const int max_size = sizes[NUM_SIZE - 1];
+    size_t i, j;
+
+    printf("/*\n");
+    printf(" *  codelet_gen.c\n");
+    printf(" *\n");
+    printf(" *  gen_codelet が生成したファイル。編集しないこと。\n");
+    printf(" *\n");
+    printf(" */\n\n");
+    printf("#include <complex.h>\n");
+    printf("#include \"codelet.h\"\n\n\n");
+
+    for (i = 0; i < sizeof(precisions) / sizeof(precisions[0]); i++)
+        _gen_twiddle(&precisions[i], max_size);
+    for (j = 0; j < NUM_SIZE; j++)
+        _gen_swap(sizes[j]);
+    printf("\n");
+
+    for (i = 0; i < sizeof(precisions) / sizeof(precisions[0]); i++) {
+        _gen_swap_func(&precisions[i]);
+        _gen_leaf(&precisions[i]);
+        for (j = 0; j < NUM_SIZE; j++)
+            _gen_codelet(&precisions[i], sizes[j]);
+    }
+
+    printf("\nconst FftCodelet fft_codelet_table[] = {\n");
+    for (j = 0; j < NUM_SIZE; j++)
+        printf("    { %d, _codelet_%d, _codeletf_%d },\n", sizes[j], sizes[j], sizes[j]);
+    printf("};\n\n");
+    printf("const int fft_num_codelet = %d;\n", (int)NUM_SIZE);
+
+    return 0;
+}
@@ -0,0 +1,124 @@
+/*
+ *  goertzel.c
+ *
+ *  Goertzel アルゴリズムによるフィルタバンク
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "goertzel.h"
+
+//  一番低い A の音
+#define HZ_A1       55.0
+
+//  1オクターブあたりの半音の数
+#define NUM_HALFTONE    12
+
+
+//  malloc のラッパ関数
+//  確保に失敗した場合はエラー終了する。
+static void *_goertzel_alloc(size_t size)
+{
+    void *ptr = malloc(size);
+    if (!ptr) {
+        perror("Failed to allocate memory for goertzel bank");
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+
+/*
+ *  フィルタバンクを新規作成する
+ */
+GoertzelBank *goertzel_bank_new(double sample_rate, double hz_low, double hz_high, double cents)
+{
+    GoertzelBank *bank;
+    int low, high, i;
+
+    if (hz_low <= 0 || hz_high < hz_low || hz_high >= sample_rate / 2) {
+        fprintf(stderr, "goertzel_bank_new() : invalid range %f - %f Hz\n", hz_low, hz_high);
+        exit(EXIT_FAILURE);
+    }
+
+    //  A1 から数えた半音の番号で、範囲内にある最小と最大のもの
+    double shift = cents / 100;
+    low  = ceil (NUM_HALFTONE * log2(hz_low  / HZ_A1) - shift - 1e-9);
+    high = floor(NUM_HALFTONE * log2(hz_high / HZ_A1) - shift + 1e-9);
+    if (high < low) {
+        fprintf(stderr, "goertzel_bank_new() : no note in %f - %f Hz\n", hz_low, hz_high);
+        exit(EXIT_FAILURE);
+    }
+
+    bank = _goertzel_alloc(sizeof(GoertzelBank));
+    bank->num_note = high - low + 1;
+    bank->freq = _goertzel_alloc(sizeof(double) * bank->num_note);
+    bank->coef = _goertzel_alloc(sizeof(double) * bank->num_note);
+    bank->s1   = _goertzel_alloc(sizeof(double) * bank->num_note);
+    bank->s2   = _goertzel_alloc(sizeof(double) * bank->num_note);
+
+    for (i = 0; i < bank->num_note; i++) {
+        double hz = HZ_A1 * pow(2.0, (low + i + shift) / NUM_HALFTONE);
+        double w  = 2 * M_PI * hz / sample_rate;
+        bank->freq[i] = hz;
+        bank->coef[i] = 2 * cos(w);
+    }
+
+    return bank;
+}
+
+
+/*
+ *  1フレーム分のサンプルを解析する
+ *
+ *  各フィルタについて
+ *    s[t] = x[t] + 2cos(ω) s[t-1] - s[t-2]
+ *  を計算し、最後の2つの値から |X(ω)| を求める。
+ *  サンプルを外側、フィルタを内側のループにすることで、
+ *  内側のループはフィルタ間で依存関係がなく、ベクトル化しやすい。
+ */
+void goertzel_bank_process(GoertzelBank *bank, const double *sample, size_t num_sample, double *result)
+{
+    const int num_note = bank->num_note;
+    const double *coef = bank->coef;
+    double *s1 = bank->s1;
+    double *s2 = bank->s2;
+    size_t t;
+    int i;
+
+    memset(s1, 0, sizeof(double) * num_note);
+    memset(s2, 0, sizeof(double) * num_note);
+
+    for (t = 0; t < num_sample; t++) {
+        double x = sample[t];
+        for (i = 0; i < num_note; i++) {
+            double s0 = x + coef[i] * s1[i] - s2[i];
+            s2[i] = s1[i];
+            s1[i] = s0;
+        }
+    }
+
+    //  |X|^2 = s1^2 + s2^2 - 2cos(ω) s1 s2
+    for (i = 0; i < num_note; i++) {
+        double power = s1[i] * s1[i] + s2[i] * s2[i] - coef[i] * s1[i] * s2[i];
+        result[i] = (power > 0) ? sqrt(power) : 0.0;
+    }
+}
+
+
+/*
+ *  フィルタバンクを開放する
+ */
+void goertzel_bank_free(GoertzelBank *bank)
+{
+    if (bank) {
+        free(bank->freq);
+        free(bank->coef);
+        free(bank->s1);
+        free(bank->s2);
+        free(bank);
+    }
+}
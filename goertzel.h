@@ -0,0 +1,65 @@
+/*
+ *  goertzel.h
+ *
+ *  Goertzel アルゴリズムによるフィルタバンク
+ *
+ *  平均律の各音程(A1 = 55Hz を基準とし、半音ごとに周波数比 2^(1/12))の
+ *  周波数成分だけを求める。音程単位の解析であれば、全周波数を求める
+ *  DFT に比べて、1フレームあたり音程の数(ピアノの音域で88個)の
+ *  2次の漸化式を計算するだけで済む。
+ *
+ */
+
+#ifndef __GOERTZEL_H__
+#define __GOERTZEL_H__
+
+#include <stddef.h>
+
+//  GoertzelBank 構造体
+typedef struct _goertzel_bank {
+    int         num_note;   //  フィルタ(音程)の数
+    double      *freq;      //  各フィルタの中心周波数(Hz)
+    double      *coef;      //  各フィルタの係数 2cos(ω)
+    double      *s1;        //  漸化式の状態(1つ前の値)。作業領域
+    double      *s2;        //  漸化式の状態(2つ前の値)。作業領域
+} GoertzelBank;
+
+
+/*
+ *  フィルタバンクを新規作成する
+ *
+ *  引数：
+ *    sample_rate : サンプリングレート
+ *    hz_low      : 解析する周波数の下限
+ *    hz_high     : 解析する周波数の上限
+ *    cents       : 平均律からのずれ(セント)。
+ *                  全フィルタの周波数を 2^(cents / 1200) 倍する。
+ *
+ *  hz_low ～ hz_high の範囲にある、すべての半音の周波数にフィルタを置く。
+ */
+GoertzelBank *goertzel_bank_new(double sample_rate, double hz_low, double hz_high, double cents);
+
+
+/*
+ *  1フレーム分のサンプルを解析する
+ *
+ *  引数：
+ *    bank       : フィルタバンク
+ *    sample     : 解析対象のサンプルデータ(窓関数を掛けたもの)
+ *    num_sample : サンプルの数
+ *    result     : 解析結果の格納先。bank->num_note 個の double 型の領域が必要。
+ *                 各フィルタの中心周波数における DFT の絶対値(正規化なし)が入る。
+ *
+ *  作業領域として bank 内部の状態を書き換えるため、
+ *  同じ bank を複数のスレッドから同時に使ってはならない。
+ */
+void goertzel_bank_process(GoertzelBank *bank, const double *sample, size_t num_sample, double *result);
+
+
+/*
+ *  フィルタバンクを開放する
+ */
+void goertzel_bank_free(GoertzelBank *bank);
+
+
+#endif  //  __GOERTZEL_H__
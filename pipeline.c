@@ -0,0 +1,263 @@
+/*
+ *  pipeline.c
+ *
+ *  フレームの読み込み → 解析 → 結果の出力 を繰り返す
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "pipeline.h"
+
+//  スレッド1つあたりに先読みしておくフレーム数
+#define SLOTS_PER_THREAD    4
+
+//  スロットの状態
+#define SLOT_EMPTY      0   //  未使用(出力済み)
+#define SLOT_READY      1   //  読み込み済み、解析待ち
+#define SLOT_DONE       2   //  解析済み、出力待ち
+
+
+//  1フレーム分の読み込み・解析結果を保持する
+typedef struct _pipeline_slot {
+    long        sample_point;   //  フレーム先頭のサンプル位置
+    size_t      num_sample;     //  読み込んだサンプル数
+    void        *sample;        //  サンプルデータの読み込み先
+    const void  *frame;         //  フレームのサンプルデータ(sample またはマップした領域)
+    long        index;          //  フレームの番号(読み込んだ順)
+    double      *result;        //  解析結果
+    int         state;          //  状態(SLOT_*)
+} PipelineSlot;
+
+
+//  スレッド間で共有するデータ
+//  num_read, num_taken, quit と各スロットの state は lock で保護する。
+typedef struct _pipeline {
+    const AnalysisParam *param;
+    Profile         *profile;
+    Analysis        *layout;    //  最初の解析用スレッドの Analysis オブジェクト。
+                                //  出力の際に、結果の形式の参照にも使う
+    int             num_worker; //  作成済みの解析用スレッドの数(レーンの名前用)
+    int             num_slot;
+    PipelineSlot    *slot;
+    long            num_read;   //  読み込んだフレーム数
+    long            num_taken;  //  解析用スレッドが取り出したフレーム数
+    int             quit;       //  これ以上フレームがない
+    pthread_mutex_t lock;
+    pthread_cond_t  ready;      //  解析待ちのフレームが増えた
+    pthread_cond_t  done;       //  解析の終わったフレームが増えた
+} Pipeline;
+
+
+//  malloc のラッパ関数
+//  確保に失敗した場合はエラー終了する。
+static void *_pipeline_alloc(size_t size)
+{
+    void *ptr = malloc(size);
+    if (!ptr) {
+        perror("Failed to allocate memory for pipeline");
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+
+//  呼び出し元のスレッドだけで処理する
+static void _run_single(const AnalysisParam *param, FrameReader reader, FrameWriter writer,
+                        void *ctx, Profile *profile)
+{
+    Analysis *an = analysis_new(param);
+    void *buf = _pipeline_alloc(sample_frame_bytes(&param->format) * param->frame_size);
+    const size_t frame_bytes = sample_frame_bytes(&param->format);
+    ProfileLane *lane = profile_lane_new(profile, "main");
+    ProfileMark mark;
+    const void *frame;
+    long sample_point;
+    size_t size, written;
+
+    an->lane = lane;
+    while (1) {
+        profile_begin(lane, &mark);
+        size = reader(ctx, buf, param->frame_size, &sample_point, &frame);
+        if (size == 0)
+            break;
+        profile_end(lane, &mark, PROFILE_READ, frame_bytes * size);
+
+        analysis_run(an, frame, size);
+
+        profile_begin(lane, &mark);
+        written = writer(ctx, an, sample_point, an->result);
+        profile_end(lane, &mark, PROFILE_OUTPUT, written);
+
+        if (lane)
+            lane->frame++;
+    }
+
+    free(buf);
+    analysis_free(an);
+}
+
+
+//  解析用スレッド
+//  解析待ちのフレームを読み込み順に取り出して解析する。
+//  最初のスレッドは、呼び出し元のスレッドが作成した pl->layout を使う。
+static void *_worker(void *arg)
+{
+    Pipeline *pl = arg;
+    Analysis *an;
+    char name[PROFILE_NAME_SIZE];
+    int index;
+
+    pthread_mutex_lock(&pl->lock);
+    index = pl->num_worker++;
+    pthread_mutex_unlock(&pl->lock);
+    an = (index == 0) ? pl->layout : analysis_new(pl->param);
+
+    pthread_mutex_lock(&pl->lock);
+    snprintf(name, sizeof(name), "worker %d", index + 1);
+    an->lane = profile_lane_new(pl->profile, name);
+    while (1) {
+        while (pl->num_taken == pl->num_read && !pl->quit)
+            pthread_cond_wait(&pl->ready, &pl->lock);
+        if (pl->num_taken == pl->num_read)
+            break;
+
+        PipelineSlot *slot = &pl->slot[pl->num_taken++ % pl->num_slot];
+        pthread_mutex_unlock(&pl->lock);
+
+        if (an->lane)
+            an->lane->frame = slot->index;
+        analysis_run(an, slot->frame, slot->num_sample);
+        memcpy(slot->result, an->result, sizeof(double) * an->num_bin);
+
+        pthread_mutex_lock(&pl->lock);
+        slot->state = SLOT_DONE;
+        pthread_cond_signal(&pl->done);
+    }
+    pthread_mutex_unlock(&pl->lock);
+
+    if (an != pl->layout)
+        analysis_free(an);
+    return NULL;
+}
+
+
+//  複数のスレッドで解析する
+//  呼び出し元のスレッドは、スロットが空いていれば読み込みを、
+//  空いていなければ最も古いフレームの解析を待って出力を行う。
+static void _run_parallel(const AnalysisParam *param, int num_thread,
+                          FrameReader reader, FrameWriter writer, void *ctx, Profile *profile)
+{
+    Pipeline pl;
+    pthread_t *threads = _pipeline_alloc(sizeof(pthread_t) * num_thread);
+    Analysis *layout = analysis_new(param);     //  最初の解析用スレッドが使う
+    const size_t frame_bytes = sample_frame_bytes(&param->format);
+    ProfileLane *lane = profile_lane_new(profile, "main");
+    ProfileMark mark;
+    long num_written = 0;
+    size_t written;
+    int eof = 0;
+    int i;
+
+    pl.param = param;
+    pl.profile = profile;
+    pl.layout = layout;
+    pl.num_worker = 0;
+    pl.num_slot = num_thread * SLOTS_PER_THREAD;
+    pl.slot = _pipeline_alloc(sizeof(PipelineSlot) * pl.num_slot);
+    for (i = 0; i < pl.num_slot; i++) {
+        pl.slot[i].sample = _pipeline_alloc(sample_frame_bytes(&param->format) * param->frame_size);
+        pl.slot[i].result = _pipeline_alloc(sizeof(double) * (layout->num_bin > 0 ? layout->num_bin : 1));
+        pl.slot[i].state  = SLOT_EMPTY;
+    }
+    pl.num_read = 0;
+    pl.num_taken = 0;
+    pl.quit = 0;
+    pthread_mutex_init(&pl.lock, NULL);
+    pthread_cond_init(&pl.ready, NULL);
+    pthread_cond_init(&pl.done, NULL);
+
+    for (i = 0; i < num_thread; i++) {
+        if (pthread_create(&threads[i], NULL, _worker, &pl) != 0) {
+            perror("Failed to create thread");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    while (1) {
+        //  空いているスロットに読み込む。
+        //  出力済みのスロットは解析用スレッドから参照されないので、ロックは不要
+        while (!eof && pl.num_read - num_written < pl.num_slot) {
+            PipelineSlot *slot = &pl.slot[pl.num_read % pl.num_slot];
+            if (lane)
+                lane->frame = pl.num_read;
+            profile_begin(lane, &mark);
+            slot->num_sample = reader(ctx, slot->sample, param->frame_size,
+                                      &slot->sample_point, &slot->frame);
+            if (slot->num_sample == 0) {
+                eof = 1;
+                break;
+            }
+            profile_end(lane, &mark, PROFILE_READ, frame_bytes * slot->num_sample);
+            slot->index = pl.num_read;
+
+            pthread_mutex_lock(&pl.lock);
+            slot->state = SLOT_READY;
+            pl.num_read++;
+            pthread_cond_signal(&pl.ready);
+            pthread_mutex_unlock(&pl.lock);
+        }
+
+        if (num_written == pl.num_read)
+            break;
+
+        //  最も古いフレームの解析を待って出力する
+        PipelineSlot *slot = &pl.slot[num_written % pl.num_slot];
+        pthread_mutex_lock(&pl.lock);
+        while (slot->state != SLOT_DONE)
+            pthread_cond_wait(&pl.done, &pl.lock);
+        pthread_mutex_unlock(&pl.lock);
+
+        if (lane)
+            lane->frame = num_written;
+        profile_begin(lane, &mark);
+        written = writer(ctx, layout, slot->sample_point, slot->result);
+        profile_end(lane, &mark, PROFILE_OUTPUT, written);
+        slot->state = SLOT_EMPTY;
+        num_written++;
+    }
+
+    pthread_mutex_lock(&pl.lock);
+    pl.quit = 1;
+    pthread_cond_broadcast(&pl.ready);
+    pthread_mutex_unlock(&pl.lock);
+
+    for (i = 0; i < num_thread; i++)
+        pthread_join(threads[i], NULL);
+
+    pthread_mutex_destroy(&pl.lock);
+    pthread_cond_destroy(&pl.ready);
+    pthread_cond_destroy(&pl.done);
+    for (i = 0; i < pl.num_slot; i++) {
+        free(pl.slot[i].sample);
+        free(pl.slot[i].result);
+    }
+    free(pl.slot);
+    free(threads);
+    analysis_free(layout);
+}
+
+
+/*
+ *  フレームがなくなるまで、読み込み・解析・出力を繰り返す
+ */
+void pipeline_run(const AnalysisParam *param, int num_thread,
+                  FrameReader reader, FrameWriter writer, void *ctx, Profile *profile)
+{
+    if (num_thread <= 1)
+        _run_single(param, reader, writer, ctx, profile);
+    else
+        _run_parallel(param, num_thread, reader, writer, ctx, profile);
+}
@@ -0,0 +1,73 @@
+/*
+ *  pipeline.h
+ *
+ *  フレームの読み込み → 解析 → 結果の出力 を繰り返す
+ *
+ *  各フレームの解析は互いに独立なので、複数のスレッドで並行して行える。
+ *  解析の終わる順序はスレッドによって前後するが、結果の出力は
+ *  必ず読み込んだ順に行うため、出力内容はスレッド数によらず同一になる。
+ *
+ */
+
+#ifndef __PIPELINE_H__
+#define __PIPELINE_H__
+
+#include <stddef.h>
+#include "analysis.h"
+#include "profile.h"
+
+
+/*
+ *  次のフレームを読み込む関数
+ *
+ *  ctx          : pipeline_run() に渡したポインタ
+ *  buf          : 読み込み先。size 個のサンプルフレーム(param->format の形式)の領域がある。
+ *  size         : 1フレームのサンプル数(サンプルフレームの数)
+ *  sample_point : フレーム先頭のサンプル位置を格納する
+ *  frame        : フレームのサンプルデータの先頭を格納する。
+ *                 buf に読み込んだ場合は buf を、メモリにマップしたファイルなど
+ *                 コピーせずに参照できる場合はその位置を指す。
+ *                 後者の場合、参照先は pipeline_run() が終わるまで有効でなければならない。
+ *
+ *  戻値：
+ *    読み込んだサンプル数。0 なら終了。
+ */
+typedef size_t (*FrameReader)(void *ctx, void *buf, size_t size, long *sample_point, const void **frame);
+
+
+/*
+ *  1フレーム分の解析結果を出力する関数
+ *
+ *  ctx          : pipeline_run() に渡したポインタ
+ *  an           : 結果の形式(ビンの数や周波数)を表す Analysis オブジェクト
+ *  sample_point : フレーム先頭のサンプル位置
+ *  result       : 解析結果(an->num_bin 個)
+ *
+ *  戻値：
+ *    出力したバイト数
+ */
+typedef size_t (*FrameWriter)(void *ctx, const Analysis *an, long sample_point, const double *result);
+
+
+/*
+ *  フレームがなくなるまで、読み込み・解析・出力を繰り返す
+ *
+ *  引数：
+ *    param      : 解析のパラメータ
+ *    num_thread : 解析を行うスレッドの数。
+ *                 1 の場合は、呼び出し元のスレッドだけで処理する。
+ *                 2 以上の場合は、解析用のスレッドをその数だけ作成し、
+ *                 呼び出し元のスレッドは読み込みと出力を受け持つ。
+ *                 解析用の領域(Analysis オブジェクト)はスレッドごとに持つ。
+ *    reader     : フレームを読み込む関数。呼び出し元のスレッドからのみ呼ばれる。
+ *    writer     : 結果を出力する関数。呼び出し元のスレッドから、読み込んだ順に呼ばれる。
+ *    ctx        : reader, writer に渡すポインタ
+ *    profile    : 各段階の時間を記録する Profile オブジェクト。NULL なら計測しない。
+ *                 呼び出し元のスレッドは "main"、解析用のスレッドは "worker N" の
+ *                 レーンに記録する。
+ */
+void pipeline_run(const AnalysisParam *param, int num_thread,
+                  FrameReader reader, FrameWriter writer, void *ctx, Profile *profile);
+
+
+#endif  //  __PIPELINE_H__
@@ -0,0 +1,227 @@
+/*
+ *  profile.c
+ *
+ *  処理の段階ごとの所要時間を計測する
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "profile.h"
+
+//  段階の名前
+static const char *stage_name[PROFILE_NUM_STAGE] = { "read", "convert", "transform", "output" };
+
+
+//  realloc のラッパ関数
+//  確保に失敗した場合はエラー終了する。
+static void *_profile_realloc(void *ptr, size_t size)
+{
+    ptr = realloc(ptr, size);
+    if (!ptr) {
+        perror("Failed to allocate memory for profile");
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+
+//  時計 clock の現在の値(ns)
+static double _now_ns(clockid_t clock)
+{
+    struct timespec ts;
+
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+/*
+ *  Profile オブジェクトを新規作成し、計測を開始する
+ */
+Profile *profile_new(const char *trace_path)
+{
+    Profile *pf = _profile_realloc(NULL, sizeof(Profile));
+
+    memset(pf, 0, sizeof(Profile));
+    if (trace_path) {
+        if ((pf->trace = fopen(trace_path, "w")) == NULL) {
+            perror(trace_path);
+            exit(EXIT_FAILURE);
+        }
+    }
+    pthread_mutex_init(&pf->lock, NULL);
+
+    pf->start_wall = _now_ns(CLOCK_MONOTONIC);
+    pf->start_cpu  = _now_ns(CLOCK_PROCESS_CPUTIME_ID);
+
+    return pf;
+}
+
+
+/*
+ *  レーンを追加する
+ */
+ProfileLane *profile_lane_new(Profile *pf, const char *name)
+{
+    ProfileLane *lane;
+
+    if (!pf)
+        return NULL;
+
+    lane = _profile_realloc(NULL, sizeof(ProfileLane));
+    memset(lane, 0, sizeof(ProfileLane));
+    lane->profile = pf;
+    snprintf(lane->name, PROFILE_NAME_SIZE, "%s", name);
+
+    pthread_mutex_lock(&pf->lock);
+    lane->id = pf->num_lane;
+    pf->lane = _profile_realloc(pf->lane, sizeof(ProfileLane *) * (pf->num_lane + 1));
+    pf->lane[pf->num_lane++] = lane;
+    pthread_mutex_unlock(&pf->lock);
+
+    return lane;
+}
+
+
+/*
+ *  段階の開始時の時刻を記録する
+ */
+void profile_begin(ProfileLane *lane, ProfileMark *mark)
+{
+    if (lane) {
+        mark->wall = _now_ns(CLOCK_MONOTONIC);
+        mark->cpu  = _now_ns(CLOCK_THREAD_CPUTIME_ID);
+    }
+}
+
+
+/*
+ *  段階を終え、profile_begin() からの時間を記録する
+ */
+void profile_end(ProfileLane *lane, const ProfileMark *mark, int stage, size_t bytes)
+{
+    double wall, cpu;
+
+    if (!lane)
+        return;
+
+    wall = _now_ns(CLOCK_MONOTONIC);
+    cpu  = _now_ns(CLOCK_THREAD_CPUTIME_ID);
+
+    lane->count[stage]++;
+    lane->wall[stage]  += wall - mark->wall;
+    lane->cpu[stage]   += cpu - mark->cpu;
+    lane->bytes[stage] += bytes;
+
+    if (lane->profile->trace) {
+        if (lane->num_event == lane->event_capacity) {
+            lane->event_capacity = lane->event_capacity ? lane->event_capacity * 2 : 4096;
+            lane->event = _profile_realloc(lane->event, sizeof(ProfileEvent) * lane->event_capacity);
+        }
+
+        ProfileEvent *ev = &lane->event[lane->num_event++];
+        ev->start    = mark->wall - lane->profile->start_wall;
+        ev->duration = wall - mark->wall;
+        ev->frame    = lane->frame;
+        ev->stage    = stage;
+    }
+}
+
+
+/*
+ *  計測結果の集計を出力する
+ */
+void profile_report(const Profile *pf, FILE *fp, long num_frame, double bytes_in, double bytes_out)
+{
+    double elapsed = _now_ns(CLOCK_MONOTONIC) - pf->start_wall;
+    double cpu     = _now_ns(CLOCK_PROCESS_CPUTIME_ID) - pf->start_cpu;
+    int s, i;
+
+    fprintf(fp, "# %ld frames, %d threads, %.3f s elapsed, %.3f s cpu\n",
+            num_frame, pf->num_lane, elapsed / 1e9, cpu / 1e9);
+    fprintf(fp, "# total     %12.1f frames/s %12.3f MB/s in %12.3f MB/s out\n",
+            num_frame / (elapsed / 1e9), bytes_in / 1e6 / (elapsed / 1e9),
+            bytes_out / 1e6 / (elapsed / 1e9));
+
+    //  段階ごとに、全レーンの合計を出力する
+    fprintf(fp, "# %-9s %10s %12s %12s %12s %12s %12s\n",
+            "stage", "count", "wall_ms", "cpu_ms", "us_per_frame", "frames_per_s", "MB_per_s");
+    for (s = 0; s < PROFILE_NUM_STAGE; s++) {
+        long count = 0;
+        double wall = 0.0, cpu = 0.0, bytes = 0.0;
+
+        for (i = 0; i < pf->num_lane; i++) {
+            count += pf->lane[i]->count[s];
+            wall  += pf->lane[i]->wall[s];
+            cpu   += pf->lane[i]->cpu[s];
+            bytes += pf->lane[i]->bytes[s];
+        }
+        if (count == 0)
+            continue;
+
+        fprintf(fp, "  %-9s %10ld %12.3f %12.3f %12.3f %12.1f ",
+                stage_name[s], count, wall / 1e6, cpu / 1e6, wall / 1e3 / count,
+                (wall > 0) ? count / (wall / 1e9) : 0.0);
+        if (bytes > 0 && wall > 0)
+            fprintf(fp, "%12.3f\n", bytes / 1e6 / (wall / 1e9));
+        else
+            fprintf(fp, "%12s\n", "-");
+    }
+}
+
+
+//  トレースを Chrome のトレースイベント形式で書き出す
+//  時刻の単位はマイクロ秒。レーンごとに1つのスレッドとして表示される。
+static void _write_trace(const Profile *pf)
+{
+    FILE *fp = pf->trace;
+    const char *sep = "";
+    size_t e;
+    int i;
+
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (i = 0; i < pf->num_lane; i++) {
+        const ProfileLane *lane = pf->lane[i];
+
+        fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                "\"args\":{\"name\":\"%s\"}}", sep, lane->id, lane->name);
+        sep = ",\n";
+
+        for (e = 0; e < lane->num_event; e++) {
+            const ProfileEvent *ev = &lane->event[e];
+            fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"dft\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                    "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%ld}}",
+                    stage_name[ev->stage], lane->id, ev->start / 1e3, ev->duration / 1e3, ev->frame);
+        }
+    }
+    fprintf(fp, "\n]}\n");
+}
+
+
+/*
+ *  トレースを書き出し、Profile オブジェクトを開放する
+ */
+void profile_free(Profile *pf)
+{
+    int i;
+
+    if (!pf)
+        return;
+
+    if (pf->trace) {
+        _write_trace(pf);
+        if (fclose(pf->trace) != 0)
+            perror("Failed to write trace");
+    }
+
+    for (i = 0; i < pf->num_lane; i++) {
+        free(pf->lane[i]->event);
+        free(pf->lane[i]);
+    }
+    free(pf->lane);
+    pthread_mutex_destroy(&pf->lock);
+    free(pf);
+}
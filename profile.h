@@ -0,0 +1,151 @@
+/*
+ *  profile.h
+ *
+ *  処理の段階ごとの所要時間を計測する(dft --stats, --trace)
+ *
+ *  1フレームの処理を、次の段階に分けて計測する。
+ *
+ *    read      : フレームの読み込み(read_data() またはマップした領域の参照)
+ *    convert   : サンプルの変換と窓関数の乗算(framer_load(), sample_convert())
+ *    transform : 変換エンジンによる解析(dft(), FFT, Goertzel, スライディング DFT)
+ *    output    : 結果の出力
+ *
+ *  ファイルをメモリにマップしている場合、read はほとんど時間が掛からず、
+ *  ページの読み込みは最初にサンプルを参照する convert で起きる。
+ *
+ *  計測の結果は、スレッドごとの ProfileLane に記録する。レーンは
+ *  それを作成したスレッドだけが書き換えるので、記録の際にロックは不要。
+ *  トレースを出力する場合は、各段階の開始時刻と長さを1件ずつ保持しておき、
+ *  profile_free() で Chrome のトレースイベント形式(JSON)として書き出す。
+ *  chrome://tracing や Perfetto で読み込むと、スレッドごとに1行で表示される。
+ *
+ *  レーンに NULL を渡した場合は、何も計測しない。
+ *
+ */
+
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+#include <stdio.h>
+#include <stddef.h>
+#include <pthread.h>
+
+//  処理の段階
+#define PROFILE_READ        0
+#define PROFILE_CONVERT     1
+#define PROFILE_TRANSFORM   2
+#define PROFILE_OUTPUT      3
+#define PROFILE_NUM_STAGE   4
+
+//  レーンの名前の最大長
+#define PROFILE_NAME_SIZE   32
+
+
+//  トレースの1件(1つの段階の1回分)
+typedef struct _profile_event {
+    double      start;          //  開始時刻(ns, 計測開始から)
+    double      duration;       //  長さ(ns)
+    long        frame;          //  フレームの番号
+    int         stage;          //  段階(PROFILE_*)
+} ProfileEvent;
+
+
+//  1つのスレッドの計測結果
+typedef struct _profile_lane {
+    struct _profile *profile;
+    int         id;             //  レーンの番号(トレースのスレッド ID)
+    char        name[PROFILE_NAME_SIZE];
+    long        frame;          //  処理中のフレームの番号。呼び出し元が設定する
+    long        count[PROFILE_NUM_STAGE];   //  回数
+    double      wall[PROFILE_NUM_STAGE];    //  経過時間の合計(ns)
+    double      cpu[PROFILE_NUM_STAGE];     //  CPU 時間の合計(ns)
+    double      bytes[PROFILE_NUM_STAGE];   //  処理したバイト数の合計
+    ProfileEvent *event;        //  トレース(profile->trace が NULL なら使わない)
+    size_t      num_event;
+    size_t      event_capacity;
+} ProfileLane;
+
+
+//  Profile 構造体
+typedef struct _profile {
+    double      start_wall;     //  計測開始時の時刻(ns)
+    double      start_cpu;      //  計測開始時のプロセスの CPU 時間(ns)
+    FILE        *trace;         //  トレースの出力先。NULL なら出力しない
+    int         num_lane;
+    ProfileLane **lane;
+    pthread_mutex_t lock;       //  lane, num_lane を保護する
+} Profile;
+
+
+//  段階の開始時の時刻
+typedef struct _profile_mark {
+    double      wall;
+    double      cpu;
+} ProfileMark;
+
+
+/*
+ *  Profile オブジェクトを新規作成し、計測を開始する
+ *
+ *  引数：
+ *    trace_path : トレースの出力先のファイル名。NULL なら出力しない。
+ */
+Profile *profile_new(const char *trace_path);
+
+
+/*
+ *  レーンを追加する
+ *
+ *  引数：
+ *    pf   : Profile オブジェクト。NULL の場合は何もせず NULL を返す。
+ *    name : レーンの名前(トレースのスレッド名)
+ *
+ *  戻値：
+ *    追加したレーン。pf が開放されるまで有効。
+ */
+ProfileLane *profile_lane_new(Profile *pf, const char *name);
+
+
+/*
+ *  段階の開始時の時刻を記録する
+ */
+void profile_begin(ProfileLane *lane, ProfileMark *mark);
+
+
+/*
+ *  段階を終え、profile_begin() からの時間を記録する
+ *
+ *  引数：
+ *    lane  : レーン(NULL なら何もしない)
+ *    mark  : profile_begin() で記録したもの
+ *    stage : 段階(PROFILE_*)
+ *    bytes : 処理したバイト数(不明なら 0)
+ *
+ *  フレームの番号は lane->frame のものとする。
+ */
+void profile_end(ProfileLane *lane, const ProfileMark *mark, int stage, size_t bytes);
+
+
+/*
+ *  計測結果の集計を出力する
+ *
+ *  引数：
+ *    pf        : Profile オブジェクト
+ *    fp        : 出力先
+ *    num_frame : 出力したフレームの数
+ *    bytes_in  : 解析したサンプルデータのバイト数
+ *    bytes_out : 出力した結果のバイト数
+ *
+ *  段階ごとの時間は全スレッドの合計なので、複数のスレッドで解析した場合は
+ *  全体の経過時間を超えることがある。
+ */
+void profile_report(const Profile *pf, FILE *fp, long num_frame, double bytes_in, double bytes_out);
+
+
+/*
+ *  トレースを書き出し、Profile オブジェクトを開放する
+ */
+void profile_free(Profile *pf);
+
+
+#endif  //  __PROFILE_H__
@@ -1,12 +1,15 @@
 #include "wavfile.h"
 #include <stdio.h>
+#include <stdlib.h>
 
 #define NUM_SAMPLE 1024
 
 int main(int argc, char *argv[])
 {
-    short buf[NUM_SAMPLE];
-    int i;
+    SampleFormat fmt;
+    unsigned char *buf;
+    double data[NUM_SAMPLE];
+    size_t i;
 
     if (!argv[1]) {
         printf("Usage: readwav.c [filename]\n");
@@ -16,18 +19,27 @@ int main(int argc, char *argv[])
     WavData *wav = open_wavfile(argv[1]);
     printf("Open %s\n", argv[1]);
 
+    //  read_data() はサンプルフレーム(wBlockAlign バイト)単位で読むので、
+    //  ファイルの形式に合わせた大きさの領域を確保する
+    buf = malloc((size_t)NUM_SAMPLE * wav->wBlockAlign);
+    if (!buf) {
+        perror("Failed to allocate memory for buffer");
+        exit(EXIT_FAILURE);
+    }
+
     size_t size = read_data(wav, buf, NUM_SAMPLE);
-    printf("Read: %d bytes\n", size);
+    printf("Read: %zu frames\n", size);
 
-    for (i=0; i < 1024; i++) {
-        printf("Data: %d\n", buf[i]);
-    }     
+    //  全チャンネルの平均を、16bit 整数と同じ尺度に変換して表示する
+    wav_sample_format(wav, SAMPLE_MIX, &fmt);
+    sample_convert(buf, size, &fmt, NULL, data);
+    for (i=0; i < size; i++) {
+        printf("Data: %g\n", data[i]);
+    }
 
+    free(buf);
     close_wavfile(wav);
     printf("Closed\n");
 
     return 0;
 }
-
-
-
@@ -0,0 +1,63 @@
+/*
+ *  sample.c
+ *
+ *  サンプルデータの形式と変換
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "sample.h"
+#include "simd.h"
+
+
+/*
+ *  モノラル・16bit 整数の形式に初期化する
+ */
+void sample_format_init(SampleFormat *fmt)
+{
+    fmt->type     = SAMPLE_INT;
+    fmt->bits     = 16;
+    fmt->channels = 1;
+    fmt->channel  = SAMPLE_MIX;
+}
+
+
+/*
+ *  形式が対応しているものかどうかを調べる
+ */
+int sample_format_valid(const SampleFormat *fmt)
+{
+    if (fmt->channels < 1)
+        return 0;
+    if (fmt->channel != SAMPLE_MIX && (fmt->channel < 0 || fmt->channel >= fmt->channels))
+        return 0;
+
+    if (fmt->type == SAMPLE_INT)
+        return fmt->bits == 8 || fmt->bits == 16 || fmt->bits == 24 || fmt->bits == 32;
+    if (fmt->type == SAMPLE_FLOAT)
+        return fmt->bits == 32 || fmt->bits == 64;
+
+    return 0;
+}
+
+
+/*
+ *  1サンプルフレーム(全チャンネル分)のバイト数を返す
+ */
+size_t sample_frame_bytes(const SampleFormat *fmt)
+{
+    return (size_t)fmt->channels * (fmt->bits / 8);
+}
+
+
+/*
+ *  サンプルデータを double 型に変換する
+ *
+ *  実際の変換は、CPU に合わせて選んだ SIMD カーネルで行う。
+ */
+void sample_convert(const void *src, size_t num_frame, const SampleFormat *fmt,
+                    const double *window, double *dst)
+{
+    simd_get_kernel()->convert(src, num_frame, fmt, window, dst);
+}
@@ -0,0 +1,76 @@
+/*
+ *  sample.h
+ *
+ *  サンプルデータの形式と変換
+ *
+ *  wavファイルのサンプルは、整数(8/16/24/32bit)または浮動小数点数
+ *  (32/64bit)で、複数のチャンネルがインターリーブされている。
+ *  解析には、1つのチャンネル(または全チャンネルの平均)を取り出して
+ *  double 型に変換したものを用いる。
+ *
+ *  チャンネルの取り出し・型の変換・窓関数の乗算は、SIMD カーネルにより
+ *  データを1回走査するだけで行う。
+ *
+ */
+
+#ifndef __SAMPLE_H__
+#define __SAMPLE_H__
+
+#include <stddef.h>
+
+//  サンプルの型
+#define SAMPLE_INT      0   //  符号付き整数(8bit のみ符号なし)
+#define SAMPLE_FLOAT    1   //  IEEE 浮動小数点数
+
+//  全チャンネルの平均を取る場合のチャンネル番号
+#define SAMPLE_MIX      -1
+
+
+//  サンプルの形式
+typedef struct _sample_format {
+    int     type;       //  サンプルの型(SAMPLE_INT, SAMPLE_FLOAT)
+    int     bits;       //  1サンプルのビット数。整数なら 8, 16, 24, 32、浮動小数点数なら 32, 64
+    int     channels;   //  チャンネル数
+    int     channel;    //  取り出すチャンネル(0 ～ channels - 1)。SAMPLE_MIX なら全チャンネルの平均
+} SampleFormat;
+
+
+/*
+ *  モノラル・16bit 整数の形式に初期化する
+ */
+void sample_format_init(SampleFormat *fmt);
+
+
+/*
+ *  形式が対応しているものかどうかを調べる
+ *
+ *  戻値：
+ *    対応していれば 1、そうでなければ 0
+ */
+int sample_format_valid(const SampleFormat *fmt);
+
+
+/*
+ *  1サンプルフレーム(全チャンネル分)のバイト数を返す
+ */
+size_t sample_frame_bytes(const SampleFormat *fmt);
+
+
+/*
+ *  サンプルデータを double 型に変換する
+ *
+ *  引数：
+ *    src       : 変換元のデータ(fmt の形式で、チャンネルがインターリーブされたもの)
+ *    num_frame : 変換するサンプルフレームの数
+ *    fmt       : 変換元の形式
+ *    window    : 各サンプルに掛ける窓関数(num_frame 個)。NULL なら掛けない。
+ *    dst       : 変換先(num_frame 個)
+ *
+ *  値は 16bit 整数と同じ尺度に揃える(最大振幅が 32768)。
+ *  ビット数の異なるファイルでも、同じ音量であれば同じ解析結果となる。
+ */
+void sample_convert(const void *src, size_t num_frame, const SampleFormat *fmt,
+                    const double *window, double *dst);
+
+
+#endif  //  __SAMPLE_H__
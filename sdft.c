@@ -0,0 +1,158 @@
+/*
+ *  sdft.c
+ *
+ *  スライディング DFT
+ *
+ *  窓の先頭を位相の基準とした DFT
+ *    X_k(n) = Σ x(n - N + 1 + m) exp(-iω_k m)    (0 <= m < N)
+ *  は、新しいサンプル x(n) と窓から外れるサンプル x(n - N) を用いて
+ *    X_k(n) = exp(iω_k) (X_k(n - 1) - x(n - N)) + x(n) exp(-iω_k (N - 1))
+ *  と更新できる。ω_k はビンの間隔の整数倍である必要はない。
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sdft.h"
+#include "simd.h"
+
+
+//  malloc のラッパ関数
+//  確保に失敗した場合はエラー終了する。
+static void *_sdft_alloc(size_t size)
+{
+    void *ptr = malloc(size);
+    if (!ptr) {
+        perror("Failed to allocate memory for sliding dft");
+        exit(EXIT_FAILURE);
+    }
+    return ptr;
+}
+
+
+/*
+ *  スライディング DFT を新規作成する
+ */
+SlidingDft *sliding_dft_new(size_t size, int num_bin,
+                            const double *cos_table, const double *sin_table, size_t table_size,
+                            size_t anchor_interval)
+{
+    SlidingDft *sd;
+    int k;
+
+    if (size == 0 || num_bin < 0 || num_bin >= table_size) {
+        fprintf(stderr, "sliding_dft_new() : invalid size %lu / %d bins\n", (unsigned long)size, num_bin);
+        exit(EXIT_FAILURE);
+    }
+
+    sd = _sdft_alloc(sizeof(SlidingDft));
+    sd->size            = size;
+    sd->num_bin         = num_bin;
+    sd->anchor_interval = anchor_interval;
+    sd->cos_table       = cos_table;
+    sd->sin_table       = sin_table;
+    sd->table_size      = table_size;
+
+    sd->rot    = _sdft_alloc(sizeof(complex) * (num_bin > 0 ? num_bin : 1));
+    sd->coef   = _sdft_alloc(sizeof(complex) * (num_bin > 0 ? num_bin : 1));
+    sd->X      = _sdft_alloc(sizeof(complex) * (num_bin > 0 ? num_bin : 1));
+    sd->ring   = _sdft_alloc(sizeof(double) * size);
+    sd->linear = _sdft_alloc(sizeof(double) * size);
+
+    for (k = 0; k < num_bin; k++) {
+        size_t j = (size_t)(k + 1) % table_size;
+        size_t c = (size_t)(k + 1) * ((size - 1) % table_size) % table_size;
+
+        sd->rot[k]  = cos_table[j] + sin_table[j] * I;
+        sd->coef[k] = cos_table[c] - sin_table[c] * I;
+    }
+
+    sliding_dft_reset(sd);
+
+    return sd;
+}
+
+
+/*
+ *  状態を初期化する(直近のサンプルをすべて 0 とする)
+ */
+void sliding_dft_reset(SlidingDft *sd)
+{
+    memset(sd->ring, 0, sizeof(double) * sd->size);
+    memset(sd->X, 0, sizeof(complex) * (sd->num_bin > 0 ? sd->num_bin : 1));
+    sd->pos = 0;
+    sd->since_anchor = 0;
+}
+
+
+/*
+ *  サンプルを追加する
+ *
+ *  サンプルを外側、ビンを内側のループにすることで、
+ *  内側のループはビン間で依存関係がなく、ベクトル化しやすい。
+ */
+void sliding_dft_push(SlidingDft *sd, const double *sample, size_t num_sample)
+{
+    const int num_bin = sd->num_bin;
+    const complex *rot = sd->rot;
+    const complex *coef = sd->coef;
+    complex *X = sd->X;
+    size_t t;
+    int k;
+
+    for (t = 0; t < num_sample; t++) {
+        double x_new = sample ? sample[t] : 0.0;
+        double x_old = sd->ring[sd->pos];
+
+        for (k = 0; k < num_bin; k++)
+            X[k] = rot[k] * (X[k] - x_old) + x_new * coef[k];
+
+        sd->ring[sd->pos] = x_new;
+        if (++sd->pos == sd->size)
+            sd->pos = 0;
+
+        if (sd->anchor_interval > 0 && ++sd->since_anchor >= sd->anchor_interval)
+            sliding_dft_anchor(sd);
+    }
+}
+
+
+/*
+ *  直近 size 個のサンプルから、DFT の各ビンを直接計算し直す
+ */
+void sliding_dft_anchor(SlidingDft *sd)
+{
+    const DftBinFunc dft_bin = simd_get_kernel()->dft_bin;
+    const size_t first = sd->size - sd->pos;
+    int k;
+
+    //  最も古いサンプルから順に並べ直す
+    memcpy(sd->linear, sd->ring + sd->pos, sizeof(double) * first);
+    memcpy(sd->linear + first, sd->ring, sizeof(double) * sd->pos);
+
+    for (k = 0; k < sd->num_bin; k++) {
+        double real, imag;
+
+        dft_bin(sd->linear, sd->size, k + 1, sd->cos_table, sd->sin_table, sd->table_size, &real, &imag);
+        sd->X[k] = real - imag * I;
+    }
+
+    sd->since_anchor = 0;
+}
+
+
+/*
+ *  SlidingDft オブジェクトを開放する
+ */
+void sliding_dft_free(SlidingDft *sd)
+{
+    if (sd) {
+        free(sd->rot);
+        free(sd->coef);
+        free(sd->X);
+        free(sd->ring);
+        free(sd->linear);
+        free(sd);
+    }
+}
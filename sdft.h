@@ -0,0 +1,89 @@
+/*
+ *  sdft.h
+ *
+ *  スライディング DFT
+ *
+ *  直近 size 個のサンプルに対する DFT の各ビンを、サンプルが1つ
+ *  追加されるごとに漸化式で更新する。1サンプルあたりの計算量は
+ *  O(ビン数) であり、フレームの間隔(ホップ)が小さい場合でも、
+ *  フレームごとに O(size × ビン数) の計算をやり直す必要がない。
+ *
+ *  漸化式の丸め誤差は蓄積していくため、一定のサンプル数ごとに
+ *  直近のサンプルから DFT を直接計算し直す(再アンカー)。
+ *
+ */
+
+#ifndef __SDFT_H__
+#define __SDFT_H__
+
+#include <stddef.h>
+#include <complex.h>
+
+
+//  SlidingDft 構造体
+typedef struct _sliding_dft {
+    size_t      size;           //  窓の長さ(サンプル数)
+    int         num_bin;        //  ビンの数
+    complex     *rot;           //  exp(iω_k)
+    complex     *coef;          //  exp(-iω_k (size - 1))
+    complex     *X;             //  現在の各ビンの値
+    double      *ring;          //  直近 size 個のサンプル(リングバッファ)
+    double      *linear;        //  再アンカー時にサンプルを時間順に並べ直す領域
+    size_t      pos;            //  ring 内の最も古いサンプルの位置
+    size_t      since_anchor;   //  前回の再アンカーからのサンプル数
+    size_t      anchor_interval;//  再アンカーを行う間隔(サンプル数)
+    const double *cos_table;    //  cos(2πj / table_size)
+    const double *sin_table;    //  sin(2πj / table_size)
+    size_t      table_size;
+} SlidingDft;
+
+
+/*
+ *  スライディング DFT を新規作成する
+ *
+ *  引数：
+ *    size            : 窓の長さ(サンプル数)
+ *    num_bin         : ビンの数。k 番目(1 <= k <= num_bin)のビンの角周波数は
+ *                      ω_k = 2πk / table_size となる。
+ *    cos_table       : cos(2πj / table_size) のテーブル
+ *    sin_table       : sin(2πj / table_size) のテーブル
+ *    table_size      : テーブルの大きさ
+ *    anchor_interval : 再アンカーを行う間隔(サンプル数)。0 なら行わない。
+ *
+ *  テーブルはコピーしないので、SlidingDft を開放するまで保持すること。
+ */
+SlidingDft *sliding_dft_new(size_t size, int num_bin,
+                            const double *cos_table, const double *sin_table, size_t table_size,
+                            size_t anchor_interval);
+
+
+/*
+ *  サンプルを追加する
+ *
+ *  引数：
+ *    sd         : SlidingDft オブジェクト
+ *    sample     : 追加するサンプル。NULL の場合は 0 を追加する。
+ *    num_sample : 追加するサンプル数
+ */
+void sliding_dft_push(SlidingDft *sd, const double *sample, size_t num_sample);
+
+
+/*
+ *  状態を初期化する(直近のサンプルをすべて 0 とする)
+ */
+void sliding_dft_reset(SlidingDft *sd);
+
+
+/*
+ *  直近 size 個のサンプルから、DFT の各ビンを直接計算し直す
+ */
+void sliding_dft_anchor(SlidingDft *sd);
+
+
+/*
+ *  SlidingDft オブジェクトを開放する
+ */
+void sliding_dft_free(SlidingDft *sd);
+
+
+#endif  //  __SDFT_H__
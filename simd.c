@@ -0,0 +1,878 @@
+/*
+ *  simd.c
+ *
+ *  SIMD 命令を用いた演算カーネル
+ *
+ *  各カーネルは target 属性で命令セットを指定してコンパイルするため、
+ *  ファイル全体を -mavx2 などでコンパイルする必要はない。
+ *  どのカーネルを使うかは、実行時に CPU の対応状況から決める。
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <immintrin.h>
+#include "simd.h"
+
+
+/*
+ *  スカラー版(どの CPU でも動作する)
+ */
+
+static void _radix2_scalar(complex *data, int n, int m, const complex *W)
+{
+    int j, k;
+
+    for (k = 0; k < n; k += 2 * m) {
+        for (j = 0; j < m; j++) {
+            complex a = data[k + j];
+            complex b = data[k + j + m] * W[j];
+            data[k + j]     = a + b;
+            data[k + j + m] = a - b;
+        }
+    }
+}
+
+
+static void _dft_bin_scalar(const double *sample, size_t num_sample, size_t k,
+                            const double *cos_table, const double *sin_table, size_t size,
+                            double *real, double *imag)
+{
+    double re = 0.0, im = 0.0;
+    size_t idx = 0;
+    size_t t;
+
+    for (t = 0; t < num_sample; t++) {
+        re += sample[t] * cos_table[idx];
+        im += sample[t] * sin_table[idx];
+        idx += k;
+        if (idx >= size)
+            idx -= size;
+    }
+
+    *real = re;
+    *imag = im;
+}
+
+
+static void _radix2f_scalar(float complex *data, int n, int m, const float complex *W)
+{
+    int j, k;
+
+    for (k = 0; k < n; k += 2 * m) {
+        for (j = 0; j < m; j++) {
+            float complex a = data[k + j];
+            float complex b = data[k + j + m] * W[j];
+            data[k + j]     = a + b;
+            data[k + j + m] = a - b;
+        }
+    }
+}
+
+
+static void _dft_binf_scalar(const float *sample, size_t num_sample, size_t k,
+                             const float *cos_table, const float *sin_table, size_t size,
+                             float *real, float *imag)
+{
+    float re = 0.0f, im = 0.0f;
+    size_t idx = 0;
+    size_t t;
+
+    for (t = 0; t < num_sample; t++) {
+        re += sample[t] * cos_table[idx];
+        im += sample[t] * sin_table[idx];
+        idx += k;
+        if (idx >= size)
+            idx -= size;
+    }
+
+    *real = re;
+    *imag = im;
+}
+
+
+//  1サンプルを読み、16bit 整数の尺度に揃えた値を返す
+static inline double _load_sample(const unsigned char *p, int type, int bits)
+{
+    if (type == SAMPLE_FLOAT) {
+        if (bits == 32) {
+            float f;
+            memcpy(&f, p, 4);
+            return f * 32768.0;
+        } else {
+            double d;
+            memcpy(&d, p, 8);
+            return d * 32768.0;
+        }
+    }
+
+    switch (bits) {
+    case 8:
+        return (p[0] - 128) * 256.0;
+    case 16: {
+        int16_t v;
+        memcpy(&v, p, 2);
+        return v;
+    }
+    case 24: {
+        //  上位 24bit に詰めてから算術シフトで符号拡張する
+        int32_t v = (int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 24);
+        return (v >> 8) / 256.0;
+    }
+    default: {
+        int32_t v;
+        memcpy(&v, p, 4);
+        return v / 65536.0;
+    }
+    }
+}
+
+
+static void _convert_scalar(const void *src, size_t num_frame, const SampleFormat *fmt,
+                            const double *window, double *dst)
+{
+    const unsigned char *s = src;
+    const size_t bps = fmt->bits / 8;
+    const size_t stride = bps * fmt->channels;
+    size_t i;
+    int c;
+
+    //  モノラル 16bit はよく使うので、別に扱う
+    if (fmt->type == SAMPLE_INT && fmt->bits == 16 && fmt->channels == 1) {
+        const int16_t *s16 = src;
+        for (i = 0; i < num_frame; i++)
+            dst[i] = window ? s16[i] * window[i] : s16[i];
+        return;
+    }
+
+    for (i = 0; i < num_frame; i++, s += stride) {
+        double v;
+
+        if (fmt->channel == SAMPLE_MIX) {
+            v = 0.0;
+            for (c = 0; c < fmt->channels; c++)
+                v += _load_sample(s + c * bps, fmt->type, fmt->bits);
+            v /= fmt->channels;
+        } else {
+            v = _load_sample(s + fmt->channel * bps, fmt->type, fmt->bits);
+        }
+
+        dst[i] = window ? v * window[i] : v;
+    }
+}
+
+
+/*
+ *  SSE2 版
+ *
+ *  complex 1個(実部・虚部)を 128bit レジスタ1本で扱う。
+ */
+
+//  複素数の積 b * w
+__attribute__((target("sse2")))
+static inline __m128d _cmul_sse2(__m128d b, __m128d w)
+{
+    const __m128d neg_lo = _mm_set_pd(0.0, -0.0);
+    __m128d wr = _mm_unpacklo_pd(w, w);                 //  [wr, wr]
+    __m128d wi = _mm_unpackhi_pd(w, w);                 //  [wi, wi]
+    __m128d bs = _mm_shuffle_pd(b, b, 1);               //  [bi, br]
+    __m128d t  = _mm_xor_pd(_mm_mul_pd(bs, wi), neg_lo); // [-bi wi, br wi]
+    return _mm_add_pd(_mm_mul_pd(b, wr), t);
+}
+
+
+__attribute__((target("sse2")))
+static void _radix2_sse2(complex *data, int n, int m, const complex *W)
+{
+    double *d = (double *)data;
+    const double *w = (const double *)W;
+    int j, k;
+
+    for (k = 0; k < n; k += 2 * m) {
+        double *p = d + 2 * k;
+        double *q = d + 2 * (k + m);
+        for (j = 0; j < m; j++) {
+            __m128d a = _mm_loadu_pd(p + 2 * j);
+            __m128d b = _cmul_sse2(_mm_loadu_pd(q + 2 * j), _mm_loadu_pd(w + 2 * j));
+            _mm_storeu_pd(p + 2 * j, _mm_add_pd(a, b));
+            _mm_storeu_pd(q + 2 * j, _mm_sub_pd(a, b));
+        }
+    }
+}
+
+
+__attribute__((target("sse2")))
+static void _dft_bin_sse2(const double *sample, size_t num_sample, size_t k,
+                          const double *cos_table, const double *sin_table, size_t size,
+                          double *real, double *imag)
+{
+    __m128d re = _mm_setzero_pd();
+    __m128d im = _mm_setzero_pd();
+    double buf[2];
+    size_t i0 = 0, i1 = k;
+    size_t step = (2 * k) % size;
+    size_t t;
+
+    //  2サンプルずつ。SSE2 にはギャザー命令がないので、テーブルは個別に読む
+    for (t = 0; t + 2 <= num_sample; t += 2) {
+        __m128d x = _mm_loadu_pd(sample + t);
+        re = _mm_add_pd(re, _mm_mul_pd(x, _mm_set_pd(cos_table[i1], cos_table[i0])));
+        im = _mm_add_pd(im, _mm_mul_pd(x, _mm_set_pd(sin_table[i1], sin_table[i0])));
+        i0 += step;
+        if (i0 >= size)
+            i0 -= size;
+        i1 += step;
+        if (i1 >= size)
+            i1 -= size;
+    }
+
+    _mm_storeu_pd(buf, re);
+    *real = buf[0] + buf[1];
+    _mm_storeu_pd(buf, im);
+    *imag = buf[0] + buf[1];
+
+    //  端数
+    for (; t < num_sample; t++) {
+        *real += sample[t] * cos_table[i0];
+        *imag += sample[t] * sin_table[i0];
+    }
+}
+
+
+//  float 版では、float complex 2個を 128bit レジスタ1本で扱う。
+
+//  複素数の積 b * w (2組同時, float)
+__attribute__((target("sse2")))
+static inline __m128 _cmulf_sse2(__m128 b, __m128 w)
+{
+    const __m128 neg_even = _mm_set_ps(0.0f, -0.0f, 0.0f, -0.0f);
+    __m128 wr = _mm_shuffle_ps(w, w, _MM_SHUFFLE(2, 2, 0, 0));     //  [wr0, wr0, wr1, wr1]
+    __m128 wi = _mm_shuffle_ps(w, w, _MM_SHUFFLE(3, 3, 1, 1));     //  [wi0, wi0, wi1, wi1]
+    __m128 bs = _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 3, 0, 1));     //  [bi0, br0, bi1, br1]
+    __m128 t  = _mm_xor_ps(_mm_mul_ps(bs, wi), neg_even);          //  [-bi wi, br wi, ...]
+    return _mm_add_ps(_mm_mul_ps(b, wr), t);
+}
+
+
+__attribute__((target("sse2")))
+static void _radix2f_sse2(float complex *data, int n, int m, const float complex *W)
+{
+    float *d = (float *)data;
+    const float *w = (const float *)W;
+    int j, k;
+
+    if (m < 2) {
+        _radix2f_scalar(data, n, m, W);
+        return;
+    }
+
+    for (k = 0; k < n; k += 2 * m) {
+        float *p = d + 2 * k;
+        float *q = d + 2 * (k + m);
+        for (j = 0; j + 2 <= m; j += 2) {
+            __m128 a = _mm_loadu_ps(p + 2 * j);
+            __m128 b = _cmulf_sse2(_mm_loadu_ps(q + 2 * j), _mm_loadu_ps(w + 2 * j));
+            _mm_storeu_ps(p + 2 * j, _mm_add_ps(a, b));
+            _mm_storeu_ps(q + 2 * j, _mm_sub_ps(a, b));
+        }
+        //  m が奇数の場合の端数
+        for (; j < m; j++) {
+            float complex a = data[k + j];
+            float complex b = data[k + j + m] * W[j];
+            data[k + j]     = a + b;
+            data[k + j + m] = a - b;
+        }
+    }
+}
+
+
+__attribute__((target("sse2")))
+static void _dft_binf_sse2(const float *sample, size_t num_sample, size_t k,
+                           const float *cos_table, const float *sin_table, size_t size,
+                           float *real, float *imag)
+{
+    __m128 re = _mm_setzero_ps();
+    __m128 im = _mm_setzero_ps();
+    float buf[4];
+    size_t i[4];
+    size_t step = (4 * k) % size;
+    size_t t;
+    int l;
+
+    for (l = 0; l < 4; l++)
+        i[l] = (l * k) % size;
+
+    //  4サンプルずつ。テーブルは個別に読む
+    for (t = 0; t + 4 <= num_sample; t += 4) {
+        __m128 x = _mm_loadu_ps(sample + t);
+        re = _mm_add_ps(re, _mm_mul_ps(x, _mm_set_ps(cos_table[i[3]], cos_table[i[2]],
+                                                     cos_table[i[1]], cos_table[i[0]])));
+        im = _mm_add_ps(im, _mm_mul_ps(x, _mm_set_ps(sin_table[i[3]], sin_table[i[2]],
+                                                     sin_table[i[1]], sin_table[i[0]])));
+        for (l = 0; l < 4; l++) {
+            i[l] += step;
+            if (i[l] >= size)
+                i[l] -= size;
+        }
+    }
+
+    _mm_storeu_ps(buf, re);
+    *real = (buf[0] + buf[1]) + (buf[2] + buf[3]);
+    _mm_storeu_ps(buf, im);
+    *imag = (buf[0] + buf[1]) + (buf[2] + buf[3]);
+
+    //  端数
+    for (; t < num_sample; t++) {
+        *real += sample[t] * cos_table[i[0]];
+        *imag += sample[t] * sin_table[i[0]];
+        i[0] += k;
+        if (i[0] >= size)
+            i[0] -= size;
+    }
+}
+
+
+/*
+ *  AVX2 版
+ *
+ *  complex 2個を 256bit レジスタ1本で扱う。
+ */
+
+//  複素数の積 b * w (2組同時)
+__attribute__((target("avx2,fma")))
+static inline __m256d _cmul_avx2(__m256d b, __m256d w)
+{
+    __m256d wr = _mm256_movedup_pd(w);                  //  [wr0, wr0, wr1, wr1]
+    __m256d wi = _mm256_permute_pd(w, 0xF);             //  [wi0, wi0, wi1, wi1]
+    __m256d bs = _mm256_permute_pd(b, 0x5);             //  [bi0, br0, bi1, br1]
+    return _mm256_fmaddsub_pd(b, wr, _mm256_mul_pd(bs, wi));
+}
+
+
+__attribute__((target("avx2,fma")))
+static void _radix2_avx2(complex *data, int n, int m, const complex *W)
+{
+    double *d = (double *)data;
+    const double *w = (const double *)W;
+    int j, k;
+
+    if (m < 2) {
+        _radix2_sse2(data, n, m, W);
+        return;
+    }
+
+    for (k = 0; k < n; k += 2 * m) {
+        double *p = d + 2 * k;
+        double *q = d + 2 * (k + m);
+        for (j = 0; j + 2 <= m; j += 2) {
+            __m256d a = _mm256_loadu_pd(p + 2 * j);
+            __m256d b = _cmul_avx2(_mm256_loadu_pd(q + 2 * j), _mm256_loadu_pd(w + 2 * j));
+            _mm256_storeu_pd(p + 2 * j, _mm256_add_pd(a, b));
+            _mm256_storeu_pd(q + 2 * j, _mm256_sub_pd(a, b));
+        }
+        //  m が奇数の場合の端数
+        for (; j < m; j++) {
+            complex a = data[k + j];
+            complex b = data[k + j + m] * W[j];
+            data[k + j]     = a + b;
+            data[k + j + m] = a - b;
+        }
+    }
+}
+
+
+__attribute__((target("avx2,fma")))
+static void _dft_bin_avx2(const double *sample, size_t num_sample, size_t k,
+                          const double *cos_table, const double *sin_table, size_t size,
+                          double *real, double *imag)
+{
+    __m256d re = _mm256_setzero_pd();
+    __m256d im = _mm256_setzero_pd();
+    double buf[4];
+    size_t t;
+
+    //  4サンプル分のテーブル位置 (t + i) k mod size を並べ、4 k mod size ずつ進める
+    __m256i idx = _mm256_set_epi64x((3 * k) % size, (2 * k) % size, k % size, 0);
+    const __m256i step  = _mm256_set1_epi64x((4 * k) % size);
+    const __m256i limit = _mm256_set1_epi64x(size - 1);
+    const __m256i vsize = _mm256_set1_epi64x(size);
+
+    for (t = 0; t + 4 <= num_sample; t += 4) {
+        __m256d x = _mm256_loadu_pd(sample + t);
+        re = _mm256_fmadd_pd(x, _mm256_i64gather_pd(cos_table, idx, 8), re);
+        im = _mm256_fmadd_pd(x, _mm256_i64gather_pd(sin_table, idx, 8), im);
+
+        idx = _mm256_add_epi64(idx, step);
+        idx = _mm256_sub_epi64(idx, _mm256_and_si256(_mm256_cmpgt_epi64(idx, limit), vsize));
+    }
+
+    _mm256_storeu_pd(buf, re);
+    *real = (buf[0] + buf[1]) + (buf[2] + buf[3]);
+    _mm256_storeu_pd(buf, im);
+    *imag = (buf[0] + buf[1]) + (buf[2] + buf[3]);
+
+    //  端数
+    if (t < num_sample) {
+        size_t i = (size_t)((t % size) * (k % size) % size);
+        for (; t < num_sample; t++) {
+            *real += sample[t] * cos_table[i];
+            *imag += sample[t] * sin_table[i];
+            i += k;
+            if (i >= size)
+                i -= size;
+        }
+    }
+}
+
+
+//  複素数の積 b * w (4組同時, float)
+__attribute__((target("avx2,fma")))
+static inline __m256 _cmulf_avx2(__m256 b, __m256 w)
+{
+    __m256 wr = _mm256_moveldup_ps(w);                  //  [wr0, wr0, wr1, wr1, ...]
+    __m256 wi = _mm256_movehdup_ps(w);                  //  [wi0, wi0, wi1, wi1, ...]
+    __m256 bs = _mm256_permute_ps(b, 0xB1);             //  [bi0, br0, bi1, br1, ...]
+    return _mm256_fmaddsub_ps(b, wr, _mm256_mul_ps(bs, wi));
+}
+
+
+__attribute__((target("avx2,fma")))
+static void _radix2f_avx2(float complex *data, int n, int m, const float complex *W)
+{
+    float *d = (float *)data;
+    const float *w = (const float *)W;
+    int j, k;
+
+    if (m < 4) {
+        _radix2f_sse2(data, n, m, W);
+        return;
+    }
+
+    for (k = 0; k < n; k += 2 * m) {
+        float *p = d + 2 * k;
+        float *q = d + 2 * (k + m);
+        for (j = 0; j + 4 <= m; j += 4) {
+            __m256 a = _mm256_loadu_ps(p + 2 * j);
+            __m256 b = _cmulf_avx2(_mm256_loadu_ps(q + 2 * j), _mm256_loadu_ps(w + 2 * j));
+            _mm256_storeu_ps(p + 2 * j, _mm256_add_ps(a, b));
+            _mm256_storeu_ps(q + 2 * j, _mm256_sub_ps(a, b));
+        }
+        //  m が 4 の倍数でない場合の端数
+        for (; j < m; j++) {
+            float complex a = data[k + j];
+            float complex b = data[k + j + m] * W[j];
+            data[k + j]     = a + b;
+            data[k + j + m] = a - b;
+        }
+    }
+}
+
+
+__attribute__((target("avx2,fma")))
+static void _dft_binf_avx2(const float *sample, size_t num_sample, size_t k,
+                           const float *cos_table, const float *sin_table, size_t size,
+                           float *real, float *imag)
+{
+    __m256 re = _mm256_setzero_ps();
+    __m256 im = _mm256_setzero_ps();
+    float buf[8];
+    size_t t;
+
+    //  テーブルの位置は 32bit の添字で扱う
+    if (size > INT32_MAX / 2) {
+        _dft_binf_scalar(sample, num_sample, k, cos_table, sin_table, size, real, imag);
+        return;
+    }
+
+    //  8サンプル分のテーブル位置 (t + i) k mod size を並べ、8 k mod size ずつ進める
+    __m256i idx = _mm256_set_epi32((7 * k) % size, (6 * k) % size, (5 * k) % size, (4 * k) % size,
+                                   (3 * k) % size, (2 * k) % size, k % size, 0);
+    const __m256i step  = _mm256_set1_epi32((8 * k) % size);
+    const __m256i limit = _mm256_set1_epi32(size - 1);
+    const __m256i vsize = _mm256_set1_epi32(size);
+
+    for (t = 0; t + 8 <= num_sample; t += 8) {
+        __m256 x = _mm256_loadu_ps(sample + t);
+        re = _mm256_fmadd_ps(x, _mm256_i32gather_ps(cos_table, idx, 4), re);
+        im = _mm256_fmadd_ps(x, _mm256_i32gather_ps(sin_table, idx, 4), im);
+
+        idx = _mm256_add_epi32(idx, step);
+        idx = _mm256_sub_epi32(idx, _mm256_and_si256(_mm256_cmpgt_epi32(idx, limit), vsize));
+    }
+
+    _mm256_storeu_ps(buf, re);
+    *real = ((buf[0] + buf[1]) + (buf[2] + buf[3])) + ((buf[4] + buf[5]) + (buf[6] + buf[7]));
+    _mm256_storeu_ps(buf, im);
+    *imag = ((buf[0] + buf[1]) + (buf[2] + buf[3])) + ((buf[4] + buf[5]) + (buf[6] + buf[7]));
+
+    //  端数
+    if (t < num_sample) {
+        size_t i = (size_t)((t % size) * (k % size) % size);
+        for (; t < num_sample; t++) {
+            *real += sample[t] * cos_table[i];
+            *imag += sample[t] * sin_table[i];
+            i += k;
+            if (i >= size)
+                i -= size;
+        }
+    }
+}
+
+
+//  4サンプルフレーム分の1チャンネルを集め、double 型に変換する
+//  base からのバイト位置 idx にある 4 バイトを読むため、
+//  8bit, 16bit, 24bit の場合はサンプルの後ろを最大 3 バイトはみ出して読む。
+__attribute__((target("avx2,fma")))
+static inline __m256d _gather_avx2(const unsigned char *base, __m128i idx, int type, int bits)
+{
+    if (type == SAMPLE_FLOAT) {
+        if (bits == 32)
+            return _mm256_cvtps_pd(_mm_i32gather_ps((const float *)base, idx, 1));
+        return _mm256_i32gather_pd((const double *)base, idx, 1);
+    }
+
+    __m128i v = _mm_i32gather_epi32((const int *)base, idx, 1);
+    switch (bits) {
+    case 8:
+        v = _mm_sub_epi32(_mm_and_si128(v, _mm_set1_epi32(0xFF)), _mm_set1_epi32(128));
+        break;
+    case 16:
+        v = _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+        break;
+    case 24:
+        v = _mm_srai_epi32(_mm_slli_epi32(v, 8), 8);
+        break;
+    }
+    return _mm256_cvtepi32_pd(v);
+}
+
+
+//  どの形式も、ギャザー命令で4フレーム分の同じチャンネルを一度に読む。
+//  チャンネルの取り出しと型の変換が同じ命令で済み、窓関数もそのまま掛けられる。
+__attribute__((target("avx2,fma")))
+static void _convert_avx2(const void *src, size_t num_frame, const SampleFormat *fmt,
+                          const double *window, double *dst)
+{
+    const unsigned char *s = src;
+    const size_t bps = fmt->bits / 8;
+    const size_t stride = bps * fmt->channels;
+    const int c_first = (fmt->channel == SAMPLE_MIX) ? 0 : fmt->channel;
+    const int c_last  = (fmt->channel == SAMPLE_MIX) ? fmt->channels - 1 : fmt->channel;
+    const __m128i idx = _mm_set_epi32(3 * stride, 2 * stride, stride, 0);
+    double scale;
+    size_t i;
+    int c;
+
+    //  添字が 32bit に収まらない場合や、はみ出しを吸収できない短いデータはスカラー版で行う
+    if (stride * 4 > INT32_MAX || num_frame < 8) {
+        _convert_scalar(src, num_frame, fmt, window, dst);
+        return;
+    }
+
+    switch (fmt->type == SAMPLE_FLOAT ? 0 : fmt->bits) {
+    case 8:  scale = 256.0;         break;
+    case 16: scale = 1.0;           break;
+    case 24: scale = 1.0 / 256.0;   break;
+    case 32: scale = 1.0 / 65536.0; break;
+    default: scale = 32768.0;       break;
+    }
+    scale /= c_last - c_first + 1;
+    const __m256d vscale = _mm256_set1_pd(scale);
+
+    //  はみ出して読む分(最大 3 バイト)が末尾を越えないよう、最後の 3 フレームは残す
+    for (i = 0; i + 4 + 3 <= num_frame; i += 4, s += 4 * stride) {
+        __m256d v = _gather_avx2(s + c_first * bps, idx, fmt->type, fmt->bits);
+        for (c = c_first + 1; c <= c_last; c++)
+            v = _mm256_add_pd(v, _gather_avx2(s + c * bps, idx, fmt->type, fmt->bits));
+        v = _mm256_mul_pd(v, vscale);
+        if (window)
+            v = _mm256_mul_pd(v, _mm256_loadu_pd(window + i));
+        _mm256_storeu_pd(dst + i, v);
+    }
+
+    //  端数
+    _convert_scalar(s, num_frame - i, fmt, window ? window + i : NULL, dst + i);
+}
+
+
+/*
+ *  AVX-512 版
+ *
+ *  complex 4個を 512bit レジスタ1本で扱う。
+ */
+
+//  複素数の積 b * w (4組同時)
+__attribute__((target("avx512f")))
+static inline __m512d _cmul_avx512(__m512d b, __m512d w)
+{
+    __m512d wr = _mm512_movedup_pd(w);
+    __m512d wi = _mm512_permute_pd(w, 0xFF);
+    __m512d bs = _mm512_permute_pd(b, 0x55);
+    return _mm512_fmaddsub_pd(b, wr, _mm512_mul_pd(bs, wi));
+}
+
+
+__attribute__((target("avx512f,avx2,fma")))
+static void _radix2_avx512(complex *data, int n, int m, const complex *W)
+{
+    double *d = (double *)data;
+    const double *w = (const double *)W;
+    int j, k;
+
+    if (m < 4) {
+        _radix2_avx2(data, n, m, W);
+        return;
+    }
+
+    for (k = 0; k < n; k += 2 * m) {
+        double *p = d + 2 * k;
+        double *q = d + 2 * (k + m);
+        for (j = 0; j + 4 <= m; j += 4) {
+            __m512d a = _mm512_loadu_pd(p + 2 * j);
+            __m512d b = _cmul_avx512(_mm512_loadu_pd(q + 2 * j), _mm512_loadu_pd(w + 2 * j));
+            _mm512_storeu_pd(p + 2 * j, _mm512_add_pd(a, b));
+            _mm512_storeu_pd(q + 2 * j, _mm512_sub_pd(a, b));
+        }
+        //  m が 4 の倍数でない場合の端数
+        for (; j < m; j++) {
+            complex a = data[k + j];
+            complex b = data[k + j + m] * W[j];
+            data[k + j]     = a + b;
+            data[k + j + m] = a - b;
+        }
+    }
+}
+
+
+__attribute__((target("avx512f")))
+static void _dft_bin_avx512(const double *sample, size_t num_sample, size_t k,
+                            const double *cos_table, const double *sin_table, size_t size,
+                            double *real, double *imag)
+{
+    __m512d re = _mm512_setzero_pd();
+    __m512d im = _mm512_setzero_pd();
+    size_t t;
+
+    //  8サンプル分のテーブル位置 (t + i) k mod size を並べ、8 k mod size ずつ進める
+    __m512i idx = _mm512_set_epi64((7 * k) % size, (6 * k) % size, (5 * k) % size, (4 * k) % size,
+                                   (3 * k) % size, (2 * k) % size, k % size, 0);
+    const __m512i step  = _mm512_set1_epi64((8 * k) % size);
+    const __m512i vsize = _mm512_set1_epi64(size);
+
+    for (t = 0; t + 8 <= num_sample; t += 8) {
+        __m512d x = _mm512_loadu_pd(sample + t);
+        re = _mm512_fmadd_pd(x, _mm512_i64gather_pd(idx, cos_table, 8), re);
+        im = _mm512_fmadd_pd(x, _mm512_i64gather_pd(idx, sin_table, 8), im);
+
+        idx = _mm512_add_epi64(idx, step);
+        idx = _mm512_mask_sub_epi64(idx, _mm512_cmpge_epu64_mask(idx, vsize), idx, vsize);
+    }
+
+    *real = _mm512_reduce_add_pd(re);
+    *imag = _mm512_reduce_add_pd(im);
+
+    //  端数
+    if (t < num_sample) {
+        size_t i = (size_t)((t % size) * (k % size) % size);
+        for (; t < num_sample; t++) {
+            *real += sample[t] * cos_table[i];
+            *imag += sample[t] * sin_table[i];
+            i += k;
+            if (i >= size)
+                i -= size;
+        }
+    }
+}
+
+
+//  複素数の積 b * w (8組同時, float)
+__attribute__((target("avx512f")))
+static inline __m512 _cmulf_avx512(__m512 b, __m512 w)
+{
+    __m512 wr = _mm512_moveldup_ps(w);
+    __m512 wi = _mm512_movehdup_ps(w);
+    __m512 bs = _mm512_permute_ps(b, 0xB1);
+    return _mm512_fmaddsub_ps(b, wr, _mm512_mul_ps(bs, wi));
+}
+
+
+__attribute__((target("avx512f,avx2,fma")))
+static void _radix2f_avx512(float complex *data, int n, int m, const float complex *W)
+{
+    float *d = (float *)data;
+    const float *w = (const float *)W;
+    int j, k;
+
+    if (m < 8) {
+        _radix2f_avx2(data, n, m, W);
+        return;
+    }
+
+    for (k = 0; k < n; k += 2 * m) {
+        float *p = d + 2 * k;
+        float *q = d + 2 * (k + m);
+        for (j = 0; j + 8 <= m; j += 8) {
+            __m512 a = _mm512_loadu_ps(p + 2 * j);
+            __m512 b = _cmulf_avx512(_mm512_loadu_ps(q + 2 * j), _mm512_loadu_ps(w + 2 * j));
+            _mm512_storeu_ps(p + 2 * j, _mm512_add_ps(a, b));
+            _mm512_storeu_ps(q + 2 * j, _mm512_sub_ps(a, b));
+        }
+        //  m が 8 の倍数でない場合の端数
+        for (; j < m; j++) {
+            float complex a = data[k + j];
+            float complex b = data[k + j + m] * W[j];
+            data[k + j]     = a + b;
+            data[k + j + m] = a - b;
+        }
+    }
+}
+
+
+__attribute__((target("avx512f")))
+static void _dft_binf_avx512(const float *sample, size_t num_sample, size_t k,
+                             const float *cos_table, const float *sin_table, size_t size,
+                             float *real, float *imag)
+{
+    __m512 re = _mm512_setzero_ps();
+    __m512 im = _mm512_setzero_ps();
+    size_t t;
+
+    //  テーブルの位置は 32bit の添字で扱う
+    if (size > INT32_MAX / 2) {
+        _dft_binf_scalar(sample, num_sample, k, cos_table, sin_table, size, real, imag);
+        return;
+    }
+
+    //  16サンプル分のテーブル位置 (t + i) k mod size を並べ、16 k mod size ずつ進める
+    __m512i idx = _mm512_set_epi32((15 * k) % size, (14 * k) % size, (13 * k) % size, (12 * k) % size,
+                                   (11 * k) % size, (10 * k) % size, (9 * k) % size, (8 * k) % size,
+                                   (7 * k) % size, (6 * k) % size, (5 * k) % size, (4 * k) % size,
+                                   (3 * k) % size, (2 * k) % size, k % size, 0);
+    const __m512i step  = _mm512_set1_epi32((16 * k) % size);
+    const __m512i vsize = _mm512_set1_epi32(size);
+
+    for (t = 0; t + 16 <= num_sample; t += 16) {
+        __m512 x = _mm512_loadu_ps(sample + t);
+        re = _mm512_fmadd_ps(x, _mm512_i32gather_ps(idx, cos_table, 4), re);
+        im = _mm512_fmadd_ps(x, _mm512_i32gather_ps(idx, sin_table, 4), im);
+
+        idx = _mm512_add_epi32(idx, step);
+        idx = _mm512_mask_sub_epi32(idx, _mm512_cmpge_epu32_mask(idx, vsize), idx, vsize);
+    }
+
+    *real = _mm512_reduce_add_ps(re);
+    *imag = _mm512_reduce_add_ps(im);
+
+    //  端数
+    if (t < num_sample) {
+        size_t i = (size_t)((t % size) * (k % size) % size);
+        for (; t < num_sample; t++) {
+            *real += sample[t] * cos_table[i];
+            *imag += sample[t] * sin_table[i];
+            i += k;
+            if (i >= size)
+                i -= size;
+        }
+    }
+}
+
+
+/*
+ *  カーネルの選択
+ */
+
+//  カーネルの一覧。後ろにあるものほど高速
+static const SimdKernel kernels[] = {
+    { "scalar", _radix2_scalar, _dft_bin_scalar, _convert_scalar,
+                _radix2f_scalar, _dft_binf_scalar },
+    { "sse2",   _radix2_sse2,   _dft_bin_sse2,   _convert_scalar,
+                _radix2f_sse2,   _dft_binf_sse2   },
+    { "avx2",   _radix2_avx2,   _dft_bin_avx2,   _convert_avx2,
+                _radix2f_avx2,   _dft_binf_avx2   },
+    { "avx512", _radix2_avx512, _dft_bin_avx512, _convert_avx2,
+                _radix2f_avx512, _dft_binf_avx512 },
+};
+#define NUM_KERNEL  (sizeof(kernels) / sizeof(kernels[0]))
+
+//  起動時に選択したカーネル
+static const SimdKernel *selected_kernel = &kernels[0];
+
+
+//  i 番目のカーネルが、この CPU で使用可能かどうか
+static int _kernel_supported(int i)
+{
+    __builtin_cpu_init();
+
+    switch (i) {
+    case 0:
+        return 1;
+    case 1:
+        return __builtin_cpu_supports("sse2");
+    case 2:
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case 3:
+        return __builtin_cpu_supports("avx512f")
+            && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    default:
+        return 0;
+    }
+}
+
+
+/*
+ *  名前を指定してカーネルを取得する
+ */
+const SimdKernel *simd_find_kernel(const char *name)
+{
+    int i;
+
+    for (i = 0; i < NUM_KERNEL; i++) {
+        if (strcmp(kernels[i].name, name) == 0)
+            return _kernel_supported(i) ? &kernels[i] : NULL;
+    }
+    return NULL;
+}
+
+
+//  起動時に、使用可能なもののうち最も高速なカーネルを選ぶ
+__attribute__((constructor))
+static void _simd_select_kernel(void)
+{
+    const char *name = getenv("DFT_SIMD");
+    int i;
+
+    if (name) {
+        const SimdKernel *kernel = simd_find_kernel(name);
+        if (kernel) {
+            selected_kernel = kernel;
+            return;
+        }
+        fprintf(stderr, "DFT_SIMD=%s is not available, selecting automatically\n", name);
+    }
+
+    for (i = NUM_KERNEL - 1; i > 0; i--) {
+        if (_kernel_supported(i))
+            break;
+    }
+    selected_kernel = &kernels[i];
+}
+
+
+/*
+ *  この CPU で使用するカーネルを返す
+ */
+const SimdKernel *simd_get_kernel(void)
+{
+    return selected_kernel;
+}
+
+
+/*
+ *  使用するカーネルを変更する
+ */
+void simd_set_kernel(const SimdKernel *kernel)
+{
+    selected_kernel = kernel;
+}
@@ -0,0 +1,108 @@
+/*
+ *  simd.h
+ *
+ *  SIMD 命令を用いた演算カーネル
+ *
+ *  SSE2, AVX2, AVX-512 の各命令セット向けのカーネルを用意し、
+ *  起動時に CPUID で使用可能なもののうち最も高速なものを選ぶ。
+ *  1つの実行ファイルで、異なる CPU を持つマシンに対応できる。
+ *
+ *  環境変数 DFT_SIMD に "scalar", "sse2", "avx2", "avx512" のいずれかを
+ *  指定すると、使用するカーネルを強制できる(CPU が対応していない場合は無視)。
+ *
+ */
+
+#ifndef __SIMD_H__
+#define __SIMD_H__
+
+#include <stddef.h>
+#include <complex.h>
+#include "sample.h"
+
+
+/*
+ *  基数2のバタフライ演算(1段分)
+ *
+ *  data : データ(n 個)
+ *  n    : データの数
+ *  m    : 部分変換の長さ(組になる2つの要素の間隔)
+ *  W    : 回転因子 W[j] = exp(-2πi j / 2m)  (0 <= j < m)
+ */
+typedef void (*Radix2Func)(complex *data, int n, int m, const complex *W);
+
+//  Radix2Func の float 版
+typedef void (*Radix2fFunc)(float complex *data, int n, int m, const float complex *W);
+
+
+/*
+ *  DFT の1つのビンについて、実部と虚部の積和を求める
+ *
+ *    real = Σ sample[t] cos(2π k t / size)
+ *    imag = Σ sample[t] sin(2π k t / size)    (0 <= t < num_sample)
+ *
+ *  三角関数の値はテーブル cos_table, sin_table (size 個)から引く。
+ *  k は size 未満でなければならない。
+ */
+typedef void (*DftBinFunc)(const double *sample, size_t num_sample, size_t k,
+                           const double *cos_table, const double *sin_table, size_t size,
+                           double *real, double *imag);
+
+//  DftBinFunc の float 版。積和も float で行う
+typedef void (*DftBinfFunc)(const float *sample, size_t num_sample, size_t k,
+                            const float *cos_table, const float *sin_table, size_t size,
+                            float *real, float *imag);
+
+
+/*
+ *  サンプルデータを double 型に変換する
+ *
+ *  チャンネルの取り出し(または平均)、型の変換、窓関数の乗算を
+ *  1回の走査で行う。引数は sample_convert() と同じ。
+ */
+typedef void (*ConvertFunc)(const void *src, size_t num_frame, const SampleFormat *fmt,
+                            const double *window, double *dst);
+
+
+//  SimdKernel 構造体
+typedef struct _simd_kernel {
+    const char  *name;      //  カーネルの名前
+    Radix2Func  radix2;     //  基数2のバタフライ演算
+    DftBinFunc  dft_bin;    //  DFT の1ビン分の積和
+    ConvertFunc convert;    //  サンプルデータの変換
+    Radix2fFunc radix2f;    //  基数2のバタフライ演算(float 版)
+    DftBinfFunc dft_binf;   //  DFT の1ビン分の積和(float 版)
+} SimdKernel;
+
+
+/*
+ *  この CPU で使用するカーネルを返す
+ *
+ *  起動時に一度だけ選択したものを返す。
+ */
+const SimdKernel *simd_get_kernel(void);
+
+
+/*
+ *  名前を指定してカーネルを取得する
+ *
+ *  name : "scalar", "sse2", "avx2", "avx512" のいずれか
+ *
+ *  戻値：
+ *    カーネル。該当するものがない場合や、CPU が対応していない場合は NULL。
+ */
+const SimdKernel *simd_find_kernel(const char *name);
+
+
+/*
+ *  使用するカーネルを変更する
+ *
+ *  kernel : simd_find_kernel() で取得したもの
+ *
+ *  各カーネルの結果を比べる検査(check.c)のためのもの。
+ *  FFT プランは作成時のカーネルを使い続けるので、変更後に作成し直すこと。
+ *  解析を行っている間に呼んではならない。
+ */
+void simd_set_kernel(const SimdKernel *kernel);
+
+
+#endif  //  __SIMD_H__
@@ -0,0 +1,73 @@
+/*
+ *  specfile.h
+ *
+ *  解析結果のバイナリ形式(dft -f bin の出力)
+ *
+ *  テキスト形式ではしきい値を超えるビンだけを1行ずつ出力するが、
+ *  バイナリ形式では全ビンの音量を固定長のレコードとして並べる。
+ *  ファイルをメモリにマップすれば、n 番目のフレームの音量を
+ *  解析し直すことなく直接参照できる。
+ *
+ *  ファイルの構成(数値はすべてリトルエンディアン)：
+ *
+ *    SpecHeader                    ヘッダ(header_size バイト)
+ *    double freq[num_bin]          各ビンの周波数(Hz)。bin_offset の位置から
+ *    レコード × num_frame          frame_offset の位置から、record_size バイトずつ
+ *
+ *  各レコードは、
+ *
+ *    int64_t sample_point          フレーム先頭のサンプル位置
+ *    float   amp[num_bin]          各ビンの音量(正規化済み)
+ *
+ *  で、record_size が 8 の倍数になるよう末尾を 0 で埋める。
+ *
+ *  出力先がシークできない場合(パイプなど)は、ヘッダの num_frame と max_amp を
+ *  書き戻せないため、いずれも 0 のままとなる。読み込む側は num_frame を
+ *  ファイルの大きさから求め、max_amp はレコードから求めること。
+ *  num_sample も同様に書き戻すもので、書き戻せない場合は wavファイルにある
+ *  サンプルフレーム数(大きさの分からないストリームでは 0)のままとなる。
+ *  0 の場合は、最後のレコードの sample_point + frame_size を用いること。
+ *
+ *  dft と fg/freqgraph の双方から参照する。
+ *
+ */
+
+#ifndef __SPECFILE_H__
+#define __SPECFILE_H__
+
+#include <stdint.h>
+
+//  ファイル先頭のマジックナンバー(8 バイト)
+#define SPEC_MAGIC          "DFTSPEC\0"
+#define SPEC_MAGIC_SIZE     8
+
+//  形式のバージョン
+#define SPEC_VERSION        1
+
+
+//  ヘッダ
+//  各メンバーは、間に詰め物が入らないように並べている。
+typedef struct _spec_header {
+    char        magic[SPEC_MAGIC_SIZE];     //  SPEC_MAGIC
+    uint32_t    version;        //  SPEC_VERSION
+    uint32_t    header_size;    //  ヘッダのバイト数
+    double      sample_rate;    //  サンプリングレート
+    uint64_t    num_sample;     //  解析に使ったサンプル数。0 の場合は不明
+    uint64_t    num_frame;      //  レコードの数。0 の場合はファイルの大きさから求める
+    uint64_t    bin_offset;     //  ファイル先頭から周波数テーブルまでのバイト数
+    uint64_t    frame_offset;   //  ファイル先頭から最初のレコードまでのバイト数
+    uint32_t    hop;            //  フレームの間隔(サンプル数, テキスト形式の2行目)
+    uint32_t    frame_size;     //  1フレームのサンプル数
+    uint32_t    mode;           //  解析モード(dft の MODE_*)
+    uint32_t    num_bin;        //  ビンの数
+    uint32_t    record_size;    //  1レコードのバイト数
+    float       max_amp;        //  全レコード中の最大音量。0 の場合は不明
+} SpecHeader;
+
+
+//  num_bin 個のビンを持つレコードのバイト数
+//  num_bin が壊れた値でも桁あふれしないよう、64bit で計算する。
+#define SPEC_RECORD_SIZE(num_bin)   ((8 + 4 * (uint64_t)(num_bin) + 7) / 8 * 8)
+
+
+#endif  //  __SPECFILE_H__
@@ -10,6 +10,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "wavfile.h"
 
 
@@ -55,12 +59,108 @@ static void read_cmp(size_t size, FILE *stream, const char *expected)
 }
 
 
+//  チャンクの残り size バイトを読み飛ばす。
+//  シークできない場合(パイプなど)は、読み込んで捨てる。
+static void skip_bytes(FILE *stream, unsigned long size)
+{
+    char tmp[1024];
+
+    if (size == 0 || fseek(stream, size, SEEK_CUR) == 0)
+        return;
+
+    while (size > 0) {
+        size_t n = (size < sizeof(tmp)) ? size : sizeof(tmp);
+        if (Fread(tmp, 1, n, stream) < n) {
+            fprintf(stderr, "Format error: unexpected end of file\n");
+            exit(EXIT_FAILURE);
+        }
+        size -= n;
+    }
+}
+
+
+//  fmt チャンクを読み込む。
+//  size はチャンクの大きさ。読み終わったら、チャンクの末尾まで進める。
+static void read_fmt(WavData *wav, uint32_t size)
+{
+    uint32_t consumed = 16;
+    uint32_t size32;
+    uint16_t size16;
+
+    if (size < 16) {
+        fprintf(stderr, "Format error: fmt chunk too short (%lu bytes)\n", (unsigned long)size);
+        exit(EXIT_FAILURE);
+    }
+    wav->fmtChunkSize = size;
+
+    //  Format ID
+    Fread(&wav->wFormatTag, 2, 1, wav->fp);
+
+    //  channels
+    Fread(&wav->wChannels, 2, 1, wav->fp);
+
+    //  Sampling rate
+    Fread(&size32, 4, 1, wav->fp);
+    wav->dwSamplesPerSec = size32;
+
+    //  AvgBytes/sec
+    Fread(&size32, 4, 1, wav->fp);
+    wav->dwAvgBytesPerSec = size32;
+
+    //  Block Size
+    Fread(&wav->wBlockAlign, 2, 1, wav->fp);
+
+    //  bit/sample
+    Fread(&wav->wBitsPerSample, 2, 1, wav->fp);
+
+    //  WAVE_FORMAT_EXTENSIBLE の場合は、拡張部分の SubFormat (GUID) の
+    //  先頭 2 バイトが実際のフォーマット ID となる
+    if (wav->wFormatTag == WAVE_FORMAT_EXTENSIBLE && size >= 40) {
+        uint16_t tag;
+
+        Fread(&size16, 2, 1, wav->fp);      //  cbSize
+        Fread(&wav->wValidBitsPerSample, 2, 1, wav->fp);
+        Fread(&size32, 4, 1, wav->fp);
+        wav->dwChannelMask = size32;
+        Fread(&tag, 2, 1, wav->fp);
+        wav->wFormatTag = tag;
+        consumed += 10;
+    }
+
+    skip_bytes(wav->fp, size - consumed + (size & 1));
+
+    switch (wav->wFormatTag) {
+    case WAVE_FORMAT_PCM:
+        wav->sampleType = SAMPLE_INT;
+        break;
+    case WAVE_FORMAT_IEEE_FLOAT:
+        wav->sampleType = SAMPLE_FLOAT;
+        break;
+    default:
+        fprintf(stderr, "Unsupported format: 0x%04x\n", wav->wFormatTag);
+        exit(EXIT_FAILURE);
+    }
+
+    SampleFormat fmt;
+    wav_sample_format(wav, SAMPLE_MIX, &fmt);
+    if (!sample_format_valid(&fmt) || wav->wBlockAlign != sample_frame_bytes(&fmt)) {
+        fprintf(stderr, "Unsupported format: %d bits, %d channels, block size %d\n",
+                wav->wBitsPerSample, wav->wChannels, wav->wBlockAlign);
+        exit(EXIT_FAILURE);
+    }
+}
+
+
 //  WAVファイルを読み込み、wav構造体にデータを格納していく。
-//  ここで、wavデータ本体を格納するためのメモリも同時に確保される。
-//  この領域は、呼び出し元で適切に開放される必要がある。
+//  チャンクを順にたどり、fmt チャンクの内容を読み込んだあと、
+//  data チャンクの中身の先頭まで進める。
+//  それ以外のチャンク(LIST, fact など)は読み飛ばす。
 static void read_wav(const char *filename, WavData *wav)
 {
     char tmp[16];
+    char id[4];
+    uint32_t size32;
+    int has_fmt = 0;
 
     if ((wav->fp = fopen(filename, "rb")) == NULL) {
         fprintf(stderr, "Failed to open file %s: %d\n", filename, errno);
@@ -77,48 +177,101 @@ static void read_wav(const char *filename, WavData *wav)
     //  WAVE header
     read_cmp(4, wav->fp, "WAVE");
 
-    //  Start of fmt chunk
-    read_cmp(4, wav->fp, FormatID);
+    while (1) {
+        //  チャンク ID と大きさ
+        //  (long は 4 バイトとは限らないので、4 バイトの整数として読む)
+        if (Fread(id, 4, 1, wav->fp) != 1 || Fread(&size32, 4, 1, wav->fp) != 1) {
+            fprintf(stderr, "Format error: %s\n", has_fmt ? DataID : FormatID);
+            exit(EXIT_FAILURE);
+        }
+
+        if (memcmp(id, FormatID, 4) == 0) {
+            read_fmt(wav, size32);
+            has_fmt = 1;
+        } else if (memcmp(id, DataID, 4) == 0) {
+            if (!has_fmt) {
+                fprintf(stderr, "Format error: %s\n", FormatID);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        } else {
+            //  チャンクの大きさが奇数の場合は、1 バイトの詰め物がある
+            skip_bytes(wav->fp, (unsigned long)size32 + (size32 & 1));
+        }
+    }
+
+    //  data bytes
+    wav->dataChunkSize = size32;
+    wav->dataOffset = ftell(wav->fp);
+
+    //  ストリームとして書き出されたファイルでは、大きさが 0 や 0xFFFFFFFF のことがある。
+    //  その場合はファイルの末尾まで読む。
+    if (size32 == 0 || size32 == 0xFFFFFFFF)
+        wav->numSamples = (size_t)-1;
+    else
+        wav->numSamples = size32 / wav->wBlockAlign;
+    wav->readPos = 0;
+}
 
-    //  sizeof wav chunk(16 bits when linear PCM)
-    Fread(&wav->fmtChunkSize, 4, 1, wav->fp);
 
-    //  Format ID
-    Fread(&wav->wFormatTag, 2, 1, wav->fp);
+WavData *open_wavfile(const char *filename) {
+    WavData *wav = malloc(sizeof(WavData));
+    if (!wav) {
+        perror("Failed to allocate memory for WavData");
+        exit(EXIT_FAILURE);
+    }
+    memset(wav, 0, sizeof(WavData));
+    read_wav(filename, wav);
 
-    //  channels
-    Fread(&wav->wChannels, 2, 1, wav->fp);
-   
-    //  Sampling rate
-    Fread(&wav->dwSamplesPerSec, 4, 1, wav->fp);
-    
-    //  AvgBytes/sec
-    Fread(&wav->dwAvgBytesPerSec, 4, 1, wav->fp);
-    
-    //  Block Size
-    Fread(&wav->wBlockAlign, 2, 1, wav->fp);
+    return wav;
+}
 
-    //  bit/sample
-    Fread(&wav->wBitsPerSample, 2, 1, wav->fp);
 
-    //  Start of Data chunk
-    read_cmp(4, wav->fp, DataID);
+//  wavファイル全体をメモリにマップする。
+//  マップできた場合は 1、できなかった場合は 0 を返す。
+static int map_wav(WavData *wav)
+{
+    struct stat st;
+    int fd = fileno(wav->fp);
 
-    //  data bytes
-    Fread(&wav->dataChunkSize, 4, 1, wav->fp);
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= wav->dataOffset)
+        return 0;
+
+    wav->map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (wav->map == MAP_FAILED) {
+        wav->map = NULL;
+        return 0;
+    }
+    wav->mapSize = st.st_size;
 
+    //  先頭から順に一度だけ読むので、先読みを促す
+    madvise(wav->map, wav->mapSize, MADV_SEQUENTIAL);
+    madvise(wav->map, wav->mapSize, MADV_WILLNEED);
+
+    //  ファイルが途中で切れている場合は、実際にある分だけを使う
+    size_t num = (wav->mapSize - wav->dataOffset) / wav->wBlockAlign;
+    if (num < wav->numSamples)
+        wav->numSamples = num;
+
+    wav->samples = (const unsigned char *)wav->map + wav->dataOffset;
+
+    return 1;
 }
 
 
-WavData *open_wavfile(const char *filename) {
-    WavData *wav = malloc(sizeof(WavData));
-    read_wav(filename, wav);
+WavData *open_wavfile_mmap(const char *filename) {
+    WavData *wav = open_wavfile(filename);
+    map_wav(wav);
 
     return wav;
 }
 
 
 void close_wavfile(WavData *wav) {
+    if (wav && wav->map) {
+        munmap(wav->map, wav->mapSize);
+    }
+
     if (wav && wav->fp) {
         fclose(wav->fp);
     }
@@ -130,14 +283,39 @@ void close_wavfile(WavData *wav) {
 
 
 /*
- * wavファイルからデータを size で指定した個数だけ読み込む。
- * 1サンプルが2バイトの場合、実際に読み込まれるのは size * 2 バイト。
- * 戻り値として、実際に読み込んだサンプル数を返す。
+ * wavファイルからデータを size で指定したサンプルフレーム数だけ読み込む。
+ * 実際に読み込まれるのは size * wBlockAlign バイト。
+ * 戻り値として、実際に読み込んだサンプルフレーム数を返す。
+ * メモリにマップしている場合は、マップした領域からコピーする(システムコールなし)。
+ * data チャンクの後ろに別のチャンクがあっても、それは読み込まない。
  */
 size_t read_data(WavData *wav, void *buf, size_t size) {
-    size_t num_read = Fread(buf, 1, 2 * size, wav->fp);
+    size_t rest = wav->numSamples - wav->readPos;
+    size_t num_read;
+
+    if (size > rest)
+        size = rest;
+
+    if (wav->samples) {
+        memcpy(buf, wav->samples + wav->readPos * wav->wBlockAlign, size * wav->wBlockAlign);
+        num_read = size;
+    } else {
+        //  Fread の戻り値はバイト数。読み込んだサンプルフレーム数にする。
+        //  (ファイル末尾の半端なバイトは捨てる)
+        num_read = Fread(buf, 1, size * wav->wBlockAlign, wav->fp) / wav->wBlockAlign;
+    }
 
-    //  num_read はバイト数。戻り値は読み込んだサンプル数にする。
-    return num_read / 2;
+    wav->readPos += num_read;
+    return num_read;
 }
 
+
+/*
+ * wavファイルのサンプルの形式を得る。
+ */
+void wav_sample_format(const WavData *wav, int channel, SampleFormat *fmt) {
+    fmt->type     = wav->sampleType;
+    fmt->bits     = wav->wBitsPerSample;
+    fmt->channels = wav->wChannels;
+    fmt->channel  = channel;
+}
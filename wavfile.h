@@ -2,31 +2,60 @@
 #define __WAVFILE_H__
 
 #include <stdio.h>
+#include <stdint.h>
+#include "sample.h"
+
+//  fmt チャンクのフォーマット ID
+#define WAVE_FORMAT_PCM         0x0001
+#define WAVE_FORMAT_IEEE_FLOAT  0x0003
+#define WAVE_FORMAT_EXTENSIBLE  0xFFFE
 
 typedef struct {
     long            fmtChunkSize;
-    short           wFormatTag;
+    unsigned short  wFormatTag;     //  WAVE_FORMAT_EXTENSIBLE の場合は、SubFormat が示す ID
     unsigned short  wChannels;
     unsigned long   dwSamplesPerSec;
     unsigned long   dwAvgBytesPerSec;
-    unsigned short  wBlockAlign;
+    unsigned short  wBlockAlign;    //  1サンプルフレーム(全チャンネル分)のバイト数
     unsigned short  wBitsPerSample;
+    unsigned short  wValidBitsPerSample;    //  有効なビット数(WAVE_FORMAT_EXTENSIBLE のみ)
+    unsigned long   dwChannelMask;  //  スピーカー配置(WAVE_FORMAT_EXTENSIBLE のみ)
+    int             sampleType;     //  サンプルの型(SAMPLE_INT, SAMPLE_FLOAT)
     long            dataChunkSize;
     FILE            *fp;
+    long            dataOffset;     //  ファイル先頭から data チャンクの中身までのバイト数
+    size_t          numSamples;     //  読めるサンプルフレーム数(data チャンクの大きさから求める)
+    size_t          readPos;        //  read_data() で次に読むサンプルフレームの位置
+
+    //  open_wavfile_mmap() でオープンした場合のみ
+    void            *map;           //  ファイル全体をマップした領域
+    size_t          mapSize;        //  マップした領域のバイト数
+    const unsigned char *samples;   //  data チャンクの先頭(マップした領域内)。マップしていなければ NULL
 } WavData;
 
 
 //  wavファイルをオープンする。
 WavData* open_wavfile(const char *filename);
 
+//  wavファイルをオープンし、data チャンクをメモリにマップする。
+//  wav->samples から、コピーなしでサンプルを直接参照できる。
+//  (i 番目のサンプルフレームは wav->samples + i * wav->wBlockAlign)
+//  マップできない場合(パイプなど)は、open_wavfile() と同じく
+//  ファイルから読み込む形でオープンする(wav->samples は NULL)。
+WavData* open_wavfile_mmap(const char *filename);
+
 //  wavファイルをクローズし、使用を終了する。
 //  オープンしたwavfileは必ずクローズして、使用していたメモリを開放すること。
 void close_wavfile(WavData *wav); 
 
-//  wavファイルから、sizeで指定されたサイズ分のデータを読み込む。
-//  コール後、size には、実際に読み込んだサイズが入る。
+//  wavファイルから、sizeで指定された数のサンプルフレームを読み込む。
+//  戻値は、実際に読み込んだサンプルフレーム数。
 size_t read_data(WavData *wav, void *buf, size_t size);
 
+//  wavファイルのサンプルの形式を得る。
+//  channel には取り出すチャンネル(SAMPLE_MIX なら全チャンネルの平均)を指定する。
+void wav_sample_format(const WavData *wav, int channel, SampleFormat *fmt);
+
 
 #endif
 